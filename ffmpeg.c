@@ -60,6 +60,7 @@
 #include "libavutil/bprint.h"
 #include "libavutil/time.h"
 #include "libavutil/threadmessage.h"
+#include "libavutil/atomic.h"
 #include "libavformat/os_support.h"
 
 #include "libavformat/ffm.h" // not public API
@@ -156,6 +157,17 @@ static int restore_tty;
 #endif
 
 static void free_input_threads(void);
+static void free_encoder_threads(void);
+
+#if HAVE_PTHREADS
+static int encoder_threads_active;
+static pthread_t main_thread;
+static pthread_mutex_t vstats_lock = PTHREAD_MUTEX_INITIALIZER;
+/* output streams whose encoder thread hit an error, for the main thread */
+static AVThreadMessageQueue *enc_status_queue;
+
+static void encoder_thread_exit(void);
+#endif
 
 
 /* sub2video hack:
@@ -428,6 +440,12 @@ static void ffmpeg_cleanup(int ret)
 {
     int i, j;
 
+#if HAVE_PTHREADS
+    if (encoder_threads_active && !pthread_equal(pthread_self(), main_thread))
+        encoder_thread_exit();
+    free_encoder_threads();
+#endif
+
     if (do_benchmark) {
         int maxrss = getmaxrss() / 1024;
         printf("bench: maxrss=%ikB\n", maxrss);
@@ -563,17 +581,70 @@ static void update_benchmark(const char *fmt, ...)
     }
 }
 
+static void lock_output_file(OutputFile *of)
+{
+#if HAVE_PTHREADS
+    if (encoder_threads_active)
+        pthread_mutex_lock(&of->mux_lock);
+#endif
+}
+
+static void unlock_output_file(OutputFile *of)
+{
+#if HAVE_PTHREADS
+    if (encoder_threads_active)
+        pthread_mutex_unlock(&of->mux_lock);
+#endif
+}
+
+static OSTFinished output_stream_finished(OutputStream *ost)
+{
+    OutputFile *of = output_files[ost->file_index];
+    OSTFinished finished;
+
+    lock_output_file(of);
+    finished = ost->finished;
+    unlock_output_file(of);
+    return finished;
+}
+
 static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream, OSTFinished others)
 {
     int i;
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost2 = output_streams[i];
+        OutputFile    *of = output_files[ost2->file_index];
+        lock_output_file(of);
         ost2->finished |= ost == ost2 ? this_stream : others;
+        unlock_output_file(of);
     }
 }
 
+/**
+ * Stop all outputs after a fatal muxing or encoding error in ost.
+ * Encoder threads only finish their own stream and leave the rest to the
+ * main thread, see check_encoder_threads().
+ */
+static void output_stream_failed(OutputStream *ost)
+{
+#if HAVE_PTHREADS
+    if (ost->enc_thread_queue) {
+        OutputFile *of = output_files[ost->file_index];
+
+        lock_output_file(of);
+        ost->finished |= MUXER_FINISHED | ENCODER_FINISHED;
+        unlock_output_file(of);
+        av_thread_message_queue_send(enc_status_queue, &ost, AV_THREAD_MESSAGE_NONBLOCK);
+        return;
+    }
+#endif
+    main_return_code = 1;
+    close_all_output_streams(ost, MUXER_FINISHED | ENCODER_FINISHED, ENCODER_FINISHED);
+}
+
 static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
 {
+    OutputFile *of = output_files[ost->file_index];
     AVBitStreamFilterContext *bsfc = ost->bitstream_filters;
     AVCodecContext          *avctx = ost->st->codec;
     int ret;
@@ -594,7 +665,9 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
             av_free_packet(pkt);
             return;
         }
+        lock_output_file(of);
         ost->frame_number++;
+        unlock_output_file(of);
     }
 
     if (bsfc)
@@ -686,11 +759,12 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
               );
     }
 
+    lock_output_file(of);
     ret = av_interleaved_write_frame(s, pkt);
+    unlock_output_file(of);
     if (ret < 0) {
         print_error("av_interleaved_write_frame()", ret);
-        main_return_code = 1;
-        close_all_output_streams(ost, MUXER_FINISHED | ENCODER_FINISHED, ENCODER_FINISHED);
+        output_stream_failed(ost);
     }
     av_free_packet(pkt);
 }
@@ -699,19 +773,26 @@ static void close_output_stream(OutputStream *ost)
 {
     OutputFile *of = output_files[ost->file_index];
 
+    lock_output_file(of);
     ost->finished |= ENCODER_FINISHED;
     if (of->shortest) {
         int64_t end = av_rescale_q(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, AV_TIME_BASE_Q);
         of->recording_time = FFMIN(of->recording_time, end);
     }
+    unlock_output_file(of);
 }
 
 static int check_recording_time(OutputStream *ost)
 {
     OutputFile *of = output_files[ost->file_index];
+    int64_t recording_time;
+
+    lock_output_file(of);
+    recording_time = of->recording_time;
+    unlock_output_file(of);
 
-    if (of->recording_time != INT64_MAX &&
-        av_compare_ts(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, of->recording_time,
+    if (recording_time != INT64_MAX &&
+        av_compare_ts(ost->sync_opts - ost->first_pts, ost->enc_ctx->time_base, recording_time,
                       AV_TIME_BASE_Q) >= 0) {
         close_output_stream(ost);
         return 0;
@@ -719,6 +800,30 @@ static int check_recording_time(OutputStream *ost)
     return 1;
 }
 
+/**
+ * Copy the encoder state shown by print_report() into ost, and count
+ * nb_frames frames as encoded. The encoder may run in its own thread, so
+ * print_report() must only read these copies, not the encoder context.
+ */
+static void update_encoder_stats(OutputStream *ost, int nb_frames)
+{
+    OutputFile *of = output_files[ost->file_index];
+    AVCodecContext *enc = ost->enc_ctx;
+    int i;
+
+    lock_output_file(of);
+    ost->frames_encoded += nb_frames;
+    ost->has_coded_frame = !!enc->coded_frame;
+    if (enc->coded_frame)
+        ost->coded_quality = enc->coded_frame->quality;
+    for (i = 0; i < FF_ARRAY_ELEMS(ost->error); i++) {
+        ost->error[i] = enc->error[i];
+        if (enc->coded_frame)
+            ost->coded_error[i] = enc->coded_frame->error[i];
+    }
+    unlock_output_file(of);
+}
+
 static void do_audio_out(AVFormatContext *s, OutputStream *ost,
                          AVFrame *frame)
 {
@@ -736,8 +841,10 @@ static void do_audio_out(AVFormatContext *s, OutputStream *ost,
     if (frame->pts == AV_NOPTS_VALUE || audio_sync_method < 0)
         frame->pts = ost->sync_opts;
     ost->sync_opts = frame->pts + frame->nb_samples;
+    lock_output_file(output_files[ost->file_index]);
     ost->samples_encoded += frame->nb_samples;
     ost->frames_encoded++;
+    unlock_output_file(output_files[ost->file_index]);
 
     av_assert0(pkt.size || !pkt.data);
     update_benchmark(NULL);
@@ -819,7 +926,9 @@ static void do_subtitle_out(AVFormatContext *s,
         if (i == 1)
             sub->num_rects = 0;
 
+        lock_output_file(output_files[ost->file_index]);
         ost->frames_encoded++;
+        unlock_output_file(output_files[ost->file_index]);
 
         subtitle_out_size = avcodec_encode_subtitle(enc, subtitle_out,
                                                     subtitle_out_max_size, sub);
@@ -856,6 +965,7 @@ static void do_video_out(AVFormatContext *s,
     AVPacket pkt;
     AVCodecContext *enc = ost->enc_ctx;
     AVCodecContext *mux_enc = ost->st->codec;
+    OutputFile *of = output_files[ost->file_index];
     int nb_frames, i;
     double sync_ipts, delta;
     double duration = 0;
@@ -921,7 +1031,7 @@ static void do_video_out(AVFormatContext *s,
 
     nb_frames = FFMIN(nb_frames, ost->max_frames - ost->frame_number);
     if (nb_frames == 0) {
-        nb_frames_drop++;
+        avpriv_atomic_int_add_and_fetch(&nb_frames_drop, 1);
         av_log(NULL, AV_LOG_VERBOSE,
                "*** dropping frame %d from stream %d at ts %"PRId64"\n",
                ost->frame_number, ost->st->index, in_picture->pts);
@@ -929,10 +1039,10 @@ static void do_video_out(AVFormatContext *s,
     } else if (nb_frames > 1) {
         if (nb_frames > dts_error_threshold * 30) {
             av_log(NULL, AV_LOG_ERROR, "%d frame duplication too large, skipping\n", nb_frames - 1);
-            nb_frames_drop++;
+            avpriv_atomic_int_add_and_fetch(&nb_frames_drop, 1);
             return;
         }
-        nb_frames_dup += nb_frames - 1;
+        avpriv_atomic_int_add_and_fetch(&nb_frames_dup, nb_frames - 1);
         av_log(NULL, AV_LOG_VERBOSE, "*** %d dup!\n", nb_frames - 1);
     }
 
@@ -1031,14 +1141,13 @@ static void do_video_out(AVFormatContext *s,
                    enc->time_base.num, enc->time_base.den);
         }
 
-        ost->frames_encoded++;
-
         ret = avcodec_encode_video2(enc, &pkt, in_picture, &got_packet);
         update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
         if (ret < 0) {
             av_log(NULL, AV_LOG_FATAL, "Video encoding failed\n");
             exit_program(1);
         }
+        update_encoder_stats(ost, 1);
 
         if (got_packet) {
             if (debug_ts) {
@@ -1075,7 +1184,9 @@ static void do_video_out(AVFormatContext *s,
      * But there may be reordering, so we can't throw away frames on encoder
      * flush, we need to limit them here, before they go into encoder.
      */
+    lock_output_file(of);
     ost->frame_number++;
+    unlock_output_file(of);
 
     if (vstats_filename && frame_size)
         do_video_stats(ost, frame_size);
@@ -1093,11 +1204,17 @@ static void do_video_stats(OutputStream *ost, int frame_size)
     int frame_number;
     double ti1, bitrate, avg_bitrate;
 
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&vstats_lock);
+#endif
     /* this is executed just the first time do_video_stats is called */
     if (!vstats_file) {
         vstats_file = fopen(vstats_filename, "w");
         if (!vstats_file) {
             perror("fopen");
+#if HAVE_PTHREADS
+            pthread_mutex_unlock(&vstats_lock);
+#endif
             exit_program(1);
         }
     }
@@ -1121,6 +1238,9 @@ static void do_video_stats(OutputStream *ost, int frame_size)
                (double)ost->data_size / 1024, ti1, bitrate, avg_bitrate);
         fprintf(vstats_file, "type= %c\n", av_get_picture_type_char(enc->coded_frame->pict_type));
     }
+#if HAVE_PTHREADS
+    pthread_mutex_unlock(&vstats_lock);
+#endif
 }
 
 static void finish_output_stream(OutputStream *ost)
@@ -1128,14 +1248,204 @@ static void finish_output_stream(OutputStream *ost)
     OutputFile *of = output_files[ost->file_index];
     int i;
 
+    lock_output_file(of);
     ost->finished = ENCODER_FINISHED | MUXER_FINISHED;
 
     if (of->shortest) {
         for (i = 0; i < of->ctx->nb_streams; i++)
             output_streams[of->ost_index + i]->finished = ENCODER_FINISHED | MUXER_FINISHED;
     }
+    unlock_output_file(of);
+}
+
+static void encode_frame(OutputFile *of, OutputStream *ost, AVFrame *frame)
+{
+    AVCodecContext *enc = ost->enc_ctx;
+
+    switch (enc->codec_type) {
+    case AVMEDIA_TYPE_VIDEO:
+        if (!ost->frame_aspect_ratio.num)
+            enc->sample_aspect_ratio = frame->sample_aspect_ratio;
+
+        do_video_out(of->ctx, ost, frame);
+        break;
+    case AVMEDIA_TYPE_AUDIO:
+        if (!(enc->codec->capabilities & CODEC_CAP_PARAM_CHANGE) &&
+            enc->channels != av_frame_get_channels(frame)) {
+            av_log(NULL, AV_LOG_ERROR,
+                   "Audio filter graph output is not normalized and encoder does not support parameter changes\n");
+            break;
+        }
+        do_audio_out(of->ctx, ost, frame);
+        break;
+    default:
+        // TODO support subtitle filters
+        av_assert0(0);
+    }
+}
+
+#if HAVE_PTHREADS
+static void *encoder_thread(void *arg)
+{
+    OutputStream *ost = arg;
+    OutputFile    *of = output_files[ost->file_index];
+    AVFrame *frame;
+
+    while (av_thread_message_queue_recv(ost->enc_thread_queue, &frame, 0) >= 0) {
+        /* frames queued before the main thread closed the encoder are still
+         * part of the output, only stop when the muxer is done */
+        if (!(output_stream_finished(ost) & MUXER_FINISHED))
+            encode_frame(of, ost, frame);
+        av_frame_free(&frame);
+    }
+
+    return NULL;
+}
+
+/**
+ * Called through exit_program() when an encoder thread hits a fatal error.
+ * Only this stream is stopped; the main thread finishes the other outputs
+ * and writes the trailers.
+ */
+static void encoder_thread_exit(void)
+{
+    int i;
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+
+        if (ost->enc_thread_queue && pthread_equal(pthread_self(), ost->enc_thread)) {
+            ost->enc_thread_failed = 1;
+            /* unblock the main thread if it is waiting for queue space */
+            av_thread_message_queue_set_err_send(ost->enc_thread_queue, AVERROR_EOF);
+            output_stream_failed(ost);
+            break;
+        }
+    }
+    pthread_exit(NULL);
+}
+
+/**
+ * Finish all outputs if an encoder thread reported an error.
+ * Must be called from the main thread.
+ */
+static void check_encoder_threads(void)
+{
+    OutputStream *ost;
+
+    if (!enc_status_queue)
+        return;
+    while (av_thread_message_queue_recv(enc_status_queue, &ost, AV_THREAD_MESSAGE_NONBLOCK) >= 0) {
+        main_return_code = 1;
+        close_all_output_streams(ost, MUXER_FINISHED | ENCODER_FINISHED, ENCODER_FINISHED);
+    }
+}
+
+static int send_frame_to_encoder_thread(OutputStream *ost, AVFrame *frame)
+{
+    AVFrame *f = av_frame_alloc();
+    int ret;
+
+    if (!f)
+        return AVERROR(ENOMEM);
+    av_frame_move_ref(f, frame);
+
+    ret = av_thread_message_queue_send(ost->enc_thread_queue, &f, 0);
+    if (ret < 0) {
+        if (ret != AVERROR_EOF)
+            av_log(NULL, AV_LOG_ERROR, "Unable to send frame to encoder thread: %s\n",
+                   av_err2str(ret));
+        av_frame_free(&f);
+    }
+    return ret;
 }
 
+static void free_encoder_threads(void)
+{
+    int i;
+
+    if (!encoder_threads_active)
+        return;
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+
+        if (!ost->enc_thread_queue)
+            continue;
+        /* the thread encodes the frames still queued and then exits */
+        av_thread_message_queue_set_err_recv(ost->enc_thread_queue, AVERROR_EOF);
+        pthread_join(ost->enc_thread, NULL);
+        av_thread_message_queue_free(&ost->enc_thread_queue);
+    }
+    check_encoder_threads();
+    av_thread_message_queue_free(&enc_status_queue);
+    for (i = 0; i < nb_output_files; i++)
+        pthread_mutex_destroy(&output_files[i]->mux_lock);
+    encoder_threads_active = 0;
+}
+
+static int init_encoder_threads(void)
+{
+    int i, ret;
+
+    if (!threaded_encoding)
+        return 0;
+    if (do_benchmark_all) {
+        av_log(NULL, AV_LOG_WARNING,
+               "-threaded_encoding is not supported with -benchmark_all, encoding in the main thread\n");
+        return 0;
+    }
+    /* -shortest and -frames end the other streams depending on how far the
+     * encoders got, which would make the output depend on thread timing */
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+
+        if (ost->filter && (output_files[ost->file_index]->shortest ||
+                            ost->max_frames != INT64_MAX)) {
+            av_log(NULL, AV_LOG_WARNING,
+                   "-threaded_encoding is not supported with -shortest or -frames, encoding in the main thread\n");
+            return 0;
+        }
+    }
+
+    for (i = 0; i < nb_output_files; i++) {
+        if ((ret = pthread_mutex_init(&output_files[i]->mux_lock, NULL))) {
+            while (--i >= 0)
+                pthread_mutex_destroy(&output_files[i]->mux_lock);
+            return AVERROR(ret);
+        }
+    }
+    ret = av_thread_message_queue_alloc(&enc_status_queue, nb_output_streams,
+                                        sizeof(OutputStream *));
+    if (ret < 0) {
+        for (i = 0; i < nb_output_files; i++)
+            pthread_mutex_destroy(&output_files[i]->mux_lock);
+        return ret;
+    }
+    main_thread = pthread_self();
+    encoder_threads_active = 1;
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+
+        if (!ost->filter)
+            continue;
+
+        ret = av_thread_message_queue_alloc(&ost->enc_thread_queue,
+                                            8, sizeof(AVFrame *));
+        if (ret < 0)
+            return ret;
+
+        if ((ret = pthread_create(&ost->enc_thread, NULL, encoder_thread, ost))) {
+            av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+            av_thread_message_queue_free(&ost->enc_thread_queue);
+            return AVERROR(ret);
+        }
+    }
+    return 0;
+}
+#endif
+
 /**
  * Get and encode new output from any of the filtergraphs, without causing
  * activity.
@@ -1175,7 +1485,7 @@ static int reap_filters(void)
                 }
                 break;
             }
-            if (ost->finished) {
+            if (output_stream_finished(ost)) {
                 av_frame_unref(filtered_frame);
                 continue;
             }
@@ -1189,34 +1499,22 @@ static int reap_filters(void)
             //if (ost->source_index >= 0)
             //    *filtered_frame= *input_streams[ost->source_index]->decoded_frame; //for me_threshold
 
-            switch (filter->inputs[0]->type) {
-            case AVMEDIA_TYPE_VIDEO:
-                filtered_frame->pts = frame_pts;
-                if (!ost->frame_aspect_ratio.num)
-                    enc->sample_aspect_ratio = filtered_frame->sample_aspect_ratio;
-
-                if (debug_ts) {
-                    av_log(NULL, AV_LOG_INFO, "filter -> pts:%s pts_time:%s time_base:%d/%d\n",
-                            av_ts2str(filtered_frame->pts), av_ts2timestr(filtered_frame->pts, &enc->time_base),
-                            enc->time_base.num, enc->time_base.den);
-                }
+            if (debug_ts && filter->inputs[0]->type == AVMEDIA_TYPE_VIDEO) {
+                av_log(NULL, AV_LOG_INFO, "filter -> pts:%s pts_time:%s time_base:%d/%d\n",
+                        av_ts2str(filtered_frame->pts), av_ts2timestr(filtered_frame->pts, &enc->time_base),
+                        enc->time_base.num, enc->time_base.den);
+            }
 
-                do_video_out(of->ctx, ost, filtered_frame);
-                break;
-            case AVMEDIA_TYPE_AUDIO:
-                filtered_frame->pts = frame_pts;
-                if (!(enc->codec->capabilities & CODEC_CAP_PARAM_CHANGE) &&
-                    enc->channels != av_frame_get_channels(filtered_frame)) {
-                    av_log(NULL, AV_LOG_ERROR,
-                           "Audio filter graph output is not normalized and encoder does not support parameter changes\n");
-                    break;
-                }
-                do_audio_out(of->ctx, ost, filtered_frame);
-                break;
-            default:
-                // TODO support subtitle filters
-                av_assert0(0);
+#if HAVE_PTHREADS
+            if (ost->enc_thread_queue) {
+                /* EOF means the encoder thread stopped on an error */
+                ret = send_frame_to_encoder_thread(ost, filtered_frame);
+                if (ret < 0 && ret != AVERROR_EOF)
+                    return ret;
+                continue;
             }
+#endif
+            encode_frame(of, ost, filtered_frame);
 
             av_frame_unref(filtered_frame);
         }
@@ -1343,6 +1641,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
     int64_t total_size;
     AVCodecContext *enc;
     int frame_number, vid, i;
+    int frames_dup, frames_drop;
     double bitrate;
     int64_t pts = INT64_MIN;
     static int64_t last_time = -1;
@@ -1365,9 +1664,11 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
 
     oc = output_files[0]->ctx;
 
+    lock_output_file(output_files[0]);
     total_size = avio_size(oc->pb);
     if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
         total_size = avio_tell(oc->pb);
+    unlock_output_file(output_files[0]);
 
     buf[0] = '\0';
     vid = 0;
@@ -1376,8 +1677,9 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         float q = -1;
         ost = output_streams[i];
         enc = ost->enc_ctx;
-        if (!ost->stream_copy && enc->coded_frame)
-            q = enc->coded_frame->quality / (float)FF_QP2LAMBDA;
+        lock_output_file(output_files[ost->file_index]);
+        if (!ost->stream_copy && ost->has_coded_frame)
+            q = ost->coded_quality / (float)FF_QP2LAMBDA;
         if (vid && enc->codec_type == AVMEDIA_TYPE_VIDEO) {
             snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), "q=%2.1f ", q);
             av_bprintf(&buf_script, "stream_%d_%d_q=%.1f\n",
@@ -1404,7 +1706,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
                 for (j = 0; j < 32; j++)
                     snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), "%X", (int)lrintf(log2(qp_histogram[j] + 1)));
             }
-            if ((enc->flags&CODEC_FLAG_PSNR) && (enc->coded_frame || is_last_report)) {
+            if ((enc->flags&CODEC_FLAG_PSNR) && (ost->has_coded_frame || is_last_report)) {
                 int j;
                 double error, error_sum = 0;
                 double scale, scale_sum = 0;
@@ -1413,10 +1715,10 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
                 snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), "PSNR=");
                 for (j = 0; j < 3; j++) {
                     if (is_last_report) {
-                        error = enc->error[j];
+                        error = ost->error[j];
                         scale = enc->width * enc->height * 255.0 * 255.0 * frame_number;
                     } else {
-                        error = enc->coded_frame->error[j];
+                        error = ost->coded_error[j];
                         scale = enc->width * enc->height * 255.0 * 255.0;
                     }
                     if (j)
@@ -1439,6 +1741,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         if (av_stream_get_end_pts(ost->st) != AV_NOPTS_VALUE)
             pts = FFMAX(pts, av_rescale_q(av_stream_get_end_pts(ost->st),
                                           ost->st->time_base, AV_TIME_BASE_Q));
+        unlock_output_file(output_files[ost->file_index]);
     }
 
     secs = pts / AV_TIME_BASE;
@@ -1467,11 +1770,13 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
     av_bprintf(&buf_script, "out_time=%02d:%02d:%02d.%06d\n",
                hours, mins, secs, us);
 
-    if (nb_frames_dup || nb_frames_drop)
+    frames_dup  = avpriv_atomic_int_get(&nb_frames_dup);
+    frames_drop = avpriv_atomic_int_get(&nb_frames_drop);
+    if (frames_dup || frames_drop)
         snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), " dup=%d drop=%d",
-                nb_frames_dup, nb_frames_drop);
-    av_bprintf(&buf_script, "dup_frames=%d\n", nb_frames_dup);
-    av_bprintf(&buf_script, "drop_frames=%d\n", nb_frames_drop);
+                frames_dup, frames_drop);
+    av_bprintf(&buf_script, "dup_frames=%d\n", frames_dup);
+    av_bprintf(&buf_script, "drop_frames=%d\n", frames_drop);
 
     if (print_stats || is_last_report) {
         if (print_stats==1 && AV_LOG_INFO > av_log_get_level()) {
@@ -1511,6 +1816,10 @@ static void flush_encoders(void)
 
         if (!ost->encoding_needed)
             continue;
+#if HAVE_PTHREADS
+        if (ost->enc_thread_failed)
+            continue;
+#endif
 
         if (enc->codec_type == AVMEDIA_TYPE_AUDIO && enc->frame_size <= 1)
             continue;
@@ -1549,6 +1858,8 @@ static void flush_encoders(void)
                     av_log(NULL, AV_LOG_FATAL, "%s encoding failed\n", desc);
                     exit_program(1);
                 }
+                if (enc->codec_type == AVMEDIA_TYPE_VIDEO)
+                    update_encoder_stats(ost, 0);
                 if (ost->logfile && enc->stats_out) {
                     fprintf(ost->logfile, "%s", enc->stats_out);
                 }
@@ -1585,7 +1896,7 @@ static int check_output_constraints(InputStream *ist, OutputStream *ost)
     if (ost->source_index != ist_index)
         return 0;
 
-    if (ost->finished)
+    if (output_stream_finished(ost))
         return 0;
 
     if (of->start_time != AV_NOPTS_VALUE && ist->pts < of->start_time)
@@ -1601,6 +1912,7 @@ static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *p
     int64_t start_time = (of->start_time == AV_NOPTS_VALUE) ? 0 : of->start_time;
     int64_t ost_tb_start_time = av_rescale_q(start_time, AV_TIME_BASE_Q, ost->st->time_base);
     int64_t ist_tb_start_time = av_rescale_q(start_time, AV_TIME_BASE_Q, ist->st->time_base);
+    int64_t recording_time;
     AVPicture pict;
     AVPacket opkt;
 
@@ -1620,8 +1932,11 @@ static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *p
             return;
     }
 
-    if (of->recording_time != INT64_MAX &&
-        ist->pts >= of->recording_time + start_time) {
+    lock_output_file(of);
+    recording_time = of->recording_time;
+    unlock_output_file(of);
+    if (recording_time != INT64_MAX &&
+        ist->pts >= recording_time + start_time) {
         close_output_stream(ost);
         return;
     }
@@ -2855,6 +3170,8 @@ static int transcode_init(void)
                         ost->file_index, ost->index);
                 goto dump_format;
             }
+            if (ost->enc->type == AVMEDIA_TYPE_VIDEO)
+                update_encoder_stats(ost, 0);
             if (ost->enc->type == AVMEDIA_TYPE_AUDIO &&
                 !(ost->enc->capabilities & CODEC_CAP_VARIABLE_FRAME_SIZE))
                 av_buffersink_set_frame_size(ost->filter->filter,
@@ -3035,11 +3352,17 @@ static int need_output(void)
         OutputStream *ost    = output_streams[i];
         OutputFile *of       = output_files[ost->file_index];
         AVFormatContext *os  = output_files[ost->file_index]->ctx;
+        int finished, frame_number;
+
+        lock_output_file(of);
+        finished     = ost->finished ||
+                       (os->pb && avio_tell(os->pb) >= of->limit_filesize);
+        frame_number = ost->frame_number;
+        unlock_output_file(of);
 
-        if (ost->finished ||
-            (os->pb && avio_tell(os->pb) >= of->limit_filesize))
+        if (finished)
             continue;
-        if (ost->frame_number >= ost->max_frames) {
+        if (frame_number >= ost->max_frames) {
             int j;
             for (j = 0; j < of->ctx->nb_streams; j++)
                 close_output_stream(output_streams[of->ost_index + j]);
@@ -3065,9 +3388,16 @@ static OutputStream *choose_output(void)
 
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost = output_streams[i];
-        int64_t opts = av_rescale_q(ost->st->cur_dts, ost->st->time_base,
-                                    AV_TIME_BASE_Q);
-        if (!ost->unavailable && !ost->finished && opts < opts_min) {
+        OutputFile    *of = output_files[ost->file_index];
+        int64_t opts;
+        int finished;
+
+        lock_output_file(of);
+        opts     = av_rescale_q(ost->st->cur_dts, ost->st->time_base,
+                                AV_TIME_BASE_Q);
+        finished = ost->finished;
+        unlock_output_file(of);
+        if (!ost->unavailable && !finished && opts < opts_min) {
             opts_min = opts;
             ost_min  = ost;
         }
@@ -3642,6 +3972,8 @@ static int transcode(void)
 #if HAVE_PTHREADS
     if ((ret = init_input_threads()) < 0)
         goto fail;
+    if ((ret = init_encoder_threads()) < 0)
+        goto fail;
 #endif
 
     while (!received_sigterm) {
@@ -3652,6 +3984,10 @@ static int transcode(void)
             if (check_keyboard_interaction(cur_time) < 0)
                 break;
 
+#if HAVE_PTHREADS
+        check_encoder_threads();
+#endif
+
         /* check if there's any stream where output is still needed */
         if (!need_output()) {
             av_log(NULL, AV_LOG_VERBOSE, "No more output streams to write to, finishing.\n");
@@ -3681,6 +4017,9 @@ static int transcode(void)
             output_packet(ist, NULL);
         }
     }
+#if HAVE_PTHREADS
+    free_encoder_threads();
+#endif
     flush_encoders();
 
     term_exit();
@@ -3718,6 +4057,7 @@ static int transcode(void)
  fail:
 #if HAVE_PTHREADS
     free_input_threads();
+    free_encoder_threads();
 #endif
 
     if (output_streams) {
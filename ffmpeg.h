@@ -437,6 +437,17 @@ typedef struct OutputStream {
     // number of frames/samples sent to the encoder
     uint64_t frames_encoded;
     uint64_t samples_encoded;
+    // encoder state shown by print_report(), copied by update_encoder_stats()
+    int has_coded_frame;
+    int coded_quality;
+    uint64_t coded_error[3];   // error of the last coded frame
+    uint64_t error[3];         // error summed over all coded frames
+
+#if HAVE_PTHREADS
+    AVThreadMessageQueue *enc_thread_queue; /* filtered frames waiting to be encoded */
+    pthread_t enc_thread;                   /* thread encoding and muxing this stream */
+    int enc_thread_failed;                  /* the encoder thread exited on a fatal error */
+#endif
 } OutputStream;
 
 typedef struct OutputFile {
@@ -448,6 +459,12 @@ typedef struct OutputFile {
     uint64_t limit_filesize; /* filesize limit expressed in bytes */
 
     int shortest;
+
+#if HAVE_PTHREADS
+    pthread_mutex_t mux_lock;   /* serializes muxing and guards the finished, frame_number,
+                                   recording_time and encoder stats fields when encoders
+                                   run in threads */
+#endif
 } OutputFile;
 
 extern InputStream **input_streams;
@@ -487,6 +504,7 @@ extern int stdin_interaction;
 extern int frame_bits_per_raw_sample;
 extern AVIOContext *progress_avio;
 extern float max_error_rate;
+extern int threaded_encoding;
 
 extern const AVIOInterruptCB int_cb;
 
@@ -111,6 +111,10 @@ static const char *http_state[] = {
 
 #define IOBUFFER_INIT_SIZE 8192
 
+/* maximum amount of data sent to a TCP client in one go, so that a fast
+ * client does not delay the others */
+#define SEND_BURST_SIZE (256 * 1024)
+
 /* timeouts are in ms */
 #define HTTP_REQUEST_TIMEOUT (15 * 1000)
 #define RTSP_REQUEST_TIMEOUT (3600 * 24 * 1000)
@@ -127,6 +131,19 @@ typedef struct {
     int64_t time1, time2;
 } DataRateData;
 
+/* number of packets of a feed kept in memory for the connections reading it */
+#define FEED_RING_SIZE 1024
+
+/* packets of a feed, read once from the feed file and shared by reference by
+ * all the connections streaming it live */
+typedef struct FeedRing {
+    AVFormatContext *fmt_in; /* the only reader of the feed file */
+    AVPacket pkts[FEED_RING_SIZE];
+    int64_t head; /* sequence number of the next packet to read */
+    int64_t tail; /* sequence number of the oldest packet still kept */
+    int nb_readers;
+} FeedRing;
+
 /* context associated with one connection */
 typedef struct HTTPContext {
     enum HTTPState state;
@@ -146,6 +163,8 @@ typedef struct HTTPContext {
     int feed_fd;
     /* input format handling */
     AVFormatContext *fmt_in;
+    FeedRing *ring;    /* shared feed packets used instead of fmt_in if set */
+    int64_t ring_pos;  /* sequence number of the next packet to send from ring */
     int64_t start_time;            /* In milliseconds - this wraps fairly often */
     int64_t first_pts;            /* initial pts value */
     int64_t cur_pts;             /* current pts value from the stream in us */
@@ -256,6 +275,7 @@ typedef struct FFStream {
     int64_t feed_max_size;      /* maximum storage size, zero means unlimited */
     int64_t feed_write_index;   /* current write position in feed (it wraps around) */
     int64_t feed_size;          /* current size of feed */
+    FeedRing *ring;             /* packets shared by the live connections */
     struct FFStream *next_feed;
 } FFStream;
 
@@ -281,6 +301,7 @@ static int http_parse_request(HTTPContext *c);
 static int http_send_data(HTTPContext *c);
 static void compute_status(HTTPContext *c);
 static int open_input_stream(HTTPContext *c, const char *info);
+static void feed_ring_leave(HTTPContext *c);
 static int http_start_receive_data(HTTPContext *c);
 static int http_receive_data(HTTPContext *c);
 
@@ -898,6 +919,7 @@ static void close_connection(HTTPContext *c)
     /* remove connection associated resources */
     if (c->fd >= 0)
         closesocket(c->fd);
+    feed_ring_leave(c);
     if (c->fmt_in) {
         /* close each frame parser */
         for(i=0;i<c->fmt_in->nb_streams;i++) {
@@ -976,9 +998,9 @@ static int handle_connection(HTTPContext *c)
         /* no need to read if no events */
         if (!(c->poll_entry->revents & POLLIN))
             return 0;
-        /* read the data */
-    read_loop:
-        len = recv(c->fd, c->buffer_ptr, 1, 0);
+        /* look at the data without consuming it: what follows the
+         * request (e.g. the body of a feed POST) must stay in the socket */
+        len = recv(c->fd, c->buffer_ptr, c->buffer_end - c->buffer_ptr, MSG_PEEK);
         if (len < 0) {
             if (ff_neterrno() != AVERROR(EAGAIN) &&
                 ff_neterrno() != AVERROR(EINTR))
@@ -987,11 +1009,19 @@ static int handle_connection(HTTPContext *c)
             return -1;
         } else {
             /* search for end of request. */
-            uint8_t *ptr;
-            c->buffer_ptr += len;
-            ptr = c->buffer_ptr;
-            if ((ptr >= c->buffer + 2 && !memcmp(ptr-2, "\n\n", 2)) ||
-                (ptr >= c->buffer + 4 && !memcmp(ptr-4, "\r\n\r\n", 4))) {
+            uint8_t *ptr = c->buffer_ptr, *end = c->buffer_ptr + len;
+            int found = 0;
+            while (ptr < end && !found) {
+                ptr++;
+                found = (ptr >= c->buffer + 2 && !memcmp(ptr-2, "\n\n", 2)) ||
+                        (ptr >= c->buffer + 4 && !memcmp(ptr-4, "\r\n\r\n", 4));
+            }
+            /* now read what belongs to the request */
+            len = recv(c->fd, c->buffer_ptr, ptr - c->buffer_ptr, 0);
+            if (len != ptr - c->buffer_ptr)
+                return -1;
+            c->buffer_ptr = ptr;
+            if (found) {
                 /* request found : parse it and reply */
                 if (c->state == HTTPSTATE_WAIT_REQUEST) {
                     ret = http_parse_request(c);
@@ -1003,7 +1033,7 @@ static int handle_connection(HTTPContext *c)
             } else if (ptr >= c->buffer_end) {
                 /* request too long: cannot do anything */
                 return -1;
-            } else goto read_loop;
+            }
         }
         break;
 
@@ -2185,12 +2215,164 @@ static void compute_status(HTTPContext *c)
     c->buffer_end = c->pb_buffer + len;
 }
 
+/* choose stream as clock source (we favor the video stream if present) for
+ * packet sending */
+static void choose_pts_stream(HTTPContext *c)
+{
+    int i;
+
+    c->pts_stream_index = 0;
+    for(i=0;i<c->stream->nb_streams;i++) {
+        if (c->pts_stream_index == 0 &&
+            c->stream->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
+            c->pts_stream_index = i;
+        }
+    }
+}
+
+static void feed_ring_free(FFStream *feed)
+{
+    FeedRing *ring = feed->ring;
+    int i;
+
+    if (!ring)
+        return;
+    for (; ring->tail < ring->head; ring->tail++)
+        av_free_packet(&ring->pkts[ring->tail % FEED_RING_SIZE]);
+    for (i = 0; i < ring->fmt_in->nb_streams; i++)
+        if (ring->fmt_in->streams[i]->codec->codec)
+            avcodec_close(ring->fmt_in->streams[i]->codec);
+    avformat_close_input(&ring->fmt_in);
+    av_freep(&feed->ring);
+}
+
+static void feed_ring_leave(HTTPContext *c)
+{
+    FeedRing *ring = c->ring;
+
+    if (!ring)
+        return;
+    c->ring = NULL;
+    /* the next connection starts over at its prebuffer position */
+    if (!--ring->nb_readers)
+        feed_ring_free(c->stream->feed);
+}
+
+/* time of a packet of the ring in us, AV_NOPTS_VALUE if unknown */
+static int64_t feed_ring_time(FeedRing *ring, int64_t pos)
+{
+    AVPacket *pkt = &ring->pkts[pos % FEED_RING_SIZE];
+
+    if (pkt->dts == AV_NOPTS_VALUE)
+        return AV_NOPTS_VALUE;
+    return av_rescale_q(pkt->dts, ring->fmt_in->streams[pkt->stream_index]->time_base,
+                        AV_TIME_BASE_Q);
+}
+
+/**
+ * Make c read the packets of its feed from the ring of the feed, opening it
+ * at stream_pos (absolute time in us) if no connection reads it yet, else
+ * starting at the same distance from the last packet read as stream_pos is
+ * from now.
+ */
+static int feed_ring_join(HTTPContext *c, int64_t stream_pos)
+{
+    FFStream *feed = c->stream->feed;
+    FeedRing *ring = feed->ring;
+    int ret;
+
+    if (!ring) {
+        ring = av_mallocz(sizeof(*ring));
+        if (!ring)
+            return AVERROR(ENOMEM);
+        if ((ret = avformat_open_input(&ring->fmt_in, feed->feed_filename, NULL, NULL)) < 0) {
+            http_log("Could not open input '%s': %s\n", feed->feed_filename, av_err2str(ret));
+            av_free(ring);
+            return ret;
+        }
+        ffio_set_buf_size(ring->fmt_in->pb, FFM_PACKET_SIZE);
+        ring->fmt_in->flags |= AVFMT_FLAG_GENPTS;
+        if (ring->fmt_in->iformat->read_seek)
+            av_seek_frame(ring->fmt_in, -1, stream_pos, 0);
+        feed->ring = ring;
+        c->ring_pos = ring->head;
+    } else {
+        int64_t last = AV_NOPTS_VALUE, pos, t;
+
+        for (pos = ring->head - 1; pos >= ring->tail && last == AV_NOPTS_VALUE; pos--)
+            last = feed_ring_time(ring, pos);
+        c->ring_pos = ring->head;
+        for (pos = ring->tail; last != AV_NOPTS_VALUE && pos < ring->head; pos++) {
+            t = feed_ring_time(ring, pos);
+            if (t != AV_NOPTS_VALUE && t >= last - (av_gettime() - stream_pos)) {
+                c->ring_pos = pos;
+                break;
+            }
+        }
+    }
+    ring->nb_readers++;
+    c->ring = ring;
+
+    choose_pts_stream(c);
+    /* set the start time (needed for maxtime and RTP packet timing) */
+    c->start_time = cur_time;
+    c->first_pts = AV_NOPTS_VALUE;
+    return 0;
+}
+
+/**
+ * Get the next packet of c from the ring of its feed, reading it from the
+ * feed file if c is the first to need it. The ring is never held back by a
+ * connection: one that fell out of it goes on at the first video keyframe
+ * still kept.
+ */
+static int feed_ring_read(HTTPContext *c, AVPacket *pkt)
+{
+    FeedRing *ring = c->ring;
+    FFStream *feed = c->stream->feed;
+    int ret;
+
+    if (c->ring_pos < ring->tail) {
+        int64_t pos;
+
+        for (pos = ring->tail; pos < ring->head; pos++) {
+            AVPacket *p = &ring->pkts[pos % FEED_RING_SIZE];
+            if (p->flags & AV_PKT_FLAG_KEY &&
+                ring->fmt_in->streams[p->stream_index]->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+                break;
+        }
+        if (pos == ring->head)
+            pos = ring->tail;
+        if (!c->suppress_log)
+            http_log("%s: too slow for feed '%s', skipping %"PRId64" packets\n",
+                     inet_ntoa(c->from_addr.sin_addr), feed->filename, pos - c->ring_pos);
+        c->ring_pos = pos;
+    }
+
+    if (c->ring_pos == ring->head) {
+        AVPacket tmp;
+
+        ffm_set_write_index(ring->fmt_in, feed->feed_write_index, feed->feed_size);
+        if ((ret = av_read_frame(ring->fmt_in, &tmp)) < 0)
+            return ret;
+        if ((ret = av_dup_packet(&tmp)) < 0) {
+            av_free_packet(&tmp);
+            return ret;
+        }
+        if (ring->head - ring->tail == FEED_RING_SIZE)
+            av_free_packet(&ring->pkts[ring->tail++ % FEED_RING_SIZE]);
+        ring->pkts[ring->head++ % FEED_RING_SIZE] = tmp;
+    }
+
+    return av_packet_ref(pkt, &ring->pkts[c->ring_pos++ % FEED_RING_SIZE]);
+}
+
 static int open_input_stream(HTTPContext *c, const char *info)
 {
     char buf[128];
     char input_filename[1024];
     AVFormatContext *s = NULL;
-    int buf_size, i, ret;
+    int buf_size, ret, shared = 0;
     int64_t stream_pos;
 
     /* find file name */
@@ -2206,8 +2388,11 @@ static int open_input_stream(HTTPContext *c, const char *info)
         } else if (av_find_info_tag(buf, sizeof(buf), "buffer", info)) {
             int prebuffer = strtol(buf, 0, 10);
             stream_pos = av_gettime() - prebuffer * (int64_t)1000000;
-        } else
+        } else {
             stream_pos = av_gettime() - c->stream->prebuffer * (int64_t)1000;
+            /* live from the feed: read it once for all such connections */
+            shared = !c->stream->ifmt && !c->stream->in_opts;
+        }
     } else {
         strcpy(input_filename, c->stream->feed_filename);
         buf_size = 0;
@@ -2225,6 +2410,9 @@ static int open_input_stream(HTTPContext *c, const char *info)
         return AVERROR(EINVAL);
     }
 
+    if (shared)
+        return feed_ring_join(c, stream_pos);
+
     /* open stream */
     if ((ret = avformat_open_input(&s, input_filename, c->stream->ifmt, &c->stream->in_opts)) < 0) {
         http_log("Could not open input '%s': %s\n", input_filename, av_err2str(ret));
@@ -2243,15 +2431,7 @@ static int open_input_stream(HTTPContext *c, const char *info)
         return ret;
     }
 
-    /* choose stream as clock source (we favor the video stream if
-     * present) for packet sending */
-    c->pts_stream_index = 0;
-    for(i=0;i<c->stream->nb_streams;i++) {
-        if (c->pts_stream_index == 0 &&
-            c->stream->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
-            c->pts_stream_index = i;
-        }
-    }
+    choose_pts_stream(c);
 
     if (c->fmt_in->iformat->read_seek)
         av_seek_frame(c->fmt_in, -1, stream_pos, 0);
@@ -2288,7 +2468,7 @@ static int64_t get_packet_send_clock(HTTPContext *c)
 static int http_prepare_data(HTTPContext *c)
 {
     int i, len, ret;
-    AVFormatContext *ctx;
+    AVFormatContext *ctx, *in;
 
     av_freep(&c->pb_buffer);
     switch(c->state) {
@@ -2351,7 +2531,7 @@ static int http_prepare_data(HTTPContext *c)
     case HTTPSTATE_SEND_DATA:
         /* find a new packet */
         /* read a packet from the input stream */
-        if (c->stream->feed)
+        if (c->stream->feed && !c->ring)
             ffm_set_write_index(c->fmt_in,
                                 c->stream->feed->feed_write_index,
                                 c->stream->feed->feed_size);
@@ -2363,7 +2543,8 @@ static int http_prepare_data(HTTPContext *c)
         else {
             AVPacket pkt;
         redo:
-            ret = av_read_frame(c->fmt_in, &pkt);
+            in  = c->ring ? c->ring->fmt_in : c->fmt_in;
+            ret = c->ring ? feed_ring_read(c, &pkt) : av_read_frame(in, &pkt);
             if (ret < 0) {
                 if (c->stream->feed) {
                     /* if coming from feed, it means we reached the end of the
@@ -2389,7 +2570,7 @@ static int http_prepare_data(HTTPContext *c)
                 int source_index = pkt.stream_index;
                 /* update first pts if needed */
                 if (c->first_pts == AV_NOPTS_VALUE) {
-                    c->first_pts = av_rescale_q(pkt.dts, c->fmt_in->streams[pkt.stream_index]->time_base, AV_TIME_BASE_Q);
+                    c->first_pts = av_rescale_q(pkt.dts, in->streams[pkt.stream_index]->time_base, AV_TIME_BASE_Q);
                     c->start_time = cur_time;
                 }
                 /* send it to the appropriate stream */
@@ -2407,7 +2588,7 @@ static int http_prepare_data(HTTPContext *c)
                     }
                     for(i=0;i<c->stream->nb_streams;i++) {
                         if (c->stream->feed_streams[i] == pkt.stream_index) {
-                            AVStream *st = c->fmt_in->streams[source_index];
+                            AVStream *st = in->streams[source_index];
                             pkt.stream_index = i;
                             if (pkt.flags & AV_PKT_FLAG_KEY &&
                                 (st->codec->codec_type == AVMEDIA_TYPE_VIDEO ||
@@ -2421,7 +2602,7 @@ static int http_prepare_data(HTTPContext *c)
                     AVCodecContext *codec;
                     AVStream *ist, *ost;
                 send_it:
-                    ist = c->fmt_in->streams[source_index];
+                    ist = in->streams[source_index];
                     /* specific handling for RTP: we use several
                      * output streams (one for each RTP connection).
                      * XXX: need more abstract handling */
@@ -2517,7 +2698,7 @@ static int http_prepare_data(HTTPContext *c)
  * (either UDP or TCP) */
 static int http_send_data(HTTPContext *c)
 {
-    int len, ret;
+    int len, ret, sent = 0;
 
     for(;;) {
         if (c->buffer_ptr >= c->buffer_end) {
@@ -2627,7 +2808,11 @@ static int http_send_data(HTTPContext *c)
                 update_datarate(&c->datarate, c->data_count);
                 if (c->stream)
                     c->stream->bytes_served += len;
-                break;
+                /* go on with the next packet as long as the client keeps
+                 * up, instead of waiting for the next poll() for each */
+                sent += len;
+                if (c->buffer_ptr < c->buffer_end || sent >= SEND_BURST_SIZE)
+                    break;
             }
         }
     } /* for(;;) */
@@ -701,6 +701,18 @@ static void search_for_quantizers_anmr(AVCodecContext *avctx, AACEncContext *s,
                 sce->sf_idx[(w+w2)*16+g] = sce->sf_idx[w*16+g];
 }
 
+#define BAND_COST_CACHE_SIZE 4
+
+/**
+ * Distortion and bits of a window group band for recently tried
+ * scalefactors, direct mapped on the scalefactor.
+ */
+typedef struct BandCostCache {
+    int   sf  [BAND_COST_CACHE_SIZE]; ///< scalefactor of the entry, -1 if unused
+    int   bits[BAND_COST_CACHE_SIZE];
+    float dist[BAND_COST_CACHE_SIZE];
+} BandCostCache;
+
 /**
  * two-loop quantizers search taken from ISO 13818-7 Appendix C
  */
@@ -713,6 +725,7 @@ static void search_for_quantizers_twoloop(AVCodecContext *avctx,
     int destbits = avctx->bit_rate * 1024.0 / avctx->sample_rate / avctx->channels * (lambda / 120.f);
     float dists[128] = { 0 }, uplims[128];
     float maxvals[128];
+    BandCostCache cost_cache[128];
     int fflag, minscaler;
     int its  = 0;
     int allz = 0;
@@ -763,6 +776,8 @@ static void search_for_quantizers_twoloop(AVCodecContext *avctx,
             const float *scaled = s->scoefs + start;
             maxvals[w*16+g] = find_max_val(sce->ics.group_len[w], sce->ics.swb_sizes[g], scaled);
             start += sce->ics.swb_sizes[g];
+            for (i = 0; i < BAND_COST_CACHE_SIZE; i++)
+                cost_cache[w*16+g].sf[i] = -1;
         }
     }
 
@@ -781,27 +796,39 @@ static void search_for_quantizers_twoloop(AVCodecContext *avctx,
                 for (g = 0;  g < sce->ics.num_swb; g++) {
                     const float *coefs = sce->coeffs + start;
                     const float *scaled = s->scoefs + start;
+                    BandCostCache *cache = &cost_cache[w*16+g];
+                    int sf = sce->sf_idx[w*16+g];
+                    int slot = sf & (BAND_COST_CACHE_SIZE - 1);
                     int bits = 0;
                     int cb;
                     float dist = 0.0f;
 
-                    if (sce->zeroes[w*16+g] || sce->sf_idx[w*16+g] >= 218) {
+                    if (sce->zeroes[w*16+g] || sf >= 218) {
                         start += sce->ics.swb_sizes[g];
                         continue;
                     }
-                    minscaler = FFMIN(minscaler, sce->sf_idx[w*16+g]);
-                    cb = find_min_book(maxvals[w*16+g], sce->sf_idx[w*16+g]);
-                    for (w2 = 0; w2 < sce->ics.group_len[w]; w2++) {
-                        int b;
-                        dist += quantize_band_cost(s, coefs + w2*128,
-                                                   scaled + w2*128,
-                                                   sce->ics.swb_sizes[g],
-                                                   sce->sf_idx[w*16+g],
-                                                   cb,
-                                                   1.0f,
-                                                   INFINITY,
-                                                   &b);
-                        bits += b;
+                    minscaler = FFMIN(minscaler, sf);
+                    if (cache->sf[slot] == sf) {
+                        /* the inner loop often revisits a scalefactor */
+                        dist = cache->dist[slot];
+                        bits = cache->bits[slot];
+                    } else {
+                        cb = find_min_book(maxvals[w*16+g], sf);
+                        for (w2 = 0; w2 < sce->ics.group_len[w]; w2++) {
+                            int b;
+                            dist += quantize_band_cost(s, coefs + w2*128,
+                                                       scaled + w2*128,
+                                                       sce->ics.swb_sizes[g],
+                                                       sf,
+                                                       cb,
+                                                       1.0f,
+                                                       INFINITY,
+                                                       &b);
+                            bits += b;
+                        }
+                        cache->sf  [slot] = sf;
+                        cache->dist[slot] = dist;
+                        cache->bits[slot] = bits;
                     }
                     dists[w*16+g] = dist - bits;
                     if (prev != -1) {
@@ -45,8 +45,6 @@
 
 #include "psymodel.h"
 
-#define AAC_MAX_CHANNELS 6
-
 #define ERROR_IF(cond, ...) \
     if (cond) { \
         av_log(avctx, AV_LOG_ERROR, __VA_ARGS__); \
@@ -501,6 +499,18 @@ static void copy_input_samples(AACEncContext *s, const AVFrame *frame)
     }
 }
 
+static int search_for_quantizers_thread(AVCodecContext *avctx, void *arg,
+                                        int jobnr, int threadnr)
+{
+    AACEncContext *s = avctx->priv_data;
+    AACEncContext *t = s->thread[threadnr];
+    SingleChannelElement **sce = arg;
+
+    t->cur_channel = jobnr;
+    s->coder->search_for_quantizers(avctx, t, sce[jobnr], s->lambda);
+    return 0;
+}
+
 static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                             const AVFrame *frame, int *got_packet_ptr)
 {
@@ -510,6 +520,7 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
     int i, ch, w, g, chans, tag, start_ch, ret;
     int chan_el_counter[4];
     FFPsyWindowInfo windows[AAC_MAX_CHANNELS];
+    SingleChannelElement *sces[AAC_MAX_CHANNELS];
 
     if (s->last_frame == 2)
         return 0;
@@ -580,22 +591,32 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
         if ((avctx->frame_number & 0xFF)==1 && !(avctx->flags & CODEC_FLAG_BITEXACT))
             put_bitstream_info(s, LIBAVCODEC_IDENT);
         start_ch = 0;
-        memset(chan_el_counter, 0, sizeof(chan_el_counter));
         for (i = 0; i < s->chan_map[0]; i++) {
             FFPsyWindowInfo* wi = windows + start_ch;
             const float *coeffs[2];
+            chans    = s->chan_map[i+1] == TYPE_CPE ? 2 : 1;
+            cpe      = &s->cpe[i];
+            for (ch = 0; ch < chans; ch++) {
+                coeffs[ch]          = cpe->ch[ch].coeffs;
+                sces[start_ch + ch] = &cpe->ch[ch];
+            }
+            s->psy.model->analyze(&s->psy, start_ch, coeffs, wi);
+            start_ch += chans;
+        }
+        /* the quantizer search of each channel only depends on its own
+         * coefficients and psy bands, so the channels are searched in
+         * parallel with slice threads */
+        avctx->execute2(avctx, search_for_quantizers_thread, sces, NULL,
+                        s->channels);
+        start_ch = 0;
+        memset(chan_el_counter, 0, sizeof(chan_el_counter));
+        for (i = 0; i < s->chan_map[0]; i++) {
+            FFPsyWindowInfo* wi = windows + start_ch;
             tag      = s->chan_map[i+1];
             chans    = tag == TYPE_CPE ? 2 : 1;
             cpe      = &s->cpe[i];
             put_bits(&s->pb, 3, tag);
             put_bits(&s->pb, 4, chan_el_counter[tag]++);
-            for (ch = 0; ch < chans; ch++)
-                coeffs[ch] = cpe->ch[ch].coeffs;
-            s->psy.model->analyze(&s->psy, start_ch, coeffs, wi);
-            for (ch = 0; ch < chans; ch++) {
-                s->cur_channel = start_ch + ch;
-                s->coder->search_for_quantizers(avctx, s, &cpe->ch[ch], s->lambda);
-            }
             cpe->common_window = 0;
             if (chans > 1
                 && wi[0].window_type[0] == wi[1].window_type[0]
@@ -670,7 +691,10 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
 static av_cold int aac_encode_end(AVCodecContext *avctx)
 {
     AACEncContext *s = avctx->priv_data;
+    int i;
 
+    for (i = 1; i < AAC_MAX_CHANNELS; i++)
+        av_freep(&s->thread[i]);
     ff_mdct_end(&s->mdct1024);
     ff_mdct_end(&s->mdct128);
     ff_psy_end(&s->psy);
@@ -779,6 +803,18 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
     avctx->delay = 1024;
     ff_af_queue_init(avctx, &s->afq);
 
+    s->thread[0] = s;
+    if (avctx->active_thread_type & FF_THREAD_SLICE) {
+        for (i = 1; i < FFMIN(avctx->thread_count, s->channels); i++) {
+            s->thread[i] = av_malloc(sizeof(AACEncContext));
+            if (!s->thread[i]) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            memcpy(s->thread[i], s, sizeof(AACEncContext));
+        }
+    }
+
     return 0;
 fail:
     aac_encode_end(avctx);
@@ -824,7 +860,7 @@ AVCodec ff_aac_encoder = {
     .close          = aac_encode_end,
     .supported_samplerates = mpeg4audio_sample_rates,
     .capabilities   = CODEC_CAP_SMALL_LAST_FRAME | CODEC_CAP_DELAY |
-                      CODEC_CAP_EXPERIMENTAL,
+                      CODEC_CAP_SLICE_THREADS | CODEC_CAP_EXPERIMENTAL,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_FLTP,
                                                      AV_SAMPLE_FMT_NONE },
     .priv_class     = &aacenc_class,
@@ -30,6 +30,8 @@
 #include "audio_frame_queue.h"
 #include "psymodel.h"
 
+#define AAC_MAX_CHANNELS 6
+
 typedef enum AACCoder {
     AAC_CODER_FAAC = 0,
     AAC_CODER_ANMR,
@@ -88,6 +90,8 @@ typedef struct AACEncContext {
     struct {
         float *samples;
     } buffer;
+
+    struct AACEncContext *thread[AAC_MAX_CHANNELS]; ///< per-thread contexts for the quantizer search
 } AACEncContext;
 
 extern float ff_aac_pow34sf_tab[428];
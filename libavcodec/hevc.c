@@ -673,6 +673,7 @@ static int hls_slice_header(HEVCContext *s)
     }
 
     sh->num_entry_point_offsets = 0;
+    s->parallel_entry_points    = 0;
     if (s->pps->tiles_enabled_flag || s->pps->entropy_coding_sync_enabled_flag) {
         sh->num_entry_point_offsets = get_ue_golomb_long(gb);
         if (sh->num_entry_point_offsets > 0) {
@@ -702,13 +703,16 @@ static int hls_slice_header(HEVCContext *s)
                 }
                 sh->entry_point_offset[i] = val + 1; // +1; // +1 to get the size
             }
-            if (s->threads_number > 1 && (s->pps->num_tile_rows > 1 || s->pps->num_tile_columns > 1)) {
-                s->enable_parallel_tiles = 0; // TODO: you can enable tiles in parallel here
-                s->threads_number = 1;
-            } else
-                s->enable_parallel_tiles = 0;
-        } else
-            s->enable_parallel_tiles = 0;
+            /* Tiles can only be decoded independently if no deblocking
+             * boundary strength has to be derived across tile edges, and
+             * wavefront rows are only handled when they span the picture. */
+            if (s->threads_number > 1) {
+                if (s->pps->entropy_coding_sync_enabled_flag)
+                    s->parallel_entry_points = !s->pps->tiles_enabled_flag;
+                else
+                    s->parallel_entry_points = !s->pps->loop_filter_across_tiles_enabled_flag;
+            }
+        }
     }
 
     if (s->pps->slice_header_extension_present_flag) {
@@ -2412,7 +2416,114 @@ static int hls_decode_entry_wpp(AVCodecContext *avctxt, void *input_ctb_row, int
     return 0;
 }
 
-static int hls_slice_data_wpp(HEVCContext *s, const uint8_t *nal, int length)
+static int hls_decode_entry_tile(AVCodecContext *avctxt, void *input_tile_start, int job, int self_id)
+{
+    HEVCContext *s1  = avctxt->priv_data, *s;
+    HEVCLocalContext *lc;
+    int more_data    = 1;
+    int *tile_start  = input_tile_start;
+    int ctb_addr_ts  = tile_start[job];
+    int tile_id      = s1->pps->tile_id[ctb_addr_ts];
+    int ret;
+
+    s  = s1->sList[self_id];
+    lc = s->HEVClc;
+
+    if (job) {
+        ret = init_get_bits8(&lc->gb, s->data + s->sh.offset[job - 1], s->sh.size[job - 1]);
+        if (ret < 0)
+            return ret;
+    }
+
+    while (ctb_addr_ts < s->sps->ctb_size &&
+           s->pps->tile_id[ctb_addr_ts] == tile_id) {
+        int ctb_addr_rs = s->pps->ctb_addr_ts_to_rs[ctb_addr_ts];
+        int x_ctb = (ctb_addr_rs % s->sps->ctb_width) << s->sps->log2_ctb_size;
+        int y_ctb = (ctb_addr_rs / s->sps->ctb_width) << s->sps->log2_ctb_size;
+
+        if (!more_data) {
+            av_log(s->avctx, AV_LOG_ERROR, "Slice segment ends inside tile %d.\n", tile_id);
+            return AVERROR_INVALIDDATA;
+        }
+
+        hls_decode_neighbour(s, x_ctb, y_ctb, ctb_addr_ts);
+
+        ff_hevc_cabac_init(s, ctb_addr_ts);
+
+        hls_sao_param(s, x_ctb >> s->sps->log2_ctb_size, y_ctb >> s->sps->log2_ctb_size);
+
+        s->deblock[ctb_addr_rs].beta_offset = s->sh.beta_offset;
+        s->deblock[ctb_addr_rs].tc_offset   = s->sh.tc_offset;
+        s->filter_slice_edges[ctb_addr_rs]  = s->sh.slice_loop_filter_across_slices_enabled_flag;
+
+        more_data = hls_coding_quadtree(s, x_ctb, y_ctb, s->sps->log2_ctb_size, 0);
+        if (more_data < 0) {
+            s->tab_slice_address[ctb_addr_rs] = -1;
+            return more_data;
+        }
+
+        ctb_addr_ts++;
+    }
+
+    if (job == s->sh.num_entry_point_offsets)
+        return ctb_addr_ts;
+    if (!more_data) {
+        av_log(s->avctx, AV_LOG_ERROR, "Slice segment ends inside tile %d.\n", tile_id);
+        return AVERROR_INVALIDDATA;
+    }
+    return 0;
+}
+
+/**
+ * Decode the tiles of the current slice segment in parallel.
+ * The in-loop filters are run afterwards, in the order the CTBs would
+ * have been filtered by hls_decode_entry().
+ */
+static int hls_slice_data_tiles(HEVCContext *s, int *tile_start, int *ret)
+{
+    int ctb_size    = 1 << s->sps->log2_ctb_size;
+    int nb_tiles    = s->sh.num_entry_point_offsets + 1;
+    int ctb_addr_ts = s->pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs];
+    int first_tile  = s->pps->tile_id[ctb_addr_ts];
+    int start_ts    = ctb_addr_ts;
+    int x_ctb = 0, y_ctb = 0;
+    int i;
+
+    /* Locate the tiles and mark their CTBs as part of this slice, so that
+     * neighbour availability does not depend on the decoding order. */
+    for (i = 0; ctb_addr_ts < s->sps->ctb_size; ctb_addr_ts++) {
+        int tile_id = s->pps->tile_id[ctb_addr_ts];
+        if (tile_id >= first_tile + nb_tiles)
+            break;
+        if (tile_id == first_tile + i)
+            tile_start[i++] = ctb_addr_ts;
+        s->tab_slice_address[s->pps->ctb_addr_ts_to_rs[ctb_addr_ts]] = s->sh.slice_addr;
+    }
+    if (i != nb_tiles) {
+        av_log(s->avctx, AV_LOG_ERROR, "Invalid number of entry points for tiles.\n");
+        return AVERROR_INVALIDDATA;
+    }
+
+    s->avctx->execute2(s->avctx, hls_decode_entry_tile, tile_start, ret, nb_tiles);
+
+    for (i = 0; i < nb_tiles; i++)
+        if (ret[i] < 0)
+            return ret[i];
+
+    for (ctb_addr_ts = start_ts; ctb_addr_ts < ret[nb_tiles - 1]; ctb_addr_ts++) {
+        int ctb_addr_rs = s->pps->ctb_addr_ts_to_rs[ctb_addr_ts];
+        x_ctb = (ctb_addr_rs % s->sps->ctb_width) << s->sps->log2_ctb_size;
+        y_ctb = (ctb_addr_rs / s->sps->ctb_width) << s->sps->log2_ctb_size;
+        ff_hevc_hls_filters(s, x_ctb, y_ctb, ctb_size);
+    }
+    if (x_ctb + ctb_size >= s->sps->width &&
+        y_ctb + ctb_size >= s->sps->height)
+        ff_hevc_hls_filter(s, x_ctb, y_ctb, ctb_size);
+
+    return ret[nb_tiles - 1];
+}
+
+static int hls_slice_data_parallel(HEVCContext *s, const uint8_t *nal, int length)
 {
     HEVCLocalContext *lc = s->HEVClc;
     int *ret = av_malloc_array(s->sh.num_entry_point_offsets + 1, sizeof(int));
@@ -2421,6 +2532,11 @@ static int hls_slice_data_wpp(HEVCContext *s, const uint8_t *nal, int length)
     int startheader, cmpt = 0;
     int i, j, res = 0;
 
+    if (!ret || !arg) {
+        av_free(ret);
+        av_free(arg);
+        return AVERROR(ENOMEM);
+    }
 
     if (!s->sList[1]) {
         ff_alloc_entries(s->avctx, s->sh.num_entry_point_offsets + 1);
@@ -2479,11 +2595,13 @@ static int hls_slice_data_wpp(HEVCContext *s, const uint8_t *nal, int length)
         ret[i] = 0;
     }
 
-    if (s->pps->entropy_coding_sync_enabled_flag)
+    if (s->pps->entropy_coding_sync_enabled_flag) {
         s->avctx->execute2(s->avctx, (void *) hls_decode_entry_wpp, arg, ret, s->sh.num_entry_point_offsets + 1);
 
-    for (i = 0; i <= s->sh.num_entry_point_offsets; i++)
-        res += ret[i];
+        for (i = 0; i <= s->sh.num_entry_point_offsets; i++)
+            res += ret[i];
+    } else
+        res = hls_slice_data_tiles(s, arg, ret);
     av_free(ret);
     av_free(arg);
     return res;
@@ -2724,8 +2842,8 @@ static int decode_nal_unit(HEVCContext *s, const uint8_t *nal, int length)
             }
         }
 
-        if (s->threads_number > 1 && s->sh.num_entry_point_offsets > 0)
-            ctb_addr_ts = hls_slice_data_wpp(s, nal, length);
+        if (s->parallel_entry_points)
+            ctb_addr_ts = hls_slice_data_parallel(s, nal, length);
         else
             ctb_addr_ts = hls_slice_data(s);
         if (ctb_addr_ts >= (s->sps->ctb_width * s->sps->ctb_height)) {
@@ -3401,7 +3519,7 @@ static av_cold int hevc_decode_init(AVCodecContext *avctx)
     if (ret < 0)
         return ret;
 
-    s->enable_parallel_tiles = 0;
+    s->parallel_entry_points = 0;
     s->picture_struct = 0;
 
     if(avctx->active_thread_type & FF_THREAD_SLICE)
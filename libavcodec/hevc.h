@@ -886,7 +886,7 @@ typedef struct HEVCContext {
     uint16_t seq_decode;
     uint16_t seq_output;
 
-    int enable_parallel_tiles;
+    int parallel_entry_points; ///< the substreams of the slice segment are decoded in parallel
     int wpp_err;
     int skipped_bytes;
     int *skipped_bytes_pos;
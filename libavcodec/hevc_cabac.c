@@ -572,7 +572,7 @@ void ff_hevc_cabac_init(HEVCContext *s, int ctb_addr_ts)
     } else {
         if (s->pps->tiles_enabled_flag &&
             s->pps->tile_id[ctb_addr_ts] != s->pps->tile_id[ctb_addr_ts - 1]) {
-            if (s->threads_number == 1)
+            if (!s->parallel_entry_points)
                 cabac_reinit(s->HEVClc);
             else
                 cabac_init_decoder(s);
@@ -581,7 +581,7 @@ void ff_hevc_cabac_init(HEVCContext *s, int ctb_addr_ts)
         if (s->pps->entropy_coding_sync_enabled_flag) {
             if (ctb_addr_ts % s->sps->ctb_width == 0) {
                 get_cabac_terminate(&s->HEVClc->cc);
-                if (s->threads_number == 1)
+                if (!s->parallel_entry_points)
                     cabac_reinit(s->HEVClc);
                 else
                     cabac_init_decoder(s);
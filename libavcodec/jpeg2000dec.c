@@ -63,6 +63,15 @@ typedef struct Jpeg2000Tile {
     uint16_t tp_idx;                    // Tile-part index
 } Jpeg2000Tile;
 
+/* A code-block to decode, with what it needs from the tile. */
+typedef struct Jpeg2000CblkJob {
+    Jpeg2000Component   *comp;
+    Jpeg2000CodingStyle *codsty;
+    Jpeg2000Band        *band;
+    Jpeg2000Cblk        *cblk;
+    int                 bandpos;
+} Jpeg2000CblkJob;
+
 typedef struct Jpeg2000DecoderContext {
     AVClass         *class;
     AVCodecContext  *avctx;
@@ -94,6 +103,9 @@ typedef struct Jpeg2000DecoderContext {
 
     Jpeg2000Tile    *tile;
 
+    Jpeg2000CblkJob *cblk_jobs;
+    unsigned int    cblk_jobs_size;
+
     /*options parameters*/
     int             reduction_factor;
 } Jpeg2000DecoderContext;
@@ -1213,6 +1225,41 @@ static void mct_decode(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile)
     }
 }
 
+static int decode_cblk_job(AVCodecContext *avctx, void *arg,
+                           int jobnr, int threadnr)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+    Jpeg2000CblkJob *job      = (Jpeg2000CblkJob *)arg + jobnr;
+    Jpeg2000Cblk *cblk        = job->cblk;
+    Jpeg2000T1Context t1;
+    int x, y;
+
+    decode_cblk(s, job->codsty, &t1, cblk,
+                cblk->coord[0][1] - cblk->coord[0][0],
+                cblk->coord[1][1] - cblk->coord[1][0],
+                job->bandpos);
+
+    x = cblk->coord[0][0];
+    y = cblk->coord[1][0];
+
+    if (job->codsty->transform == FF_DWT97)
+        dequantization_float(x, y, cblk, job->comp, &t1, job->band);
+    else
+        dequantization_int(x, y, cblk, job->comp, &t1, job->band);
+    return 0;
+}
+
+static int dwt_decode_job(AVCodecContext *avctx, void *arg,
+                          int jobnr, int threadnr)
+{
+    Jpeg2000Tile *tile          = arg;
+    Jpeg2000Component *comp     = tile->comp   + jobnr;
+    Jpeg2000CodingStyle *codsty = tile->codsty + jobnr;
+
+    ff_dwt_decode(&comp->dwt, codsty->transform == FF_DWT97 ? (void*)comp->f_data : (void*)comp->i_data);
+    return 0;
+}
+
 static int jpeg2000_decode_tile(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile,
                                 AVFrame *picture)
 {
@@ -1221,11 +1268,12 @@ static int jpeg2000_decode_tile(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile,
     int x, y;
     int planar    = !!(pixdesc->flags & AV_PIX_FMT_FLAG_PLANAR);
     int pixelsize = planar ? 1 : pixdesc->nb_components;
+    int nb_cblk_jobs = 0;
 
     uint8_t *line;
-    Jpeg2000T1Context t1;
 
-    /* Loop on tile components */
+    /* Collect the code-blocks of all tile components; they are decoded
+     * independently of each other, in parallel with slice threads */
     for (compno = 0; compno < s->ncomponents; compno++) {
         Jpeg2000Component *comp     = tile->comp + compno;
         Jpeg2000CodingStyle *codsty = tile->codsty + compno;
@@ -1249,32 +1297,37 @@ static int jpeg2000_decode_tile(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile,
                 /* Loop on precincts */
                 for (precno = 0; precno < nb_precincts; precno++) {
                     Jpeg2000Prec *prec = band->prec + precno;
+                    int nb_cblks = prec->nb_codeblocks_width * prec->nb_codeblocks_height;
+                    Jpeg2000CblkJob *jobs;
+
+                    if (nb_cblk_jobs + nb_cblks > INT_MAX / sizeof(*jobs))
+                        return AVERROR_INVALIDDATA;
+                    jobs = av_fast_realloc(s->cblk_jobs, &s->cblk_jobs_size,
+                                           (nb_cblk_jobs + nb_cblks) * sizeof(*jobs));
+                    if (!jobs)
+                        return AVERROR(ENOMEM);
+                    s->cblk_jobs = jobs;
 
                     /* Loop on codeblocks */
-                    for (cblkno = 0; cblkno < prec->nb_codeblocks_width * prec->nb_codeblocks_height; cblkno++) {
-                        int x, y;
-                        Jpeg2000Cblk *cblk = prec->cblk + cblkno;
-                        decode_cblk(s, codsty, &t1, cblk,
-                                    cblk->coord[0][1] - cblk->coord[0][0],
-                                    cblk->coord[1][1] - cblk->coord[1][0],
-                                    bandpos);
-
-                        x = cblk->coord[0][0];
-                        y = cblk->coord[1][0];
-
-                        if (codsty->transform == FF_DWT97)
-                            dequantization_float(x, y, cblk, comp, &t1, band);
-                        else
-                            dequantization_int(x, y, cblk, comp, &t1, band);
-                   } /* end cblk */
+                    for (cblkno = 0; cblkno < nb_cblks; cblkno++) {
+                        Jpeg2000CblkJob *job = &jobs[nb_cblk_jobs++];
+                        job->comp    = comp;
+                        job->codsty  = codsty;
+                        job->band    = band;
+                        job->cblk    = prec->cblk + cblkno;
+                        job->bandpos = bandpos;
+                    } /* end cblk */
                 } /*end prec */
             } /* end band */
         } /* end reslevel */
-
-        /* inverse DWT */
-        ff_dwt_decode(&comp->dwt, codsty->transform == FF_DWT97 ? (void*)comp->f_data : (void*)comp->i_data);
     } /*end comp */
 
+    s->avctx->execute2(s->avctx, decode_cblk_job, s->cblk_jobs, NULL,
+                       nb_cblk_jobs);
+
+    /* inverse DWT, one component per job */
+    s->avctx->execute2(s->avctx, dwt_decode_job, tile, NULL, s->ncomponents);
+
     /* inverse MCT transformation */
     if (tile->codsty[0].mct)
         mct_decode(s, tile);
@@ -1692,6 +1745,15 @@ end:
     return ret;
 }
 
+static av_cold int jpeg2000_decode_end(AVCodecContext *avctx)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+
+    av_freep(&s->cblk_jobs);
+    s->cblk_jobs_size = 0;
+    return 0;
+}
+
 static av_cold void jpeg2000_init_static_data(AVCodec *codec)
 {
     ff_jpeg2000_init_tier1_luts();
@@ -1728,10 +1790,11 @@ AVCodec ff_jpeg2000_decoder = {
     .long_name        = NULL_IF_CONFIG_SMALL("JPEG 2000"),
     .type             = AVMEDIA_TYPE_VIDEO,
     .id               = AV_CODEC_ID_JPEG2000,
-    .capabilities     = CODEC_CAP_FRAME_THREADS,
+    .capabilities     = CODEC_CAP_FRAME_THREADS | CODEC_CAP_SLICE_THREADS,
     .priv_data_size   = sizeof(Jpeg2000DecoderContext),
     .init_static_data = jpeg2000_init_static_data,
     .decode           = jpeg2000_decode_frame,
+    .close            = jpeg2000_decode_end,
     .priv_class       = &jpeg2000_class,
     .max_lowres       = 5,
     .profiles         = NULL_IF_CONFIG_SMALL(profiles)
@@ -1163,17 +1163,148 @@ static void shift_output(MJpegDecodeContext *s, uint8_t *ptr, int linesize)
     }
 }
 
+static av_always_inline int mjpeg_decode_mcu(MJpegDecodeContext *s,
+                                             int nb_components, int Ah, int Al,
+                                             int mb_x, int mb_y, int copy_mb,
+                                             uint8_t **data,
+                                             const uint8_t **reference_data,
+                                             const int *linesize)
+{
+    int i;
+    int bytes_per_pixel = 1 + (s->bits > 8);
+
+    for (i = 0; i < nb_components; i++) {
+        uint8_t *ptr;
+        int n, h, v, x, y, c, j;
+        int block_offset;
+        n = s->nb_blocks[i];
+        c = s->comp_index[i];
+        h = s->h_scount[i];
+        v = s->v_scount[i];
+        x = 0;
+        y = 0;
+        for (j = 0; j < n; j++) {
+            block_offset = (((linesize[c] * (v * mb_y + y) * 8) +
+                             (h * mb_x + x) * 8 * bytes_per_pixel) >> s->avctx->lowres);
+
+            if (s->interlaced && s->bottom_field)
+                block_offset += linesize[c] >> 1;
+            ptr = data[c] + block_offset;
+            if (!s->progressive) {
+                if (copy_mb)
+                    mjpeg_copy_block(s, ptr, reference_data[c] + block_offset,
+                                     linesize[c], s->avctx->lowres);
+
+                else {
+                    s->bdsp.clear_block(s->block);
+                    if (decode_block(s, s->block, i,
+                                     s->dc_index[i], s->ac_index[i],
+                                     s->quant_matrixes[s->quant_sindex[i]]) < 0) {
+                        av_log(s->avctx, AV_LOG_ERROR,
+                               "error y=%d x=%d\n", mb_y, mb_x);
+                        return AVERROR_INVALIDDATA;
+                    }
+                    s->idsp.idct_put(ptr, linesize[c], s->block);
+                    if (s->bits & 7)
+                        shift_output(s, ptr, linesize[c]);
+                }
+            } else {
+                int block_idx  = s->block_stride[c] * (v * mb_y + y) +
+                                 (h * mb_x + x);
+                int16_t *block = s->blocks[c][block_idx];
+                if (Ah)
+                    block[0] += get_bits1(&s->gb) *
+                                s->quant_matrixes[s->quant_sindex[i]][0] << Al;
+                else if (decode_dc_progressive(s, block, i, s->dc_index[i],
+                                               s->quant_matrixes[s->quant_sindex[i]],
+                                               Al) < 0) {
+                    av_log(s->avctx, AV_LOG_ERROR,
+                           "error y=%d x=%d\n", mb_y, mb_x);
+                    return AVERROR_INVALIDDATA;
+                }
+            }
+            av_dlog(s->avctx, "mb: %d %d processed\n", mb_y, mb_x);
+            av_dlog(s->avctx, "%d %d %d %d %d %d %d %d \n",
+                    mb_x, mb_y, x, y, c, s->bottom_field,
+                    (v * mb_y + y) * 8, (h * mb_x + x) * 8);
+            if (++x == h) {
+                x = 0;
+                y++;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Decode a range of restart intervals of a sequential scan, with a copy
+ * of the context. Each interval starts with reset DC predictors on the
+ * byte following its RSTn marker, so the intervals are independent.
+ * A damaged interval is decoded up to the error and the following ones
+ * are still decoded, so that the picture does not depend on how the
+ * intervals were split between the jobs; the first error is returned.
+ */
+static int mjpeg_decode_scan_slice(AVCodecContext *avctx, void *arg,
+                                   int jobnr, int threadnr)
+{
+    MJpegDecodeContext *s  = avctx->priv_data;
+    MJpegDecodeContext *sl = &s->slice_ctx[jobnr];
+    int nb_components = *(int *)arg;
+    int nb_mcus       = s->mb_width * s->mb_height;
+    int nb_intervals  = (nb_mcus + s->restart_interval - 1) / s->restart_interval;
+    int nb_jobs       = FFMIN(avctx->thread_count, nb_intervals);
+    int first         =  jobnr      * nb_intervals / nb_jobs;
+    int last          = (jobnr + 1) * nb_intervals / nb_jobs;
+    uint8_t *data[MAX_COMPONENTS];
+    int linesize[MAX_COMPONENTS];
+    int i, k, mcu, ret, err = 0;
+
+    for (i = 0; i < nb_components; i++) {
+        int c = s->comp_index[i];
+        data[c]     = s->picture_ptr->data[c];
+        linesize[c] = s->linesize[c];
+    }
+
+    for (k = first; k < last; k++) {
+        int end = FFMIN((k + 1) * s->restart_interval, nb_mcus);
+
+        if (k) {
+            int pos = s->restart_pos[k - 1];
+            init_get_bits8(&sl->gb, s->gb.buffer + pos,
+                           (s->gb.size_in_bits >> 3) - pos);
+        }
+        for (i = 0; i < nb_components; i++)
+            sl->last_dc[i] = (4 << s->bits);
+
+        for (mcu = k * s->restart_interval; mcu < end; mcu++) {
+            if (get_bits_left(&sl->gb) < 0) {
+                av_log(avctx, AV_LOG_ERROR, "overread %d\n",
+                       -get_bits_left(&sl->gb));
+                ret = AVERROR_INVALIDDATA;
+            } else
+                ret = mjpeg_decode_mcu(sl, nb_components, 0, 0,
+                                       mcu % s->mb_width, mcu / s->mb_width, 0,
+                                       data, NULL, linesize);
+            if (ret < 0) {
+                if (!err)
+                    err = ret;
+                break;
+            }
+        }
+    }
+    return err;
+}
+
 static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                              int Al, const uint8_t *mb_bitmask,
                              int mb_bitmask_size,
                              const AVFrame *reference)
 {
-    int i, mb_x, mb_y;
+    int i, mb_x, mb_y, ret;
     uint8_t *data[MAX_COMPONENTS];
     const uint8_t *reference_data[MAX_COMPONENTS];
     int linesize[MAX_COMPONENTS];
     GetBitContext mb_bitmask_gb = {0}; // initialize to silence gcc warning
-    int bytes_per_pixel = 1 + (s->bits > 8);
 
     if (mb_bitmask) {
         if (mb_bitmask_size != (s->mb_width * s->mb_height + 7)>>3) {
@@ -1193,6 +1324,35 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
         s->coefs_finished[c] |= 1;
     }
 
+    /* with the RSTn markers of the scan located, decode the restart
+     * intervals in parallel; otherwise fall back to the serial loop below */
+    if ((s->avctx->active_thread_type & FF_THREAD_SLICE) &&
+        s->restart_interval && !s->progressive && !mb_bitmask &&
+        !s->interlaced && s->gb.buffer == s->buffer) {
+        int nb_mcus      = s->mb_width * s->mb_height;
+        int nb_intervals = (nb_mcus + s->restart_interval - 1) / s->restart_interval;
+        int nb_jobs      = FFMIN(s->avctx->thread_count, nb_intervals);
+
+        if (nb_jobs > 1 && s->nb_restart_pos >= nb_intervals - 1) {
+            av_fast_malloc(&s->slice_ctx, &s->slice_ctx_size,
+                           nb_jobs * sizeof(*s->slice_ctx));
+            av_fast_malloc(&s->slice_ret, &s->slice_ret_size,
+                           nb_jobs * sizeof(*s->slice_ret));
+            if (!s->slice_ctx || !s->slice_ret)
+                return AVERROR(ENOMEM);
+            for (i = 0; i < nb_jobs; i++)
+                memcpy(&s->slice_ctx[i], s, sizeof(*s));
+
+            s->avctx->execute2(s->avctx, mjpeg_decode_scan_slice,
+                               &nb_components, s->slice_ret, nb_jobs);
+            s->gb = s->slice_ctx[nb_jobs - 1].gb;
+            for (i = 0; i < nb_jobs; i++)
+                if (s->slice_ret[i] < 0)
+                    return s->slice_ret[i];
+            return 0;
+        }
+    }
+
     for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
         for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
             const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
@@ -1205,66 +1365,10 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                        -get_bits_left(&s->gb));
                 return AVERROR_INVALIDDATA;
             }
-            for (i = 0; i < nb_components; i++) {
-                uint8_t *ptr;
-                int n, h, v, x, y, c, j;
-                int block_offset;
-                n = s->nb_blocks[i];
-                c = s->comp_index[i];
-                h = s->h_scount[i];
-                v = s->v_scount[i];
-                x = 0;
-                y = 0;
-                for (j = 0; j < n; j++) {
-                    block_offset = (((linesize[c] * (v * mb_y + y) * 8) +
-                                     (h * mb_x + x) * 8 * bytes_per_pixel) >> s->avctx->lowres);
-
-                    if (s->interlaced && s->bottom_field)
-                        block_offset += linesize[c] >> 1;
-                    ptr = data[c] + block_offset;
-                    if (!s->progressive) {
-                        if (copy_mb)
-                            mjpeg_copy_block(s, ptr, reference_data[c] + block_offset,
-                                             linesize[c], s->avctx->lowres);
-
-                        else {
-                            s->bdsp.clear_block(s->block);
-                            if (decode_block(s, s->block, i,
-                                             s->dc_index[i], s->ac_index[i],
-                                             s->quant_matrixes[s->quant_sindex[i]]) < 0) {
-                                av_log(s->avctx, AV_LOG_ERROR,
-                                       "error y=%d x=%d\n", mb_y, mb_x);
-                                return AVERROR_INVALIDDATA;
-                            }
-                            s->idsp.idct_put(ptr, linesize[c], s->block);
-                            if (s->bits & 7)
-                                shift_output(s, ptr, linesize[c]);
-                        }
-                    } else {
-                        int block_idx  = s->block_stride[c] * (v * mb_y + y) +
-                                         (h * mb_x + x);
-                        int16_t *block = s->blocks[c][block_idx];
-                        if (Ah)
-                            block[0] += get_bits1(&s->gb) *
-                                        s->quant_matrixes[s->quant_sindex[i]][0] << Al;
-                        else if (decode_dc_progressive(s, block, i, s->dc_index[i],
-                                                       s->quant_matrixes[s->quant_sindex[i]],
-                                                       Al) < 0) {
-                            av_log(s->avctx, AV_LOG_ERROR,
-                                   "error y=%d x=%d\n", mb_y, mb_x);
-                            return AVERROR_INVALIDDATA;
-                        }
-                    }
-                    av_dlog(s->avctx, "mb: %d %d processed\n", mb_y, mb_x);
-                    av_dlog(s->avctx, "%d %d %d %d %d %d %d %d \n",
-                            mb_x, mb_y, x, y, c, s->bottom_field,
-                            (v * mb_y + y) * 8, (h * mb_x + x) * 8);
-                    if (++x == h) {
-                        x = 0;
-                        y++;
-                    }
-                }
-            }
+            ret = mjpeg_decode_mcu(s, nb_components, Ah, Al, mb_x, mb_y,
+                                   copy_mb, data, reference_data, linesize);
+            if (ret < 0)
+                return ret;
 
             handle_rstn(s, nb_components);
         }
@@ -1811,7 +1915,9 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
     if (start_code == SOS && !s->ls) {
         const uint8_t *src = *buf_ptr;
         uint8_t *dst = s->buffer;
+        int record_rst = s->avctx->active_thread_type & FF_THREAD_SLICE;
 
+        s->nb_restart_pos = 0;
         while (src < buf_end) {
             uint8_t x = *(src++);
 
@@ -1821,9 +1927,19 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                     while (src < buf_end && x == 0xff)
                         x = *(src++);
 
-                    if (x >= 0xd0 && x <= 0xd7)
+                    if (x >= 0xd0 && x <= 0xd7) {
                         *(dst++) = x;
-                    else if (x)
+                        /* remember where each restart interval starts, so
+                         * that the intervals can be decoded in parallel */
+                        if (record_rst) {
+                            int *pos = av_fast_realloc(s->restart_pos, &s->restart_pos_size,
+                                                       (s->nb_restart_pos + 1) * sizeof(*pos));
+                            if (!pos)
+                                return AVERROR(ENOMEM);
+                            s->restart_pos = pos;
+                            pos[s->nb_restart_pos++] = dst - s->buffer;
+                        }
+                    } else if (x)
                         break;
                 }
             }
@@ -2231,6 +2347,9 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
 
     av_freep(&s->buffer);
     av_freep(&s->stereo3d);
+    av_freep(&s->restart_pos);
+    av_freep(&s->slice_ctx);
+    av_freep(&s->slice_ret);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size = 0;
 
@@ -2278,7 +2397,7 @@ AVCodec ff_mjpeg_decoder = {
     .close          = ff_mjpeg_decode_end,
     .decode         = ff_mjpeg_decode_frame,
     .flush          = decode_flush,
-    .capabilities   = CODEC_CAP_DR1,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_SLICE_THREADS,
     .max_lowres     = 3,
     .priv_class     = &mjpegdec_class,
 };
@@ -111,6 +111,14 @@ typedef struct MJpegDecodeContext {
 
     int restart_interval;
     int restart_count;
+    int *restart_pos;     ///< offsets in buffer of the data after each RSTn marker of the scan
+    unsigned int restart_pos_size;
+    int nb_restart_pos;
+
+    struct MJpegDecodeContext *slice_ctx; ///< context copies of the restart interval slice threads
+    unsigned int slice_ctx_size;
+    int *slice_ret;
+    unsigned int slice_ret_size;
 
     int buggy_avid;
     int cs_itu601;
@@ -884,6 +884,17 @@ static void free_duplicate_context(MpegEncContext *s)
     s->block = NULL;
 }
 
+static void free_me_contexts(MpegEncContext *s)
+{
+    int i;
+
+    for (i = 0; i < s->me_context_count; i++) {
+        free_duplicate_context(s->me_thread_context[i]);
+        av_freep(&s->me_thread_context[i]);
+    }
+    s->me_context_count = 0;
+}
+
 static void backup_duplicate_context(MpegEncContext *bak, MpegEncContext *src)
 {
 #define COPY(a) bak->a = src->a
@@ -1272,9 +1283,14 @@ av_cold int ff_MPV_common_init(MpegEncContext *s)
     int nb_slices = (HAVE_THREADS &&
                      s->avctx->active_thread_type & FF_THREAD_SLICE) ?
                     s->avctx->thread_count : 1;
+    int nb_me_contexts = 0;
 
-    if (s->encoding && s->avctx->slices)
+    if (s->encoding && s->avctx->slices) {
+        /* use the spare threads for motion estimation */
+        if (nb_slices > s->avctx->slices)
+            nb_me_contexts = nb_slices;
         nb_slices = s->avctx->slices;
+    }
 
     if (s->codec_id == AV_CODEC_ID_MPEG2VIDEO && !s->progressive_sequence)
         s->mb_height = (s->height + 31) / 32 * 2;
@@ -1297,6 +1313,10 @@ av_cold int ff_MPV_common_init(MpegEncContext *s)
                " reducing to %d\n", nb_slices, max_slices);
         nb_slices = max_slices;
     }
+    /* the motion estimation row jobs rely on job n running on slice thread n,
+     * so there must be exactly one per thread */
+    if (nb_me_contexts > FFMIN(MAX_THREADS, s->mb_height))
+        nb_me_contexts = 0;
 
     if ((s->width || s->height) &&
         av_image_check_size(s->width, s->height, 0, s->avctx))
@@ -1371,6 +1391,20 @@ av_cold int ff_MPV_common_init(MpegEncContext *s)
             s->end_mb_y   = s->mb_height;
         }
         s->slice_context_count = nb_slices;
+
+        if (nb_me_contexts > nb_slices) {
+            for (i = 0; i < nb_me_contexts; i++) {
+                s->me_thread_context[i] = av_malloc(sizeof(MpegEncContext));
+                if (!s->me_thread_context[i])
+                    goto fail;
+                memcpy(s->me_thread_context[i], s, sizeof(MpegEncContext));
+                s->me_context_count = i + 1;
+                if (init_duplicate_context(s->me_thread_context[i]) < 0)
+                    goto fail;
+            }
+            if (ff_alloc_entries(s->avctx, s->mb_height) < 0)
+                goto fail;
+        }
 //     }
 
     return 0;
@@ -1439,6 +1473,8 @@ int ff_MPV_common_frame_size_change(MpegEncContext *s)
 {
     int i, err = 0;
 
+    free_me_contexts(s);
+
     if (s->slice_context_count > 1) {
         for (i = 0; i < s->slice_context_count; i++) {
             free_duplicate_context(s->thread_context[i]);
@@ -1513,6 +1549,8 @@ void ff_MPV_common_end(MpegEncContext *s)
 {
     int i;
 
+    free_me_contexts(s);
+
     if (s->slice_context_count > 1) {
         for (i = 0; i < s->slice_context_count; i++) {
             free_duplicate_context(s->thread_context[i]);
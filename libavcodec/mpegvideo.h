@@ -286,6 +286,13 @@ typedef struct MpegEncContext {
     int end_mb_y;              ///< end   mb_y of this thread (so current thread should process start_mb_y <= row < end_mb_y)
     struct MpegEncContext *thread_context[MAX_THREADS];
     int slice_context_count;   ///< number of used thread_contexts
+    /**
+     * contexts used by the encoder for motion estimation when there are
+     * more threads than slices, one per thread, each one handling every
+     * me_context_count-th macroblock row
+     */
+    struct MpegEncContext *me_thread_context[MAX_THREADS];
+    int me_context_count;      ///< number of used me_thread_contexts, 0 if the slice contexts are used
 
     /**
      * copy of the previous picture structure.
@@ -820,6 +827,11 @@ void ff_fix_long_p_mvs(MpegEncContext * s);
 void ff_fix_long_mvs(MpegEncContext * s, uint8_t *field_select_table, int field_select,
                      int16_t (*mv_table)[2], int f_code, int type, int truncate);
 int ff_init_me(MpegEncContext *s);
+/**
+ * Set the ME penalty factors for the current lambda, as the P- and B-frame
+ * motion estimation does for each macroblock.
+ */
+void ff_set_me_penalty_factors(MpegEncContext *s);
 int ff_pre_estimate_p_frame_motion(MpegEncContext * s, int mb_x, int mb_y);
 int ff_epzs_motion_search(MpegEncContext * s, int *mx_ptr, int *my_ptr,
                              int P[10][2], int src_index, int ref_index, int16_t (*last_mv)[2],
@@ -2603,31 +2603,181 @@ static int estimate_motion_thread(AVCodecContext *c, void *arg){
     return 0;
 }
 
+static void mb_var_row(MpegEncContext *s, int mb_y)
+{
+    int mb_x;
+
+    for(mb_x=0; mb_x < s->mb_width; mb_x++) {
+        int xx = mb_x * 16;
+        int yy = mb_y * 16;
+        uint8_t *pix = s->new_picture.f->data[0] + (yy * s->linesize) + xx;
+        int varc;
+        int sum = s->mpvencdsp.pix_sum(pix, s->linesize);
+
+        varc = (s->mpvencdsp.pix_norm1(pix, s->linesize) -
+                (((unsigned) sum * sum) >> 8) + 500 + 128) >> 8;
+
+        s->current_picture.mb_var [s->mb_stride * mb_y + mb_x] = varc;
+        s->current_picture.mb_mean[s->mb_stride * mb_y + mb_x] = (sum+128)>>8;
+        s->me.mb_var_sum_temp    += varc;
+    }
+}
+
 static int mb_var_thread(AVCodecContext *c, void *arg){
     MpegEncContext *s= *(void**)arg;
+    int mb_y;
+
+    ff_check_alignment();
+
+    for(mb_y=s->start_mb_y; mb_y < s->end_mb_y; mb_y++)
+        mb_var_row(s, mb_y);
+    return 0;
+}
+
+/*
+ * Motion estimation on the dedicated contexts (me_thread_context): job n
+ * handles the macroblock rows n, n + me_context_count, ... Before each
+ * macroblock, it waits for the previous row in the same slice to be far
+ * enough ahead that every neighbouring and temporal predictor the search
+ * reads is exactly what it would be in a single slice context. The
+ * motion vectors thus do not depend on the number of threads.
+ */
+
+/**
+ * Check whether any macroblock in the rows start_mb_y to end_mb_y - 1 sets
+ * the ME penalty factors during motion estimation. Skipped MPEG-4 B-frame
+ * macroblocks only do a direct search, which uses them as left by the
+ * previous macroblock.
+ */
+static int me_penalty_factors_set(MpegEncContext *s, int start_mb_y, int end_mb_y)
+{
     int mb_x, mb_y;
 
+    if (s->pict_type != AV_PICTURE_TYPE_B || s->codec_id != AV_CODEC_ID_MPEG4)
+        return end_mb_y > start_mb_y;
+    for (mb_y = start_mb_y; mb_y < end_mb_y; mb_y++)
+        for (mb_x = 0; mb_x < s->mb_width; mb_x++)
+            if (!s->next_picture.mbskip_table[mb_y * s->mb_stride + mb_x])
+                return 1;
+    return 0;
+}
+
+/**
+ * Set up ME context s for macroblock row mb_y, taking the slice bounds from
+ * the slice context the row belongs to. Slice contexts other than the first
+ * are updated before ff_init_me() and the ME lambda adjustment, so take the
+ * lambdas and rounding dependent MC functions from it as well. B-frame
+ * macroblocks start with the penalty factors left by the previous one, so
+ * restore those the slice context would have at the start of the row.
+ */
+static void me_context_set_row(MpegEncContext *s, int mb_y)
+{
+    MpegEncContext *slice = s->thread_context[0];
+    int i;
+
+    for (i = 1; i < s->slice_context_count; i++)
+        if (s->thread_context[i]->start_mb_y <= mb_y)
+            slice = s->thread_context[i];
+    s->start_mb_y  = slice->start_mb_y;
+    s->end_mb_y    = slice->end_mb_y;
+    s->lambda      = slice->lambda;
+    s->lambda2     = slice->lambda2;
+    s->me.hpel_put = slice->me.hpel_put;
+    s->me.qpel_put = slice->me.qpel_put;
+
+    if (me_penalty_factors_set(s, s->start_mb_y, mb_y)) {
+        ff_set_me_penalty_factors(s);
+    } else {
+        /* all slice contexts start with those of the first one */
+        s->me.penalty_factor     = s->thread_context[0]->me.penalty_factor;
+        s->me.sub_penalty_factor = s->thread_context[0]->me.sub_penalty_factor;
+        s->me.mb_penalty_factor  = s->thread_context[0]->me.mb_penalty_factor;
+    }
+}
+
+/**
+ * Number of macroblocks a row must be ahead of the next one: the search
+ * reads the top right neighbour, and with last_predictor_count the
+ * predictors up to last_predictor_count + 1 macroblocks to the right.
+ */
+static int me_row_lag(MpegEncContext *s)
+{
+    return s->avctx->last_predictor_count + 2;
+}
+
+static int pre_estimate_motion_rows_thread(AVCodecContext *c, void *arg,
+                                           int jobnr, int threadnr)
+{
+    MpegEncContext *s = ((MpegEncContext **)arg)[jobnr];
+    int lag = me_row_lag(s);
+    int row;
+
+    s->me.pre_pass = 1;
+    s->me.dia_size = s->avctx->pre_dia_size;
+    /* the pre-pass goes bottom up and right to left */
+    for (row = jobnr; row < s->mb_height; row += s->me_context_count) {
+        s->mb_y = s->mb_height - 1 - row;
+        me_context_set_row(s, s->mb_y);
+        s->first_slice_line = s->mb_y == s->end_mb_y - 1;
+        for (s->mb_x = s->mb_width - 1; s->mb_x >= 0; s->mb_x--) {
+            if (!s->first_slice_line)
+                ff_thread_await_progress2(c, row, threadnr, lag);
+            ff_pre_estimate_p_frame_motion(s, s->mb_x, s->mb_y);
+            ff_thread_report_progress2(c, row, threadnr, 1);
+        }
+        ff_thread_report_progress2(c, row, threadnr, lag);
+    }
+    s->me.pre_pass = 0;
+
+    return 0;
+}
+
+static int estimate_motion_rows_thread(AVCodecContext *c, void *arg,
+                                       int jobnr, int threadnr)
+{
+    MpegEncContext *s = ((MpegEncContext **)arg)[jobnr];
+    int lag = me_row_lag(s);
+
     ff_check_alignment();
 
-    for(mb_y=s->start_mb_y; mb_y < s->end_mb_y; mb_y++) {
-        for(mb_x=0; mb_x < s->mb_width; mb_x++) {
-            int xx = mb_x * 16;
-            int yy = mb_y * 16;
-            uint8_t *pix = s->new_picture.f->data[0] + (yy * s->linesize) + xx;
-            int varc;
-            int sum = s->mpvencdsp.pix_sum(pix, s->linesize);
-
-            varc = (s->mpvencdsp.pix_norm1(pix, s->linesize) -
-                    (((unsigned) sum * sum) >> 8) + 500 + 128) >> 8;
-
-            s->current_picture.mb_var [s->mb_stride * mb_y + mb_x] = varc;
-            s->current_picture.mb_mean[s->mb_stride * mb_y + mb_x] = (sum+128)>>8;
-            s->me.mb_var_sum_temp    += varc;
+    s->me.dia_size = s->avctx->dia_size;
+    for (s->mb_y = jobnr; s->mb_y < s->mb_height; s->mb_y += s->me_context_count) {
+        me_context_set_row(s, s->mb_y);
+        s->first_slice_line = s->mb_y == s->start_mb_y;
+        s->mb_x = 0; //for block init below
+        ff_init_block_index(s);
+        for (s->mb_x = 0; s->mb_x < s->mb_width; s->mb_x++) {
+            s->block_index[0] += 2;
+            s->block_index[1] += 2;
+            s->block_index[2] += 2;
+            s->block_index[3] += 2;
+
+            if (!s->first_slice_line)
+                ff_thread_await_progress2(c, s->mb_y, threadnr, lag);
+            if (s->pict_type == AV_PICTURE_TYPE_B)
+                ff_estimate_b_frame_motion(s, s->mb_x, s->mb_y);
+            else
+                ff_estimate_p_frame_motion(s, s->mb_x, s->mb_y);
+            ff_thread_report_progress2(c, s->mb_y, threadnr, 1);
         }
+        ff_thread_report_progress2(c, s->mb_y, threadnr, lag);
     }
     return 0;
 }
 
+static int mb_var_rows_thread(AVCodecContext *c, void *arg,
+                              int jobnr, int threadnr)
+{
+    MpegEncContext *s = ((MpegEncContext **)arg)[jobnr];
+    int mb_y;
+
+    ff_check_alignment();
+
+    for (mb_y = jobnr; mb_y < s->mb_height; mb_y += s->me_context_count)
+        mb_var_row(s, mb_y);
+    return 0;
+}
+
 static void write_slice_end(MpegEncContext *s){
     if(CONFIG_MPEG4_ENCODER && s->codec_id==AV_CODEC_ID_MPEG4){
         if(s->partitioned_frame){
@@ -3477,17 +3627,42 @@ static int encode_picture(MpegEncContext *s, int picture_number)
     if(ff_init_me(s)<0)
         return -1;
 
-    /* Estimate motion for every MB */
     if(s->pict_type != AV_PICTURE_TYPE_I){
         s->lambda = (s->lambda * s->avctx->me_penalty_compensation + 128)>>8;
         s->lambda2= (s->lambda2* (int64_t)s->avctx->me_penalty_compensation + 128)>>8;
+    }
+
+    /* Use the dedicated motion estimation contexts, if there are more
+     * threads than slices. They cover the whole picture, s included. */
+    if (s->me_context_count) {
+        for (i = 0; i < s->me_context_count; i++) {
+            ret = ff_update_duplicate_context(s->me_thread_context[i], s);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    /* Estimate motion for every MB */
+    if(s->pict_type != AV_PICTURE_TYPE_I){
         if (s->pict_type != AV_PICTURE_TYPE_B) {
             if((s->avctx->pre_me && s->last_non_b_pict_type==AV_PICTURE_TYPE_I) || s->avctx->pre_me==2){
-                s->avctx->execute(s->avctx, pre_estimate_motion_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
+                if (s->me_context_count) {
+                    ff_reset_entries(s->avctx);
+                    s->avctx->execute2(s->avctx, pre_estimate_motion_rows_thread, s->me_thread_context, NULL, s->me_context_count);
+                } else
+                    s->avctx->execute(s->avctx, pre_estimate_motion_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
             }
         }
 
-        s->avctx->execute(s->avctx, estimate_motion_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
+        if (s->me_context_count) {
+            ff_reset_entries(s->avctx);
+            s->avctx->execute2(s->avctx, estimate_motion_rows_thread, s->me_thread_context, NULL, s->me_context_count);
+            /* leave the penalty factors in s as the first slice context
+             * would have, for the next B-frame */
+            if (me_penalty_factors_set(s, s->start_mb_y, s->end_mb_y))
+                ff_set_me_penalty_factors(s);
+        } else
+            s->avctx->execute(s->avctx, estimate_motion_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
     }else /* if(s->pict_type == AV_PICTURE_TYPE_I) */{
         /* I-Frame */
         for(i=0; i<s->mb_stride*s->mb_height; i++)
@@ -3495,11 +3670,19 @@ static int encode_picture(MpegEncContext *s, int picture_number)
 
         if(!s->fixed_qscale){
             /* finding spatial complexity for I-frame rate control */
-            s->avctx->execute(s->avctx, mb_var_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
+            if (s->me_context_count)
+                s->avctx->execute2(s->avctx, mb_var_rows_thread, s->me_thread_context, NULL, s->me_context_count);
+            else
+                s->avctx->execute(s->avctx, mb_var_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
         }
     }
-    for(i=1; i<context_count; i++){
-        merge_context_after_me(s, s->thread_context[i]);
+    if (s->me_context_count) {
+        for (i = 0; i < s->me_context_count; i++)
+            merge_context_after_me(s, s->me_thread_context[i]);
+    } else {
+        for(i=1; i<context_count; i++){
+            merge_context_after_me(s, s->thread_context[i]);
+        }
     }
     s->current_picture.mc_mb_var_sum= s->current_picture_ptr->mc_mb_var_sum= s->me.mc_mb_var_sum_temp;
     s->current_picture.   mb_var_sum= s->current_picture_ptr->   mb_var_sum= s->me.   mb_var_sum_temp;
@@ -37,6 +37,7 @@
 #include "pthread_internal.h"
 #include "thread.h"
 
+#include "libavutil/avassert.h"
 #include "libavutil/common.h"
 #include "libavutil/cpu.h"
 #include "libavutil/mem.h"
@@ -117,9 +118,19 @@ void ff_slice_thread_free(AVCodecContext *avctx)
     for (i=0; i<avctx->thread_count; i++)
          pthread_join(c->workers[i], NULL);
 
+    if (c->progress_mutex) {
+        for (i = 0; i < c->thread_count; i++) {
+            pthread_mutex_destroy(&c->progress_mutex[i]);
+            pthread_cond_destroy(&c->progress_cond[i]);
+        }
+    }
+
     pthread_mutex_destroy(&c->current_job_lock);
     pthread_cond_destroy(&c->current_job_cond);
     pthread_cond_destroy(&c->last_job_cond);
+    av_freep(&c->entries);
+    av_freep(&c->progress_mutex);
+    av_freep(&c->progress_cond);
     av_free(c->workers);
     av_freep(&avctx->internal->thread_ctx);
 }
@@ -265,6 +276,12 @@ int ff_alloc_entries(AVCodecContext *avctx, int count)
 
     if (avctx->active_thread_type & FF_THREAD_SLICE)  {
         SliceThreadContext *p = avctx->internal->thread_ctx;
+
+        if (p->entries) {
+            av_assert0(p->thread_count == avctx->thread_count);
+            av_freep(&p->entries);
+        }
+
         p->thread_count  = avctx->thread_count;
         p->entries       = av_mallocz_array(count, sizeof(int));
 
@@ -273,12 +290,21 @@ int ff_alloc_entries(AVCodecContext *avctx, int count)
         }
 
         p->entries_count  = count;
-        p->progress_mutex = av_malloc_array(p->thread_count, sizeof(pthread_mutex_t));
-        p->progress_cond  = av_malloc_array(p->thread_count, sizeof(pthread_cond_t));
 
-        for (i = 0; i < p->thread_count; i++) {
-            pthread_mutex_init(&p->progress_mutex[i], NULL);
-            pthread_cond_init(&p->progress_cond[i], NULL);
+        if (!p->progress_mutex) {
+            p->progress_mutex = av_malloc_array(p->thread_count, sizeof(pthread_mutex_t));
+            p->progress_cond  = av_malloc_array(p->thread_count, sizeof(pthread_cond_t));
+            if (!p->progress_mutex || !p->progress_cond) {
+                av_freep(&p->entries);
+                av_freep(&p->progress_mutex);
+                av_freep(&p->progress_cond);
+                return AVERROR(ENOMEM);
+            }
+
+            for (i = 0; i < p->thread_count; i++) {
+                pthread_mutex_init(&p->progress_mutex[i], NULL);
+                pthread_cond_init(&p->progress_cond[i], NULL);
+            }
         }
     }
 
@@ -32,6 +32,14 @@
 #include "vp9dsp.h"
 #include "libavutil/avassert.h"
 
+#if HAVE_PTHREADS
+#   include <pthread.h>
+#elif HAVE_OS2THREADS
+#   include "compat/os2threads.h"
+#elif HAVE_W32THREADS
+#   include "compat/w32pthreads.h"
+#endif
+
 #define VP9_SYNCCODE 0x498342
 
 enum CompPredMode {
@@ -248,6 +256,18 @@ typedef struct VP9Context {
     struct { int x, y; } min_mv, max_mv;
     DECLARE_ALIGNED(32, uint8_t, tmp_y)[64*64];
     DECLARE_ALIGNED(32, uint8_t, tmp_uv)[2][32*32];
+
+    // slice threading: one copy of the context per tile column, each
+    // decoding its column of a tile row while job 0 runs the loopfilter
+    struct VP9Context *tile_ctx;
+    VP9Block *tile_b_base;
+    uint8_t *tile_block_base;
+    int nb_tile_ctx;
+    int tile_progress; // row up to which this tile column has been decoded
+#if HAVE_THREADS
+    pthread_mutex_t progress_mutex;
+    pthread_cond_t progress_cond;
+#endif
 } VP9Context;
 
 static const uint8_t bwh_tab[2][N_BS_SIZES][2] = {
@@ -312,6 +332,7 @@ static int update_size(AVCodecContext *ctx, int w, int h)
 {
     VP9Context *s = ctx->priv_data;
     uint8_t *p;
+    int lflvl_len;
 
     av_assert0(w > 0 && h > 0);
 
@@ -324,10 +345,14 @@ static int update_size(AVCodecContext *ctx, int w, int h)
     s->sb_rows  = (h + 63) >> 6;
     s->cols     = (w + 7) >> 3;
     s->rows     = (h + 7) >> 3;
+    // with tile threads, the loopfilter lags behind decoding, so keep the
+    // filter masks of all sb64 rows
+    lflvl_len   = ctx->active_thread_type == FF_THREAD_SLICE ? s->sb_rows : 1;
 
 #define assign(var, type, n) var = (type) p; p += s->sb_cols * (n) * sizeof(*var)
     av_freep(&s->intra_pred_data[0]);
-    p = av_malloc(s->sb_cols * (240 + sizeof(*s->lflvl) + 16 * sizeof(*s->above_mv_ctx)));
+    p = av_malloc(s->sb_cols * (240 + sizeof(*s->lflvl) * lflvl_len +
+                                16 * sizeof(*s->above_mv_ctx)));
     if (!p)
         return AVERROR(ENOMEM);
     assign(s->intra_pred_data[0],  uint8_t *,             64);
@@ -346,7 +371,7 @@ static int update_size(AVCodecContext *ctx, int w, int h)
     assign(s->above_comp_ctx,      uint8_t *,              8);
     assign(s->above_ref_ctx,       uint8_t *,              8);
     assign(s->above_filter_ctx,    uint8_t *,              8);
-    assign(s->lflvl,               struct VP9Filter *,     1);
+    assign(s->lflvl,               struct VP9Filter *,     lflvl_len);
 #undef assign
 
     // these will be re-allocated a little later
@@ -589,10 +614,23 @@ static int decode_frame_header(AVCodecContext *ctx,
     /* loopfilter header data */
     s->filter.level = get_bits(&s->gb, 6);
     sharp = get_bits(&s->gb, 3);
-    // if sharpness changed, reinit lim/mblim LUTs. if it didn't change, keep
-    // the old cache values since they are still valid
-    if (s->filter.sharpness != sharp)
-        memset(s->filter.lim_lut, 0, sizeof(s->filter.lim_lut));
+    // if sharpness changed, recalculate lim/mblim LUTs. if it didn't change,
+    // keep the old values since they are still valid. they are filled in
+    // here rather than on first use so tile threads only read them
+    if (s->filter.sharpness != sharp) {
+        for (i = 1; i < 64; i++) {
+            int limit = i;
+
+            if (sharp > 0) {
+                limit >>= (sharp + 3) >> 2;
+                limit = FFMIN(limit, 9 - sharp);
+            }
+            limit = FFMAX(limit, 1);
+
+            s->filter.lim_lut[i] = limit;
+            s->filter.mblim_lut[i] = 2 * (i + 2) + limit;
+        }
+    }
     s->filter.sharpness = sharp;
     if ((s->lf_delta.enabled = get_bits1(&s->gb))) {
         if (get_bits1(&s->gb)) {
@@ -1314,7 +1352,7 @@ static av_always_inline void setctx_2d(uint8_t *ptr, int w, int h,
     }
 }
 
-static void decode_mode(AVCodecContext *ctx)
+static void decode_mode(VP9Context *s)
 {
     static const uint8_t left_ctx[N_BS_SIZES] = {
         0x0, 0x8, 0x0, 0x8, 0xc, 0x8, 0xc, 0xe, 0xc, 0xe, 0xf, 0xe, 0xf
@@ -1326,7 +1364,6 @@ static void decode_mode(AVCodecContext *ctx)
         TX_32X32, TX_32X32, TX_32X32, TX_32X32, TX_16X16, TX_16X16,
         TX_16X16, TX_8X8, TX_8X8, TX_8X8, TX_4X4, TX_4X4, TX_4X4
     };
-    VP9Context *s = ctx->priv_data;
     VP9Block *b = s->b;
     int row = s->row, col = s->col, row7 = s->row7;
     enum TxfmMode max_tx = max_tx_for_bl_bp[b->bs];
@@ -2140,9 +2177,8 @@ static int decode_coeffs_b32(VP56RangeCoder *c, int16_t *coef, int n_coeffs,
                                    nnz, scan, nb, band_counts, qmul);
 }
 
-static void decode_coeffs(AVCodecContext *ctx)
+static void decode_coeffs(VP9Context *s)
 {
-    VP9Context *s = ctx->priv_data;
     VP9Block *b = s->b;
     int row = s->row, col = s->col;
     uint8_t (*p)[6][11] = s->prob.coef[b->tx][0 /* y */][!b->intra];
@@ -2440,9 +2476,8 @@ static av_always_inline int check_intra_mode(VP9Context *s, int mode, uint8_t **
     return mode;
 }
 
-static void intra_recon(AVCodecContext *ctx, ptrdiff_t y_off, ptrdiff_t uv_off)
+static void intra_recon(VP9Context *s, ptrdiff_t y_off, ptrdiff_t uv_off)
 {
-    VP9Context *s = ctx->priv_data;
     VP9Block *b = s->b;
     int row = s->row, col = s->col;
     int w4 = bwh_tab[1][b->bs][0] << 1, step1d = 1 << b->tx, n;
@@ -2586,13 +2621,12 @@ static av_always_inline void mc_chroma_dir(VP9Context *s, vp9_mc_func (*mc)[2],
     }
 }
 
-static void inter_recon(AVCodecContext *ctx)
+static void inter_recon(VP9Context *s)
 {
     static const uint8_t bwlog_tab[2][N_BS_SIZES] = {
         { 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4 },
         { 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 4, 4 },
     };
-    VP9Context *s = ctx->priv_data;
     VP9Block *b = s->b;
     int row = s->row, col = s->col;
     ThreadFrame *tref1 = &s->refs[s->refidx[b->ref[0]]], *tref2;
@@ -2912,11 +2946,10 @@ static av_always_inline void mask_edges(struct VP9Filter *lflvl, int is_uv,
     }
 }
 
-static void decode_b(AVCodecContext *ctx, int row, int col,
+static void decode_b(VP9Context *s, int row, int col,
                      struct VP9Filter *lflvl, ptrdiff_t yoff, ptrdiff_t uvoff,
                      enum BlockLevel bl, enum BlockPartition bp)
 {
-    VP9Context *s = ctx->priv_data;
     VP9Block *b = s->b;
     enum BlockSize bs = bl * 3 + bp;
     int w4 = bwh_tab[1][bs][0], h4 = bwh_tab[1][bs][1], lvl;
@@ -2935,11 +2968,11 @@ static void decode_b(AVCodecContext *ctx, int row, int col,
         b->bs = bs;
         b->bl = bl;
         b->bp = bp;
-        decode_mode(ctx);
+        decode_mode(s);
         b->uvtx = b->tx - (w4 * 2 == (1 << b->tx) || h4 * 2 == (1 << b->tx));
 
         if (!b->skip) {
-            decode_coeffs(ctx);
+            decode_coeffs(s);
         } else {
             int row7 = s->row7;
 
@@ -3008,9 +3041,9 @@ static void decode_b(AVCodecContext *ctx, int row, int col,
         s->uv_stride = f->linesize[1];
     }
     if (b->intra) {
-        intra_recon(ctx, yoff, uvoff);
+        intra_recon(s, yoff, uvoff);
     } else {
-        inter_recon(ctx);
+        inter_recon(s);
     }
     if (emu[0]) {
         int w = FFMIN(s->cols - col, w4) * 8, h = FFMIN(s->rows - row, h4) * 8, n, o = 0;
@@ -3056,20 +3089,6 @@ static void decode_b(AVCodecContext *ctx, int row, int col,
                    s->cols & 1 && col + w4 >= s->cols ? s->cols & 7 : 0,
                    s->rows & 1 && row + h4 >= s->rows ? s->rows & 7 : 0,
                    b->uvtx, skip_inter);
-
-        if (!s->filter.lim_lut[lvl]) {
-            int sharp = s->filter.sharpness;
-            int limit = lvl;
-
-            if (sharp > 0) {
-                limit >>= (sharp + 3) >> 2;
-                limit = FFMIN(limit, 9 - sharp);
-            }
-            limit = FFMAX(limit, 1);
-
-            s->filter.lim_lut[lvl] = limit;
-            s->filter.mblim_lut[lvl] = 2 * (lvl + 2) + limit;
-        }
     }
 
     if (s->pass == 2) {
@@ -3083,10 +3102,9 @@ static void decode_b(AVCodecContext *ctx, int row, int col,
     }
 }
 
-static void decode_sb(AVCodecContext *ctx, int row, int col, struct VP9Filter *lflvl,
+static void decode_sb(VP9Context *s, int row, int col, struct VP9Filter *lflvl,
                       ptrdiff_t yoff, ptrdiff_t uvoff, enum BlockLevel bl)
 {
-    VP9Context *s = ctx->priv_data;
     int c = ((s->above_partition_ctx[col] >> (3 - bl)) & 1) |
             (((s->left_partition_ctx[row & 0x7] >> (3 - bl)) & 1) << 1);
     const uint8_t *p = s->keyframe ? vp9_default_kf_partition_probs[bl][c] :
@@ -3098,34 +3116,34 @@ static void decode_sb(AVCodecContext *ctx, int row, int col, struct VP9Filter *l
 
     if (bl == BL_8X8) {
         bp = vp8_rac_get_tree(&s->c, vp9_partition_tree, p);
-        decode_b(ctx, row, col, lflvl, yoff, uvoff, bl, bp);
+        decode_b(s, row, col, lflvl, yoff, uvoff, bl, bp);
     } else if (col + hbs < s->cols) { // FIXME why not <=?
         if (row + hbs < s->rows) { // FIXME why not <=?
             bp = vp8_rac_get_tree(&s->c, vp9_partition_tree, p);
             switch (bp) {
             case PARTITION_NONE:
-                decode_b(ctx, row, col, lflvl, yoff, uvoff, bl, bp);
+                decode_b(s, row, col, lflvl, yoff, uvoff, bl, bp);
                 break;
             case PARTITION_H:
-                decode_b(ctx, row, col, lflvl, yoff, uvoff, bl, bp);
+                decode_b(s, row, col, lflvl, yoff, uvoff, bl, bp);
                 yoff  += hbs * 8 * y_stride;
                 uvoff += hbs * 4 * uv_stride;
-                decode_b(ctx, row + hbs, col, lflvl, yoff, uvoff, bl, bp);
+                decode_b(s, row + hbs, col, lflvl, yoff, uvoff, bl, bp);
                 break;
             case PARTITION_V:
-                decode_b(ctx, row, col, lflvl, yoff, uvoff, bl, bp);
+                decode_b(s, row, col, lflvl, yoff, uvoff, bl, bp);
                 yoff  += hbs * 8;
                 uvoff += hbs * 4;
-                decode_b(ctx, row, col + hbs, lflvl, yoff, uvoff, bl, bp);
+                decode_b(s, row, col + hbs, lflvl, yoff, uvoff, bl, bp);
                 break;
             case PARTITION_SPLIT:
-                decode_sb(ctx, row, col, lflvl, yoff, uvoff, bl + 1);
-                decode_sb(ctx, row, col + hbs, lflvl,
+                decode_sb(s, row, col, lflvl, yoff, uvoff, bl + 1);
+                decode_sb(s, row, col + hbs, lflvl,
                           yoff + 8 * hbs, uvoff + 4 * hbs, bl + 1);
                 yoff  += hbs * 8 * y_stride;
                 uvoff += hbs * 4 * uv_stride;
-                decode_sb(ctx, row + hbs, col, lflvl, yoff, uvoff, bl + 1);
-                decode_sb(ctx, row + hbs, col + hbs, lflvl,
+                decode_sb(s, row + hbs, col, lflvl, yoff, uvoff, bl + 1);
+                decode_sb(s, row + hbs, col + hbs, lflvl,
                           yoff + 8 * hbs, uvoff + 4 * hbs, bl + 1);
                 break;
             default:
@@ -3133,35 +3151,34 @@ static void decode_sb(AVCodecContext *ctx, int row, int col, struct VP9Filter *l
             }
         } else if (vp56_rac_get_prob_branchy(&s->c, p[1])) {
             bp = PARTITION_SPLIT;
-            decode_sb(ctx, row, col, lflvl, yoff, uvoff, bl + 1);
-            decode_sb(ctx, row, col + hbs, lflvl,
+            decode_sb(s, row, col, lflvl, yoff, uvoff, bl + 1);
+            decode_sb(s, row, col + hbs, lflvl,
                       yoff + 8 * hbs, uvoff + 4 * hbs, bl + 1);
         } else {
             bp = PARTITION_H;
-            decode_b(ctx, row, col, lflvl, yoff, uvoff, bl, bp);
+            decode_b(s, row, col, lflvl, yoff, uvoff, bl, bp);
         }
     } else if (row + hbs < s->rows) { // FIXME why not <=?
         if (vp56_rac_get_prob_branchy(&s->c, p[2])) {
             bp = PARTITION_SPLIT;
-            decode_sb(ctx, row, col, lflvl, yoff, uvoff, bl + 1);
+            decode_sb(s, row, col, lflvl, yoff, uvoff, bl + 1);
             yoff  += hbs * 8 * y_stride;
             uvoff += hbs * 4 * uv_stride;
-            decode_sb(ctx, row + hbs, col, lflvl, yoff, uvoff, bl + 1);
+            decode_sb(s, row + hbs, col, lflvl, yoff, uvoff, bl + 1);
         } else {
             bp = PARTITION_V;
-            decode_b(ctx, row, col, lflvl, yoff, uvoff, bl, bp);
+            decode_b(s, row, col, lflvl, yoff, uvoff, bl, bp);
         }
     } else {
         bp = PARTITION_SPLIT;
-        decode_sb(ctx, row, col, lflvl, yoff, uvoff, bl + 1);
+        decode_sb(s, row, col, lflvl, yoff, uvoff, bl + 1);
     }
     s->counts.partition[bl][c][bp]++;
 }
 
-static void decode_sb_mem(AVCodecContext *ctx, int row, int col, struct VP9Filter *lflvl,
+static void decode_sb_mem(VP9Context *s, int row, int col, struct VP9Filter *lflvl,
                           ptrdiff_t yoff, ptrdiff_t uvoff, enum BlockLevel bl)
 {
-    VP9Context *s = ctx->priv_data;
     VP9Block *b = s->b;
     ptrdiff_t hbs = 4 >> bl;
     AVFrame *f = s->frames[CUR_FRAME].tf.f;
@@ -3169,38 +3186,38 @@ static void decode_sb_mem(AVCodecContext *ctx, int row, int col, struct VP9Filte
 
     if (bl == BL_8X8) {
         av_assert2(b->bl == BL_8X8);
-        decode_b(ctx, row, col, lflvl, yoff, uvoff, b->bl, b->bp);
+        decode_b(s, row, col, lflvl, yoff, uvoff, b->bl, b->bp);
     } else if (s->b->bl == bl) {
-        decode_b(ctx, row, col, lflvl, yoff, uvoff, b->bl, b->bp);
+        decode_b(s, row, col, lflvl, yoff, uvoff, b->bl, b->bp);
         if (b->bp == PARTITION_H && row + hbs < s->rows) {
             yoff  += hbs * 8 * y_stride;
             uvoff += hbs * 4 * uv_stride;
-            decode_b(ctx, row + hbs, col, lflvl, yoff, uvoff, b->bl, b->bp);
+            decode_b(s, row + hbs, col, lflvl, yoff, uvoff, b->bl, b->bp);
         } else if (b->bp == PARTITION_V && col + hbs < s->cols) {
             yoff  += hbs * 8;
             uvoff += hbs * 4;
-            decode_b(ctx, row, col + hbs, lflvl, yoff, uvoff, b->bl, b->bp);
+            decode_b(s, row, col + hbs, lflvl, yoff, uvoff, b->bl, b->bp);
         }
     } else {
-        decode_sb_mem(ctx, row, col, lflvl, yoff, uvoff, bl + 1);
+        decode_sb_mem(s, row, col, lflvl, yoff, uvoff, bl + 1);
         if (col + hbs < s->cols) { // FIXME why not <=?
             if (row + hbs < s->rows) {
-                decode_sb_mem(ctx, row, col + hbs, lflvl, yoff + 8 * hbs,
+                decode_sb_mem(s, row, col + hbs, lflvl, yoff + 8 * hbs,
                               uvoff + 4 * hbs, bl + 1);
                 yoff  += hbs * 8 * y_stride;
                 uvoff += hbs * 4 * uv_stride;
-                decode_sb_mem(ctx, row + hbs, col, lflvl, yoff, uvoff, bl + 1);
-                decode_sb_mem(ctx, row + hbs, col + hbs, lflvl,
+                decode_sb_mem(s, row + hbs, col, lflvl, yoff, uvoff, bl + 1);
+                decode_sb_mem(s, row + hbs, col + hbs, lflvl,
                                     yoff + 8 * hbs, uvoff + 4 * hbs, bl + 1);
             } else {
                 yoff  += hbs * 8;
                 uvoff += hbs * 4;
-                decode_sb_mem(ctx, row, col + hbs, lflvl, yoff, uvoff, bl + 1);
+                decode_sb_mem(s, row, col + hbs, lflvl, yoff, uvoff, bl + 1);
             }
         } else if (row + hbs < s->rows) {
             yoff  += hbs * 8 * y_stride;
             uvoff += hbs * 4 * uv_stride;
-            decode_sb_mem(ctx, row + hbs, col, lflvl, yoff, uvoff, bl + 1);
+            decode_sb_mem(s, row + hbs, col, lflvl, yoff, uvoff, bl + 1);
         }
     }
 }
@@ -3690,6 +3707,168 @@ static void adapt_probs(VP9Context *s)
     }
 }
 
+#define TILE_BLOCK_SIZE ((64 * 64 + 128) * 3)
+
+static int alloc_tile_ctx(VP9Context *s)
+{
+    int n = s->tiling.tile_cols;
+
+    if (s->nb_tile_ctx >= n)
+        return 0;
+
+    av_freep(&s->tile_ctx);
+    av_freep(&s->tile_b_base);
+    av_freep(&s->tile_block_base);
+    s->nb_tile_ctx = 0;
+    s->tile_ctx        = av_malloc_array(n, sizeof(*s->tile_ctx));
+    s->tile_b_base     = av_malloc_array(n, sizeof(*s->tile_b_base));
+    s->tile_block_base = av_mallocz_array(n, TILE_BLOCK_SIZE);
+    if (!s->tile_ctx || !s->tile_b_base || !s->tile_block_base)
+        return AVERROR(ENOMEM);
+    s->nb_tile_ctx = n;
+
+    return 0;
+}
+
+static void report_tile_progress(VP9Context *s, VP9Context *td, int row)
+{
+#if HAVE_THREADS
+    pthread_mutex_lock(&s->progress_mutex);
+    td->tile_progress = row;
+    pthread_cond_broadcast(&s->progress_cond);
+    pthread_mutex_unlock(&s->progress_mutex);
+#endif
+}
+
+static void await_tile_progress(VP9Context *s, int row)
+{
+#if HAVE_THREADS
+    int i;
+
+    pthread_mutex_lock(&s->progress_mutex);
+    for (i = 0; i < s->tiling.tile_cols; i++)
+        while (s->tile_ctx[i].tile_progress < row)
+            pthread_cond_wait(&s->progress_cond, &s->progress_mutex);
+    pthread_mutex_unlock(&s->progress_mutex);
+#endif
+}
+
+static int decode_tile_col_sliced(AVCodecContext *ctx, void *arg,
+                                  int jobnr, int threadnr)
+{
+    VP9Context *s = ctx->priv_data;
+    AVFrame *f = s->frames[CUR_FRAME].tf.f;
+    ptrdiff_t ls_y = f->linesize[0], ls_uv = f->linesize[1];
+    int row, col;
+
+    if (jobnr == 0) {
+        // loopfilter each row once all tile columns are done with it; the
+        // next row may already be decoding, since it does not read any
+        // pixels the loopfilter touches
+        for (row = s->tiling.tile_row_start; row < s->tiling.tile_row_end; row += 8) {
+            struct VP9Filter *lflvl_ptr = s->lflvl + (row >> 3) * s->sb_cols;
+            ptrdiff_t yoff = row * 8 * ls_y, uvoff = row * 4 * ls_uv;
+
+            await_tile_progress(s, row + 8);
+            if (!s->filter.level)
+                continue;
+            for (col = 0; col < s->cols;
+                 col += 8, yoff += 64, uvoff += 32, lflvl_ptr++) {
+                loopfilter_sb(ctx, lflvl_ptr, row, col, yoff, uvoff);
+            }
+        }
+    } else {
+        VP9Context *td = &s->tile_ctx[jobnr - 1];
+        int col_start = td->tiling.tile_col_start;
+        int col_end   = td->tiling.tile_col_end;
+        int n         = FFMIN(col_end, s->cols) - col_start;
+
+        for (row = s->tiling.tile_row_start; row < s->tiling.tile_row_end; row += 8) {
+            struct VP9Filter *lflvl_ptr = s->lflvl + (row >> 3) * s->sb_cols +
+                                          (col_start >> 3);
+            ptrdiff_t yoff  = row * 8 * ls_y  + col_start * 8;
+            ptrdiff_t uvoff = row * 4 * ls_uv + col_start * 4;
+
+            memset(td->left_partition_ctx, 0, 8);
+            memset(td->left_skip_ctx, 0, 8);
+            if (td->keyframe || td->intraonly) {
+                memset(td->left_mode_ctx, DC_PRED, 16);
+            } else {
+                memset(td->left_mode_ctx, NEARESTMV, 8);
+            }
+            memset(td->left_y_nnz_ctx, 0, 16);
+            memset(td->left_uv_nnz_ctx, 0, 16);
+            memset(td->left_segpred_ctx, 0, 8);
+
+            for (col = col_start; col < col_end;
+                 col += 8, yoff += 64, uvoff += 32, lflvl_ptr++) {
+                memset(lflvl_ptr->mask, 0, sizeof(lflvl_ptr->mask));
+                decode_sb(td, row, col, lflvl_ptr, yoff, uvoff, BL_64X64);
+            }
+
+            // backup pre-loopfilter reconstruction data of this tile column
+            // for intra prediction of the next row of sb64s
+            if (row + 8 < s->rows) {
+                memcpy(s->intra_pred_data[0] + col_start * 8,
+                       f->data[0] + row * 8 * ls_y + 63 * ls_y + col_start * 8,
+                       8 * n);
+                memcpy(s->intra_pred_data[1] + col_start * 4,
+                       f->data[1] + row * 4 * ls_uv + 31 * ls_uv + col_start * 4,
+                       4 * n);
+                memcpy(s->intra_pred_data[2] + col_start * 4,
+                       f->data[2] + row * 4 * ls_uv + 31 * ls_uv + col_start * 4,
+                       4 * n);
+            }
+
+            report_tile_progress(s, td, row + 8);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Decode the current tile row with one job per tile column. The tile
+ * columns only depend on their own previous rows, so they are decoded
+ * by copies of the context with their own range coder, block buffers,
+ * left context and symbol counts.
+ */
+static void decode_tile_row_sliced(AVCodecContext *ctx)
+{
+    VP9Context *s = ctx->priv_data;
+    int tile_col, i;
+
+    for (tile_col = 0; tile_col < s->tiling.tile_cols; tile_col++) {
+        VP9Context *td = &s->tile_ctx[tile_col];
+
+        memcpy(td, s, sizeof(*td));
+        set_tile_offset(&td->tiling.tile_col_start, &td->tiling.tile_col_end,
+                        tile_col, s->tiling.log2_tile_cols, s->sb_cols);
+        memcpy(&td->c, &s->c_b[tile_col], sizeof(td->c));
+        memset(&td->counts, 0, sizeof(td->counts));
+        td->b = td->b_base = &s->tile_b_base[tile_col];
+        td->block = td->block_base =
+            (int16_t *) (s->tile_block_base + tile_col * TILE_BLOCK_SIZE);
+        td->uvblock[0] = td->uvblock_base[0] = td->block_base + 64 * 64;
+        td->uvblock[1] = td->uvblock_base[1] = td->uvblock_base[0] + 32 * 32;
+        td->eob = td->eob_base = (uint8_t *) (td->uvblock_base[1] + 32 * 32);
+        td->uveob[0] = td->uveob_base[0] = td->eob_base + 256;
+        td->uveob[1] = td->uveob_base[1] = td->uveob_base[0] + 64;
+        td->tile_progress = s->tiling.tile_row_start;
+    }
+
+    ctx->execute2(ctx, decode_tile_col_sliced, NULL, NULL,
+                  s->tiling.tile_cols + 1);
+
+    for (tile_col = 0; tile_col < s->tiling.tile_cols; tile_col++) {
+        unsigned *dst = (unsigned *) &s->counts;
+        const unsigned *src = (const unsigned *) &s->tile_ctx[tile_col].counts;
+
+        for (i = 0; i < sizeof(s->counts) / sizeof(unsigned); i++)
+            dst[i] += src[i];
+    }
+}
+
 static void free_buffers(VP9Context *s)
 {
     av_freep(&s->intra_pred_data[0]);
@@ -3718,6 +3897,16 @@ static av_cold int vp9_decode_free(AVCodecContext *ctx)
     free_buffers(s);
     av_freep(&s->c_b);
     s->c_b_size = 0;
+    av_freep(&s->tile_ctx);
+    av_freep(&s->tile_b_base);
+    av_freep(&s->tile_block_base);
+    s->nb_tile_ctx = 0;
+#if HAVE_THREADS
+    if (ctx->active_thread_type == FF_THREAD_SLICE) {
+        pthread_cond_destroy(&s->progress_cond);
+        pthread_mutex_destroy(&s->progress_mutex);
+    }
+#endif
 
     return 0;
 }
@@ -3729,7 +3918,7 @@ static int vp9_decode_frame(AVCodecContext *ctx, void *frame,
     const uint8_t *data = pkt->data;
     int size = pkt->size;
     VP9Context *s = ctx->priv_data;
-    int res, tile_row, tile_col, i, ref, row, col;
+    int res, tile_row, tile_col, i, ref, row, col, tile_threads;
     ptrdiff_t yoff, uvoff, ls_y, ls_uv;
     AVFrame *f;
 
@@ -3795,6 +3984,13 @@ static int vp9_decode_frame(AVCodecContext *ctx, void *frame,
                "Failed to allocate block buffers\n");
         return res;
     }
+    tile_threads = ctx->active_thread_type == FF_THREAD_SLICE &&
+                   s->tiling.tile_cols > 1;
+    if (tile_threads && (res = alloc_tile_ctx(s)) < 0) {
+        av_log(ctx, AV_LOG_ERROR,
+               "Failed to allocate tile thread contexts\n");
+        return res;
+    }
     if (s->refreshctx && s->parallelmode) {
         int j, k, l, m;
 
@@ -3851,6 +4047,11 @@ static int vp9_decode_frame(AVCodecContext *ctx, void *frame,
                 }
             }
 
+            if (tile_threads) {
+                decode_tile_row_sliced(ctx);
+                continue;
+            }
+
             for (row = s->tiling.tile_row_start; row < s->tiling.tile_row_end;
                  row += 8, yoff += ls_y * 64, uvoff += ls_uv * 32) {
                 struct VP9Filter *lflvl_ptr = s->lflvl;
@@ -3885,10 +4086,10 @@ static int vp9_decode_frame(AVCodecContext *ctx, void *frame,
                         }
 
                         if (s->pass == 2) {
-                            decode_sb_mem(ctx, row, col, lflvl_ptr,
+                            decode_sb_mem(s, row, col, lflvl_ptr,
                                           yoff2, uvoff2, BL_64X64);
                         } else {
-                            decode_sb(ctx, row, col, lflvl_ptr,
+                            decode_sb(s, row, col, lflvl_ptr,
                                       yoff2, uvoff2, BL_64X64);
                         }
                     }
@@ -4002,6 +4203,12 @@ static av_cold int vp9_decode_init(AVCodecContext *ctx)
     ff_vp9dsp_init(&s->dsp);
     ff_videodsp_init(&s->vdsp, 8);
     s->filter.sharpness = -1;
+#if HAVE_THREADS
+    if (ctx->active_thread_type == FF_THREAD_SLICE) {
+        pthread_mutex_init(&s->progress_mutex, NULL);
+        pthread_cond_init(&s->progress_cond, NULL);
+    }
+#endif
 
     return init_frames(ctx);
 }
@@ -4061,7 +4268,8 @@ AVCodec ff_vp9_decoder = {
     .init                  = vp9_decode_init,
     .close                 = vp9_decode_free,
     .decode                = vp9_decode_frame,
-    .capabilities          = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS,
+    .capabilities          = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS |
+                             CODEC_CAP_SLICE_THREADS,
     .flush                 = vp9_decode_flush,
     .init_thread_copy      = ONLY_IF_THREADS_ENABLED(vp9_decode_init_thread_copy),
     .update_thread_context = ONLY_IF_THREADS_ENABLED(vp9_decode_update_thread_context),
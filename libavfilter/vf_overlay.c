@@ -120,6 +120,11 @@ typedef struct OverlayContext {
     AVExpr *x_pexpr, *y_pexpr;
 } OverlayContext;
 
+typedef struct ThreadData {
+    AVFrame *dst;
+    const AVFrame *src;
+} ThreadData;
+
 static av_cold void uninit(AVFilterContext *ctx)
 {
     OverlayContext *s = ctx->priv;
@@ -358,15 +363,22 @@ static int config_output(AVFilterLink *outlink)
 // ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)) is a faster version of: 255 * (x + y)
 #define UNPREMULTIPLY_ALPHA(x, y) ((((x) << 16) - ((x) << 9) + (x)) / ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)))
 
+// first row of slice n when splitting the rows [start, end) in nb slices
+#define SLICE_ROW(start, end, n, nb) ((start) + (FFMAX((end) - (start), 0) * (n)) / (nb))
+
 /**
- * Blend image in src to destination buffer dst at position (x, y).
+ * Blend the rows of slice jobnr of image td->src to destination buffer
+ * td->dst at position (s->x, s->y).
  */
-static void blend_image(AVFilterContext *ctx,
-                        AVFrame *dst, const AVFrame *src,
-                        int x, int y)
+static int blend_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     OverlayContext *s = ctx->priv;
-    int i, imax, j, jmax, k, kmax;
+    ThreadData *td = arg;
+    AVFrame *dst = td->dst;
+    const AVFrame *src = td->src;
+    const int x = s->x;
+    const int y = s->y;
+    int i, imin, imax, j, jmin, jmax, k, kmax;
     const int src_w = src->width;
     const int src_h = src->height;
     const int dst_w = dst->width;
@@ -374,7 +386,7 @@ static void blend_image(AVFilterContext *ctx,
 
     if (x >= dst_w || x+src_w < 0 ||
         y >= dst_h || y+src_h < 0)
-        return; /* no intersection */
+        return 0; /* no intersection */
 
     if (s->main_is_packed_rgb) {
         uint8_t alpha;          ///< the amount of overlay to blend on to main
@@ -391,11 +403,14 @@ static void blend_image(AVFilterContext *ctx,
         const int main_has_alpha = s->main_has_alpha;
         uint8_t *s, *sp, *d, *dp;
 
-        i = FFMAX(-y, 0);
+        imin = FFMAX(-y, 0);
+        imax = FFMIN(-y + dst_h, src_h);
+        i    = SLICE_ROW(imin, imax, jobnr,     nb_jobs);
+        imax = SLICE_ROW(imin, imax, jobnr + 1, nb_jobs);
         sp = src->data[0] + i     * src->linesize[0];
         dp = dst->data[0] + (y+i) * dst->linesize[0];
 
-        for (imax = FFMIN(-y + dst_h, src_h); i < imax; i++) {
+        for (; i < imax; i++) {
             j = FFMAX(-x, 0);
             s = sp + j     * sstep;
             d = dp + (x+j) * dstep;
@@ -449,11 +464,14 @@ static void blend_image(AVFilterContext *ctx,
             uint8_t alpha;          ///< the amount of overlay to blend on to main
             uint8_t *s, *sa, *d, *da;
 
-            i = FFMAX(-y, 0);
+            imin = FFMAX(-y, 0);
+            imax = FFMIN(-y + dst_h, src_h);
+            i    = SLICE_ROW(imin, imax, jobnr,     nb_jobs);
+            imax = SLICE_ROW(imin, imax, jobnr + 1, nb_jobs);
             sa = src->data[3] + i     * src->linesize[3];
             da = dst->data[3] + (y+i) * dst->linesize[3];
 
-            for (imax = FFMIN(-y + dst_h, src_h); i < imax; i++) {
+            for (; i < imax; i++) {
                 j = FFMAX(-x, 0);
                 s = sa + j;
                 d = da + x+j;
@@ -492,12 +510,15 @@ static void blend_image(AVFilterContext *ctx,
             int xp = x>>hsub;
             uint8_t *s, *sp, *d, *dp, *a, *ap;
 
-            j = FFMAX(-yp, 0);
+            jmin = FFMAX(-yp, 0);
+            jmax = FFMIN(-yp + dst_hp, src_hp);
+            j    = SLICE_ROW(jmin, jmax, jobnr,     nb_jobs);
+            jmax = SLICE_ROW(jmin, jmax, jobnr + 1, nb_jobs);
             sp = src->data[i] + j         * src->linesize[i];
             dp = dst->data[i] + (yp+j)    * dst->linesize[i];
             ap = src->data[3] + (j<<vsub) * src->linesize[3];
 
-            for (jmax = FFMIN(-yp + dst_hp, src_hp); j < jmax; j++) {
+            for (; j < jmax; j++) {
                 k = FFMAX(-xp, 0);
                 d = dp + xp+k;
                 s = sp + k;
@@ -547,6 +568,8 @@ static void blend_image(AVFilterContext *ctx,
             }
         }
     }
+
+    return 0;
 }
 
 static AVFrame *do_blend(AVFilterContext *ctx, AVFrame *mainpic,
@@ -554,6 +577,7 @@ static AVFrame *do_blend(AVFilterContext *ctx, AVFrame *mainpic,
 {
     OverlayContext *s = ctx->priv;
     AVFilterLink *inlink = ctx->inputs[0];
+    ThreadData td;
 
     if (s->eval_mode == EVAL_MODE_FRAME) {
         int64_t pos = av_frame_get_pkt_pos(mainpic);
@@ -570,7 +594,13 @@ static AVFrame *do_blend(AVFilterContext *ctx, AVFrame *mainpic,
                s->var_values[VAR_Y], s->y);
     }
 
-    blend_image(ctx, mainpic, second, s->x, s->y);
+    td.dst = mainpic;
+    td.src = second;
+    /* with a planar main alpha, the chroma blending reads destination
+     * pixels of the following rows, which may belong to another slice */
+    ctx->internal->execute(ctx, blend_slice, &td, NULL,
+                           s->main_has_alpha && !s->main_is_packed_rgb ? 1 :
+                           FFMIN(second->height, ctx->graph->nb_threads));
     return mainpic;
 }
 
@@ -675,5 +705,6 @@ AVFilter ff_vf_overlay = {
     .process_command = process_command,
     .inputs        = avfilter_vf_overlay_inputs,
     .outputs       = avfilter_vf_overlay_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL |
+                     AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -75,6 +75,8 @@ typedef struct ScaleContext {
     const AVClass *class;
     struct SwsContext *sws;     ///< software scaler context
     struct SwsContext *isws[2]; ///< software scaler context for interlaced material
+    struct SwsContext **slice_sws[3]; ///< per-slice contexts, the first ones are sws, isws[0] and isws[1]
+    int nb_slices;              ///< number of contexts in each slice_sws array
     AVDictionary *opts;
 
     /**
@@ -111,6 +113,11 @@ typedef struct ScaleContext {
     int force_original_aspect_ratio;
 } ScaleContext;
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int interlaced;
+} ThreadData;
+
 static av_cold int init_dict(AVFilterContext *ctx, AVDictionary **opts)
 {
     ScaleContext *scale = ctx->priv;
@@ -161,13 +168,24 @@ static av_cold int init_dict(AVFilterContext *ctx, AVDictionary **opts)
     return 0;
 }
 
+static void free_sws(ScaleContext *scale)
+{
+    int i, j;
+
+    for (i = 0; i < 3; i++) {
+        if (scale->slice_sws[i])
+            for (j = 0; j < scale->nb_slices; j++)
+                sws_freeContext(scale->slice_sws[i][j]);
+        av_freep(&scale->slice_sws[i]);
+    }
+    scale->isws[0] = scale->isws[1] = scale->sws = NULL;
+    scale->nb_slices = 0;
+}
+
 static av_cold void uninit(AVFilterContext *ctx)
 {
     ScaleContext *scale = ctx->priv;
-    sws_freeContext(scale->sws);
-    sws_freeContext(scale->isws[0]);
-    sws_freeContext(scale->isws[1]);
-    scale->sws = NULL;
+    free_sws(scale);
     av_dict_free(&scale->opts);
 }
 
@@ -231,6 +249,41 @@ static const int *parse_yuv_type(const char *s, enum AVColorSpace colorspace)
     return sws_getCoefficients(colorspace);
 }
 
+static int init_sws(ScaleContext *scale, struct SwsContext **s,
+                    AVFilterLink *inlink, AVFilterLink *outlink,
+                    enum AVPixelFormat outfmt, int field)
+{
+    int ret;
+
+    *s = sws_alloc_context();
+    if (!*s)
+        return AVERROR(ENOMEM);
+
+    if (scale->opts) {
+        AVDictionaryEntry *e = NULL;
+
+        while ((e = av_dict_get(scale->opts, "", e, AV_DICT_IGNORE_SUFFIX))) {
+            if ((ret = av_opt_set(*s, e->key, e->value, 0)) < 0)
+                return ret;
+        }
+    }
+
+    av_opt_set_int(*s, "srcw", inlink ->w, 0);
+    av_opt_set_int(*s, "srch", inlink ->h >> !!field, 0);
+    av_opt_set_int(*s, "src_format", inlink->format, 0);
+    av_opt_set_int(*s, "dstw", outlink->w, 0);
+    av_opt_set_int(*s, "dsth", outlink->h >> !!field, 0);
+    av_opt_set_int(*s, "dst_format", outfmt, 0);
+    av_opt_set_int(*s, "sws_flags", scale->flags, 0);
+
+    av_opt_set_int(*s, "src_h_chr_pos", scale->in_h_chr_pos, 0);
+    av_opt_set_int(*s, "src_v_chr_pos", scale->in_v_chr_pos, 0);
+    av_opt_set_int(*s, "dst_h_chr_pos", scale->out_h_chr_pos, 0);
+    av_opt_set_int(*s, "dst_v_chr_pos", scale->out_v_chr_pos, 0);
+
+    return sws_init_context(*s, NULL, NULL);
+}
+
 static int config_props(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
@@ -336,53 +389,48 @@ static int config_props(AVFilterLink *outlink)
     scale->output_is_pal = av_pix_fmt_desc_get(outfmt)->flags & AV_PIX_FMT_FLAG_PAL ||
                            av_pix_fmt_desc_get(outfmt)->flags & AV_PIX_FMT_FLAG_PSEUDOPAL;
 
-    if (scale->sws)
-        sws_freeContext(scale->sws);
-    if (scale->isws[0])
-        sws_freeContext(scale->isws[0]);
-    if (scale->isws[1])
-        sws_freeContext(scale->isws[1]);
-    scale->isws[0] = scale->isws[1] = scale->sws = NULL;
+    free_sws(scale);
     if (inlink->w == outlink->w && inlink->h == outlink->h &&
         inlink->format == outlink->format)
         ;
     else {
-        struct SwsContext **swscs[3] = {&scale->sws, &scale->isws[0], &scale->isws[1]};
-        int i;
+        int i, j, align;
+
+        scale->nb_slices = 1;
+        if (ctx->thread_type & AVFILTER_THREAD_SLICE)
+            scale->nb_slices = FFMAX(ctx->graph->nb_threads, 1);
 
         for (i = 0; i < 3; i++) {
-            struct SwsContext **s = swscs[i];
-            *s = sws_alloc_context();
-            if (!*s)
+            scale->slice_sws[i] = av_mallocz_array(scale->nb_slices,
+                                                   sizeof(*scale->slice_sws[i]));
+            if (!scale->slice_sws[i])
                 return AVERROR(ENOMEM);
 
-            if (scale->opts) {
-                AVDictionaryEntry *e = NULL;
+            if ((ret = init_sws(scale, &scale->slice_sws[i][0],
+                                inlink, outlink, outfmt, i)) < 0)
+                return ret;
 
-                while ((e = av_dict_get(scale->opts, "", e, AV_DICT_IGNORE_SUFFIX))) {
-                    if ((ret = av_opt_set(*s, e->key, e->value, 0)) < 0)
-                        return ret;
-                }
+            /* Only split the output into slices that swscale can compute
+             * independently and that are not smaller than the alignment. */
+            if (!i) {
+                align = sws_dst_slice_alignment(scale->slice_sws[0][0]);
+                if (!align)
+                    scale->nb_slices = 1;
+                else
+                    scale->nb_slices = av_clip(outlink->h / (2 * align), 1,
+                                               scale->nb_slices);
             }
 
-            av_opt_set_int(*s, "srcw", inlink ->w, 0);
-            av_opt_set_int(*s, "srch", inlink ->h >> !!i, 0);
-            av_opt_set_int(*s, "src_format", inlink->format, 0);
-            av_opt_set_int(*s, "dstw", outlink->w, 0);
-            av_opt_set_int(*s, "dsth", outlink->h >> !!i, 0);
-            av_opt_set_int(*s, "dst_format", outfmt, 0);
-            av_opt_set_int(*s, "sws_flags", scale->flags, 0);
-
-            av_opt_set_int(*s, "src_h_chr_pos", scale->in_h_chr_pos, 0);
-            av_opt_set_int(*s, "src_v_chr_pos", scale->in_v_chr_pos, 0);
-            av_opt_set_int(*s, "dst_h_chr_pos", scale->out_h_chr_pos, 0);
-            av_opt_set_int(*s, "dst_v_chr_pos", scale->out_v_chr_pos, 0);
-
-            if ((ret = sws_init_context(*s, NULL, NULL)) < 0)
-                return ret;
+            for (j = 1; j < scale->nb_slices; j++)
+                if ((ret = init_sws(scale, &scale->slice_sws[i][j],
+                                    inlink, outlink, outfmt, i)) < 0)
+                    return ret;
             if (!scale->interlaced)
                 break;
         }
+        scale->sws     = scale->slice_sws[0][0];
+        scale->isws[0] = scale->slice_sws[1] ? scale->slice_sws[1][0] : NULL;
+        scale->isws[1] = scale->slice_sws[2] ? scale->slice_sws[2][0] : NULL;
     }
 
     if (inlink->sample_aspect_ratio.num){
@@ -406,12 +454,11 @@ fail:
     return ret;
 }
 
-static int scale_slice(AVFilterLink *link, AVFrame *out_buf, AVFrame *cur_pic, struct SwsContext *sws, int y, int h, int mul, int field)
+static void get_slice_pointers(ScaleContext *scale, AVFrame *out_buf, AVFrame *cur_pic,
+                               const uint8_t *in[4], int in_stride[4],
+                               uint8_t *out[4], int out_stride[4],
+                               int y, int mul, int field)
 {
-    ScaleContext *scale = link->dst->priv;
-    const uint8_t *in[4];
-    uint8_t *out[4];
-    int in_stride[4],out_stride[4];
     int i;
 
     for(i=0; i<4; i++){
@@ -425,11 +472,63 @@ static int scale_slice(AVFilterLink *link, AVFrame *out_buf, AVFrame *cur_pic, s
          in[1] = cur_pic->data[1];
     if(scale->output_is_pal)
         out[1] = out_buf->data[1];
+}
+
+static int scale_slice(AVFilterLink *link, AVFrame *out_buf, AVFrame *cur_pic, struct SwsContext *sws, int y, int h, int mul, int field)
+{
+    ScaleContext *scale = link->dst->priv;
+    const uint8_t *in[4];
+    uint8_t *out[4];
+    int in_stride[4],out_stride[4];
+
+    get_slice_pointers(scale, out_buf, cur_pic, in, in_stride, out, out_stride,
+                       y, mul, field);
 
     return sws_scale(sws, in, in_stride, y/mul, h,
                          out,out_stride);
 }
 
+static int scale_dst_slice(AVFilterLink *link, AVFrame *out_buf, AVFrame *cur_pic,
+                           struct SwsContext *sws, int jobnr, int nb_jobs,
+                           int mul, int field)
+{
+    ScaleContext *scale = link->dst->priv;
+    const uint8_t *in[4];
+    uint8_t *out[4];
+    int in_stride[4],out_stride[4];
+    int h     = link->dst->outputs[0]->h / mul;
+    int align = sws_dst_slice_alignment(sws);
+    int slice_start = (h *  jobnr     / nb_jobs) & ~(align - 1);
+    int slice_end   = (h * (jobnr + 1) / nb_jobs) & ~(align - 1);
+
+    if (jobnr == nb_jobs - 1)
+        slice_end = h;
+    if (slice_end <= slice_start)
+        return 0;
+
+    get_slice_pointers(scale, out_buf, cur_pic, in, in_stride, out, out_stride,
+                       0, mul, field);
+
+    return sws_scale_dst_slice(sws, in, in_stride, slice_start,
+                               slice_end - slice_start, out, out_stride);
+}
+
+static int scale_slices(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ScaleContext *scale = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    ThreadData *td = arg;
+
+    if (td->interlaced) {
+        scale_dst_slice(inlink, td->out, td->in, scale->slice_sws[1][jobnr], jobnr, nb_jobs, 2, 0);
+        scale_dst_slice(inlink, td->out, td->in, scale->slice_sws[2][jobnr], jobnr, nb_jobs, 2, 1);
+    } else {
+        scale_dst_slice(inlink, td->out, td->in, scale->slice_sws[0][jobnr], jobnr, nb_jobs, 1, 0);
+    }
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *link, AVFrame *in)
 {
     ScaleContext *scale = link->dst->priv;
@@ -437,7 +536,7 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     AVFrame *out;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(link->format);
     char buf[32];
-    int in_range;
+    int in_range, interlaced;
 
     if(   in->width  != link->w
        || in->height != link->h
@@ -482,7 +581,7 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         || scale-> in_range != AVCOL_RANGE_UNSPECIFIED
         || in_range != AVCOL_RANGE_UNSPECIFIED
         || scale->out_range != AVCOL_RANGE_UNSPECIFIED) {
-        int in_full, out_full, brightness, contrast, saturation;
+        int in_full, out_full, brightness, contrast, saturation, i, j;
         const int *inv_table, *table;
 
         sws_getColorspaceDetails(scale->sws, (int **)&inv_table, &in_full,
@@ -501,17 +600,14 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         if (scale->out_range != AVCOL_RANGE_UNSPECIFIED)
             out_full = (scale->out_range == AVCOL_RANGE_JPEG);
 
-        sws_setColorspaceDetails(scale->sws, inv_table, in_full,
-                                 table, out_full,
-                                 brightness, contrast, saturation);
-        if (scale->isws[0])
-            sws_setColorspaceDetails(scale->isws[0], inv_table, in_full,
-                                     table, out_full,
-                                     brightness, contrast, saturation);
-        if (scale->isws[1])
-            sws_setColorspaceDetails(scale->isws[1], inv_table, in_full,
-                                     table, out_full,
-                                     brightness, contrast, saturation);
+        for (i = 0; i < 3; i++) {
+            if (!scale->slice_sws[i])
+                continue;
+            for (j = 0; j < scale->nb_slices; j++)
+                sws_setColorspaceDetails(scale->slice_sws[i][j], inv_table, in_full,
+                                         table, out_full,
+                                         brightness, contrast, saturation);
+        }
     }
 
     av_reduce(&out->sample_aspect_ratio.num, &out->sample_aspect_ratio.den,
@@ -519,7 +615,13 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
               (int64_t)in->sample_aspect_ratio.den * outlink->w * link->h,
               INT_MAX);
 
-    if(scale->interlaced>0 || (scale->interlaced<0 && in->interlaced_frame)){
+    interlaced = scale->interlaced>0 || (scale->interlaced<0 && in->interlaced_frame);
+
+    if (scale->nb_slices > 1) {
+        ThreadData td = { .in = in, .out = out, .interlaced = interlaced };
+        link->dst->internal->execute(link->dst, scale_slices, &td, NULL,
+                                     scale->nb_slices);
+    }else if(interlaced){
         scale_slice(link, out, in, scale->isws[0], 0, (link->h+1)/2, 2, 0);
         scale_slice(link, out, in, scale->isws[1], 0,  link->h   /2, 2, 1);
     }else{
@@ -604,4 +706,5 @@ AVFilter ff_vf_scale = {
     .priv_class    = &scale_class,
     .inputs        = avfilter_vf_scale_inputs,
     .outputs       = avfilter_vf_scale_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
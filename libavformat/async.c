@@ -0,0 +1,355 @@
+/*
+ * Input async protocol.
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * Based on cache.c by Michael Niedermayer
+ */
+
+/**
+ * @file
+ * Read-ahead wrapper: a background thread reads the inner protocol into
+ * a ring buffer, so that the demuxer does not block on every I/O stall.
+ *
+ * @TODO
+ *      support writing
+ *      keep already consumed data around for short backward seeks
+ */
+
+#include <pthread.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/fifo.h"
+#include "libavutil/opt.h"
+#include "libavutil/time.h"
+#include "avformat.h"
+#include "url.h"
+
+#define READ_BLOCK_SIZE 4096
+
+typedef struct Context {
+    AVClass        *class;
+    URLContext     *inner;
+
+    int             buffer_size;
+    int             high_watermark;
+    int             low_watermark;
+
+    AVFifoBuffer   *fifo;
+    int64_t         logical_pos;    ///< position of the first byte in fifo
+    int64_t         logical_size;
+
+    int             seek_request;
+    int64_t         seek_pos;
+    int             seek_whence;
+    int             seek_completed;
+    int64_t         seek_ret;
+
+    int             filling;
+    int             io_eof_reached;
+    int             io_error;
+    int             abort_request;
+
+    int64_t         bytes_read;
+    int             stall_count;
+    int64_t         stall_time;
+
+    pthread_t       async_buffer_thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond_wakeup_main;
+    pthread_cond_t  cond_wakeup_background;
+
+    AVIOInterruptCB interrupt_callback;
+} Context;
+
+static int async_check_interrupt(void *arg)
+{
+    URLContext *h = arg;
+    Context *c    = h->priv_data;
+
+    if (c->abort_request)
+        return 1;
+
+    return ff_check_interrupt(&h->interrupt_callback);
+}
+
+static void *async_buffer_task(void *arg)
+{
+    URLContext *h = arg;
+    Context *c    = h->priv_data;
+    uint8_t buf[READ_BLOCK_SIZE];
+    int64_t seek_pos;
+    int seek_whence, fifo_size, to_read, ret;
+
+    pthread_mutex_lock(&c->mutex);
+    while (!c->abort_request) {
+        if (c->seek_request) {
+            seek_pos    = c->seek_pos;
+            seek_whence = c->seek_whence;
+            pthread_mutex_unlock(&c->mutex);
+            c->seek_ret = ffurl_seek(c->inner, seek_pos, seek_whence);
+            pthread_mutex_lock(&c->mutex);
+
+            /* whatever was read before the seek is stale now */
+            if (c->seek_ret >= 0) {
+                av_fifo_reset(c->fifo);
+                c->io_eof_reached = 0;
+                c->io_error       = 0;
+                c->filling        = 1;
+            }
+            c->seek_request   = 0;
+            c->seek_completed = 1;
+            pthread_cond_signal(&c->cond_wakeup_main);
+            continue;
+        }
+
+        fifo_size = av_fifo_size(c->fifo);
+        if (fifo_size >= c->high_watermark)
+            c->filling = 0;
+        else if (fifo_size < c->low_watermark)
+            c->filling = 1;
+
+        if (!c->filling || c->io_eof_reached || c->io_error) {
+            pthread_cond_wait(&c->cond_wakeup_background, &c->mutex);
+            continue;
+        }
+
+        to_read = FFMIN(c->high_watermark - fifo_size, READ_BLOCK_SIZE);
+        pthread_mutex_unlock(&c->mutex);
+        ret = ffurl_read(c->inner, buf, to_read);
+        pthread_mutex_lock(&c->mutex);
+
+        if (ret > 0)
+            av_fifo_generic_write(c->fifo, buf, ret, NULL);
+        else if (ret == 0 || ret == AVERROR_EOF)
+            c->io_eof_reached = 1;
+        else
+            c->io_error = ret;
+        pthread_cond_signal(&c->cond_wakeup_main);
+    }
+    pthread_mutex_unlock(&c->mutex);
+
+    return NULL;
+}
+
+static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
+{
+    Context *c = h->priv_data;
+    int ret;
+
+    av_strstart(arg, "async:", &arg);
+
+    if (c->high_watermark <= 0 || c->high_watermark > c->buffer_size)
+        c->high_watermark = c->buffer_size;
+    if (c->low_watermark <= 0 || c->low_watermark > c->high_watermark)
+        c->low_watermark = c->high_watermark / 2;
+
+    c->fifo = av_fifo_alloc(c->buffer_size);
+    if (!c->fifo)
+        return AVERROR(ENOMEM);
+
+    c->interrupt_callback.callback = async_check_interrupt;
+    c->interrupt_callback.opaque   = h;
+
+    ret = ffurl_open(&c->inner, arg, flags, &c->interrupt_callback, options);
+    if (ret < 0) {
+        av_log(h, AV_LOG_ERROR, "ffurl_open failed : %s, %s\n", av_err2str(ret), arg);
+        goto url_fail;
+    }
+
+    c->logical_size = ffurl_size(c->inner);
+    h->is_streamed  = c->inner->is_streamed;
+    c->filling      = 1;
+
+    ret = AVERROR(pthread_mutex_init(&c->mutex, NULL));
+    if (ret < 0) {
+        av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", av_err2str(ret));
+        goto mutex_fail;
+    }
+    ret = AVERROR(pthread_cond_init(&c->cond_wakeup_main, NULL));
+    if (ret < 0) {
+        av_log(h, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", av_err2str(ret));
+        goto cond_wakeup_main_fail;
+    }
+    ret = AVERROR(pthread_cond_init(&c->cond_wakeup_background, NULL));
+    if (ret < 0) {
+        av_log(h, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", av_err2str(ret));
+        goto cond_wakeup_background_fail;
+    }
+    ret = AVERROR(pthread_create(&c->async_buffer_thread, NULL, async_buffer_task, h));
+    if (ret < 0) {
+        av_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", av_err2str(ret));
+        goto thread_fail;
+    }
+
+    return 0;
+
+thread_fail:
+    pthread_cond_destroy(&c->cond_wakeup_background);
+cond_wakeup_background_fail:
+    pthread_cond_destroy(&c->cond_wakeup_main);
+cond_wakeup_main_fail:
+    pthread_mutex_destroy(&c->mutex);
+mutex_fail:
+    ffurl_close(c->inner);
+url_fail:
+    av_fifo_freep(&c->fifo);
+    return ret;
+}
+
+static int async_close(URLContext *h)
+{
+    Context *c = h->priv_data;
+    int ret;
+
+    pthread_mutex_lock(&c->mutex);
+    c->abort_request = 1;
+    pthread_cond_signal(&c->cond_wakeup_background);
+    pthread_mutex_unlock(&c->mutex);
+
+    ret = pthread_join(c->async_buffer_thread, NULL);
+    if (ret != 0)
+        av_log(h, AV_LOG_ERROR, "pthread_join(): %s\n", av_err2str(AVERROR(ret)));
+
+    av_log(h, AV_LOG_VERBOSE,
+           "%"PRId64" bytes read, %d stalls, %"PRId64" ms spent waiting for data\n",
+           c->bytes_read, c->stall_count, c->stall_time / 1000);
+
+    pthread_cond_destroy(&c->cond_wakeup_background);
+    pthread_cond_destroy(&c->cond_wakeup_main);
+    pthread_mutex_destroy(&c->mutex);
+    ffurl_close(c->inner);
+    av_fifo_freep(&c->fifo);
+
+    return 0;
+}
+
+static int async_read(URLContext *h, unsigned char *buf, int size)
+{
+    Context *c         = h->priv_data;
+    int64_t stall_start = 0;
+    int ret;
+
+    pthread_mutex_lock(&c->mutex);
+    for (;;) {
+        int fifo_size = av_fifo_size(c->fifo);
+
+        if (fifo_size > 0) {
+            ret = FFMIN(fifo_size, size);
+            av_fifo_generic_read(c->fifo, buf, ret, NULL);
+            c->logical_pos += ret;
+            c->bytes_read  += ret;
+            if (fifo_size - ret < c->low_watermark)
+                pthread_cond_signal(&c->cond_wakeup_background);
+            break;
+        } else if (c->io_error) {
+            ret = c->io_error;
+            break;
+        } else if (c->io_eof_reached) {
+            ret = AVERROR_EOF;
+            break;
+        } else if (ff_check_interrupt(&h->interrupt_callback)) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+
+        if (!stall_start) {
+            stall_start = av_gettime();
+            c->stall_count++;
+        }
+        pthread_cond_signal(&c->cond_wakeup_background);
+        pthread_cond_wait(&c->cond_wakeup_main, &c->mutex);
+    }
+    if (stall_start)
+        c->stall_time += av_gettime() - stall_start;
+    pthread_mutex_unlock(&c->mutex);
+
+    return ret;
+}
+
+static int64_t async_seek(URLContext *h, int64_t pos, int whence)
+{
+    Context *c = h->priv_data;
+    int64_t ret;
+
+    if (whence == AVSEEK_SIZE)
+        return c->logical_size;
+
+    if (whence == SEEK_CUR) {
+        pos   += c->logical_pos;
+        whence = SEEK_SET;
+    } else if (whence == SEEK_END && c->logical_size >= 0) {
+        pos   += c->logical_size;
+        whence = SEEK_SET;
+    } else if (whence != SEEK_SET && whence != SEEK_END) {
+        return AVERROR(EINVAL);
+    }
+
+    pthread_mutex_lock(&c->mutex);
+
+    /* short forward seeks are served from the data already read ahead */
+    if (whence == SEEK_SET && pos >= c->logical_pos &&
+        pos - c->logical_pos <= av_fifo_size(c->fifo)) {
+        av_fifo_drain(c->fifo, pos - c->logical_pos);
+        c->logical_pos = pos;
+        pthread_cond_signal(&c->cond_wakeup_background);
+        pthread_mutex_unlock(&c->mutex);
+        return pos;
+    }
+
+    c->seek_request   = 1;
+    c->seek_pos       = pos;
+    c->seek_whence    = whence;
+    c->seek_completed = 0;
+    pthread_cond_signal(&c->cond_wakeup_background);
+    while (!c->seek_completed)
+        pthread_cond_wait(&c->cond_wakeup_main, &c->mutex);
+
+    ret = c->seek_ret;
+    if (ret >= 0)
+        c->logical_pos = ret;
+    pthread_mutex_unlock(&c->mutex);
+
+    return ret;
+}
+
+#define OFFSET(x) offsetof(Context, x)
+#define D AV_OPT_FLAG_DECODING_PARAM
+
+static const AVOption options[] = {
+    { "async_buffer_size", "size of the read-ahead buffer", OFFSET(buffer_size), AV_OPT_TYPE_INT, { .i64 = 4 * 1024 * 1024 }, READ_BLOCK_SIZE, INT_MAX, D },
+    { "high_watermark", "stop reading ahead once this many bytes are buffered (0 = buffer size)", OFFSET(high_watermark), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, D },
+    { "low_watermark", "resume reading ahead once fewer bytes than this are buffered (0 = half the high watermark)", OFFSET(low_watermark), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, D },
+    { NULL },
+};
+
+static const AVClass async_context_class = {
+    .class_name = "Async",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+URLProtocol ff_async_protocol = {
+    .name                = "async",
+    .url_open2           = async_open,
+    .url_read            = async_read,
+    .url_seek            = async_seek,
+    .url_close           = async_close,
+    .priv_data_size      = sizeof(Context),
+    .priv_data_class     = &async_context_class,
+};
@@ -921,6 +921,12 @@ typedef struct AVStream {
         int64_t fps_last_dts;
         int     fps_last_dts_idx;
 
+        /**
+         * Cost of analyzing the stream: bytes read and time spent
+         * decoding, in microseconds.
+         */
+        int64_t read_size;
+        int64_t decode_time;
     } *info;
 
     int pts_wrap_bits; /**< number of bits in pts (used for wrapping control) */
@@ -1283,6 +1289,7 @@ typedef struct AVFormatContext {
 #define AVFMT_FLAG_SORT_DTS    0x10000 ///< try to interleave outputted packets by dts (using this flag can slow demuxing down)
 #define AVFMT_FLAG_PRIV_OPT    0x20000 ///< Enable use of private options by delaying codec open (this could be made default once all code is converted)
 #define AVFMT_FLAG_KEEP_SIDE_DATA 0x40000 ///< Don't merge side data but keep it separate.
+#define AVFMT_FLAG_FAST_INFO  0x80000 ///< Do not estimate the frame rate in avformat_find_stream_info() when the container gives one
 
     /**
      * Maximum size of the data read from input for determining
@@ -1660,6 +1667,15 @@ typedef struct AVFormatContext {
      * Can be set to 0 to let avformat choose using a heuristic.
      */
     int64_t max_analyze_duration2;
+
+    /**
+     * Number of threads decoding the frames of different streams in
+     * parallel in avformat_find_stream_info(). 1 decodes them in the
+     * calling thread, 0 picks a number automatically.
+     * Demuxing only, set by the caller before avformat_find_stream_info()
+     * via AVOptions (NO direct access).
+     */
+    int info_threads;
 } AVFormatContext;
 
 int av_format_get_probe_score(const AVFormatContext *s);
@@ -62,6 +62,17 @@ int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsig
  */
 int ffio_read_partial(AVIOContext *s, unsigned char *buf, int size);
 
+/**
+ * Read size bytes from AVIOContext as a reference to the data of the
+ * underlying protocol, without copying them, if the protocol supports it
+ * (e.g. a memory mapped file).
+ * The buffer is read-only and its size includes FF_INPUT_BUFFER_PADDING_SIZE
+ * zeroed bytes of padding following the data.
+ * @return size on success, a negative AVERROR if the data cannot be read
+ *         this way, in which case nothing is consumed
+ */
+int ffio_read_ref(AVIOContext *s, AVBufferRef **buf, int size);
+
 void ffio_fill(AVIOContext *s, int b, int count);
 
 static av_always_inline void ffio_wfourcc(AVIOContext *pb, const uint8_t *s)
@@ -565,6 +565,36 @@ int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsig
     }
 }
 
+int ffio_read_ref(AVIOContext *s, AVBufferRef **buf, int size)
+{
+    URLContext *h = s->opaque;
+    int64_t pos   = avio_tell(s);
+    int ret;
+
+    if (s->read_packet != (void*)ffurl_read || s->write_flag ||
+        s->update_checksum || !h->prot->url_get_buffer || pos < 0)
+        return AVERROR(ENOSYS);
+
+    ret = h->prot->url_get_buffer(h, pos, size, buf);
+    if (ret < 0)
+        return ret;
+
+    /* skip the data, dropping the buffer content if it does not cover it */
+    if (pos + size <= s->pos) {
+        s->buf_ptr += size;
+    } else {
+        int64_t res = s->seek(s->opaque, pos + size, SEEK_SET);
+        if (res < 0) {
+            av_buffer_unref(buf);
+            return res;
+        }
+        s->buf_end = s->buf_ptr = s->buffer;
+        s->pos = pos + size;
+        s->eof_reached = 0;
+    }
+    return size;
+}
+
 int ffio_read_partial(AVIOContext *s, unsigned char *buf, int size)
 {
     int len;
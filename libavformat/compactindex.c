@@ -0,0 +1,397 @@
+/*
+ * Compact in-memory index of a stream's samples
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Compact index: runs of entries are stored as
+ * count, timestamp delta, position gap, size and flags/distance step,
+ * each as a variable length integer of 7 bits per byte. Constant sample
+ * durations and sizes in contiguous chunks thus take a few bytes per run
+ * instead of an AVIndexEntry per sample.
+ */
+
+#include <string.h>
+
+#include "libavutil/avassert.h"
+#include "libavutil/mem.h"
+#include "compactindex.h"
+
+/* count, timestamp delta, pos gap, size, flags/distance step */
+#define MAX_RUN_BYTES (5 + 10 + 10 + 5 + 10)
+
+static uint8_t *put_uvarint(uint8_t *p, uint64_t v)
+{
+    while (v > 0x7f) {
+        *p++ = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    *p++ = v;
+    return p;
+}
+
+static uint8_t *put_svarint(uint8_t *p, int64_t v)
+{
+    return put_uvarint(p, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static const uint8_t *get_uvarint(const uint8_t *p, const uint8_t *end, uint64_t *v)
+{
+    int shift = 0;
+
+    *v = 0;
+    while (p < end && shift < 64) {
+        *v |= (uint64_t)(*p & 0x7f) << shift;
+        if (!(*p++ & 0x80))
+            break;
+        shift += 7;
+    }
+    return p;
+}
+
+static const uint8_t *get_svarint(const uint8_t *p, const uint8_t *end, int64_t *v)
+{
+    uint64_t u;
+
+    p  = get_uvarint(p, end, &u);
+    *v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+    return p;
+}
+
+static int flush_run(FFCompactIndex *ci)
+{
+    FFCompactIndexRun *run = &ci->run;
+    uint8_t *data, *p;
+
+    if (!run->count)
+        return 0;
+    if (ci->data_size > UINT_MAX - MAX_RUN_BYTES)
+        return AVERROR(ENOMEM);
+    data = av_fast_realloc(ci->data, &ci->data_allocated,
+                           ci->data_size + MAX_RUN_BYTES);
+    if (!data)
+        return AVERROR(ENOMEM);
+    ci->data = data;
+
+    p = data + ci->data_size;
+    p = put_uvarint(p, run->count);
+    p = put_svarint(p, run->timestamp_delta);
+    p = put_svarint(p, run->pos_gap);
+    p = put_uvarint(p, run->size);
+    p = put_uvarint(p, run->flags | ((uint64_t)run->distance_step << 1 ^
+                                     (uint64_t)(run->distance_step >> 31)) << 2);
+    ci->data_size = p - data;
+    run->count = 0;
+    return 0;
+}
+
+int ff_compact_index_add(FFCompactIndex *ci, int64_t pos, int64_t timestamp,
+                         int size, int distance, int flags)
+{
+    AVIndexEntry *last = &ci->last;
+    FFCompactIndexRun run;
+    int ret;
+
+    if (timestamp == AV_NOPTS_VALUE || size < 0 || size > 0x3FFFFFFF)
+        return AVERROR(EINVAL);
+    if (ci->nb_entries == INT_MAX)
+        return AVERROR(ENOMEM);
+
+    if (!(ci->nb_entries % FF_COMPACT_INDEX_BLOCK_SIZE)) {
+        FFCompactIndexBlock *block;
+
+        if ((ret = flush_run(ci)) < 0)
+            return ret;
+        if (ci->nb_blocks >= UINT_MAX / sizeof(*ci->blocks) - 1)
+            return AVERROR(ENOMEM);
+        block = av_fast_realloc(ci->blocks, &ci->blocks_allocated,
+                                (ci->nb_blocks + 1) * sizeof(*ci->blocks));
+        if (!block)
+            return AVERROR(ENOMEM);
+        ci->blocks = block;
+
+        block = &ci->blocks[ci->nb_blocks++];
+        block->first_timestamp = timestamp;
+        block->prev_timestamp  = last->timestamp;
+        block->prev_end        = last->pos + last->size;
+        block->prev_distance   = last->min_distance;
+        block->data_offset     = ci->data_size;
+    }
+
+    run.count           = 1;
+    run.timestamp_delta = timestamp - last->timestamp;
+    run.pos_gap         = pos - (last->pos + last->size);
+    run.size            = size;
+    run.flags           = flags & 3;
+    run.distance_step   = distance - (last->min_distance + 1);
+
+    if (ci->run.count &&
+        ci->run.timestamp_delta == run.timestamp_delta &&
+        ci->run.pos_gap         == run.pos_gap         &&
+        ci->run.size            == run.size            &&
+        ci->run.flags           == run.flags           &&
+        ci->run.distance_step   == run.distance_step) {
+        ci->run.count++;
+    } else {
+        if ((ret = flush_run(ci)) < 0)
+            return ret;
+        ci->run = run;
+    }
+
+    last->pos          = pos;
+    last->timestamp    = timestamp;
+    last->size         = size;
+    last->flags        = flags;
+    last->min_distance = distance;
+    ci->nb_entries++;
+
+    /* the last block gained an entry */
+    if (ci->cached_block == ci->nb_blocks)
+        ci->cached_block = 0;
+    return 0;
+}
+
+static int apply_run(const FFCompactIndexRun *run, AVIndexEntry *prev,
+                     AVIndexEntry *entries, int n)
+{
+    unsigned i;
+
+    for (i = 0; i < run->count && n < FF_COMPACT_INDEX_BLOCK_SIZE; i++) {
+        AVIndexEntry *e = &entries[n++];
+        e->pos          = prev->pos + prev->size + run->pos_gap;
+        e->timestamp    = prev->timestamp + run->timestamp_delta;
+        e->size         = run->size;
+        e->flags        = run->flags;
+        e->min_distance = prev->min_distance + 1 + run->distance_step;
+        *prev = *e;
+    }
+    return n;
+}
+
+static void decode_block(FFCompactIndex *ci, unsigned b)
+{
+    const FFCompactIndexBlock *block = &ci->blocks[b];
+    const uint8_t *p   = ci->data + block->data_offset;
+    const uint8_t *end = ci->data + (b + 1 < ci->nb_blocks ?
+                                     ci->blocks[b + 1].data_offset : ci->data_size);
+    AVIndexEntry prev = { 0 };
+    int n = 0;
+
+    prev.pos          = block->prev_end;
+    prev.timestamp    = block->prev_timestamp;
+    prev.min_distance = block->prev_distance;
+
+    while (p < end) {
+        FFCompactIndexRun run;
+        uint64_t u;
+        int64_t dist;
+
+        p = get_uvarint(p, end, &u);
+        run.count = u;
+        p = get_svarint(p, end, &run.timestamp_delta);
+        p = get_svarint(p, end, &run.pos_gap);
+        p = get_uvarint(p, end, &u);
+        run.size = u;
+        p = get_uvarint(p, end, &u);
+        run.flags = u & 3;
+        dist = (int64_t)(u >> 3) ^ -(int64_t)((u >> 2) & 1);
+        run.distance_step = dist;
+        n = apply_run(&run, &prev, ci->cache, n);
+    }
+    if (b == ci->nb_blocks - 1)
+        n = apply_run(&ci->run, &prev, ci->cache, n);
+
+    av_assert1(n == FFMIN(ci->nb_entries - b * FF_COMPACT_INDEX_BLOCK_SIZE,
+                          FF_COMPACT_INDEX_BLOCK_SIZE));
+    ci->cached_block = b + 1;
+}
+
+AVIndexEntry *ff_compact_index_get(FFCompactIndex *ci, int n)
+{
+    unsigned b = n / FF_COMPACT_INDEX_BLOCK_SIZE;
+
+    if (n < 0 || n >= ci->nb_entries)
+        return NULL;
+    if (ci->cached_block != b + 1)
+        decode_block(ci, b);
+    return &ci->cache[n % FF_COMPACT_INDEX_BLOCK_SIZE];
+}
+
+/* last block whose first entry is before (or, if inclusive, at) timestamp */
+static int find_block(const FFCompactIndex *ci, int64_t timestamp, int inclusive)
+{
+    int a = -1, b = ci->nb_blocks;
+
+    while (b - a > 1) {
+        int m = (a + b) >> 1;
+        int64_t ts = ci->blocks[m].first_timestamp;
+        if (ts < timestamp || (inclusive && ts == timestamp))
+            a = m;
+        else
+            b = m;
+    }
+    return a;
+}
+
+int ff_compact_index_search_timestamp(FFCompactIndex *ci,
+                                      int64_t wanted_timestamp, int flags)
+{
+    int nb_entries = ci->nb_entries;
+    int a, b, m, block, i, n;
+
+    /* a: last entry at or before wanted_timestamp */
+    a = -1;
+    block = find_block(ci, wanted_timestamp, 1);
+    if (block >= 0) {
+        n = FFMIN(nb_entries - block * FF_COMPACT_INDEX_BLOCK_SIZE,
+                  FF_COMPACT_INDEX_BLOCK_SIZE);
+        ff_compact_index_get(ci, block * FF_COMPACT_INDEX_BLOCK_SIZE);
+        for (i = n - 1; i > 0 && ci->cache[i].timestamp > wanted_timestamp; i--)
+            ;
+        a = block * FF_COMPACT_INDEX_BLOCK_SIZE + i;
+    }
+
+    /* b: first entry at or after wanted_timestamp */
+    b = 0;
+    block = find_block(ci, wanted_timestamp, 0);
+    if (block >= 0) {
+        n = FFMIN(nb_entries - block * FF_COMPACT_INDEX_BLOCK_SIZE,
+                  FF_COMPACT_INDEX_BLOCK_SIZE);
+        ff_compact_index_get(ci, block * FF_COMPACT_INDEX_BLOCK_SIZE);
+        for (i = 1; i < n && ci->cache[i].timestamp < wanted_timestamp; i++)
+            ;
+        b = block * FF_COMPACT_INDEX_BLOCK_SIZE + i;
+    }
+
+    m = (flags & AVSEEK_FLAG_BACKWARD) ? a : b;
+
+    if (!(flags & AVSEEK_FLAG_ANY))
+        while (m >= 0 && m < nb_entries &&
+               !(ff_compact_index_get(ci, m)->flags & AVINDEX_KEYFRAME))
+            m += (flags & AVSEEK_FLAG_BACKWARD) ? -1 : 1;
+
+    if (m == nb_entries)
+        return -1;
+    return m;
+}
+
+void ff_compact_index_reset(FFCompactIndex *ci)
+{
+    ci->nb_entries   = 0;
+    ci->nb_blocks    = 0;
+    ci->data_size    = 0;
+    ci->run.count    = 0;
+    ci->cached_block = 0;
+    memset(&ci->last, 0, sizeof(ci->last));
+}
+
+void ff_compact_index_free(FFCompactIndex *ci)
+{
+    av_freep(&ci->blocks);
+    av_freep(&ci->data);
+    ci->blocks_allocated = 0;
+    ci->data_allocated   = 0;
+    ff_compact_index_reset(ci);
+}
+
+size_t ff_compact_index_size(const FFCompactIndex *ci)
+{
+    return ci->blocks_allocated + ci->data_allocated;
+}
+
+#ifdef TEST
+#include <stdio.h>
+
+#include "libavutil/lfg.h"
+#include "internal.h"
+
+static int check(FFCompactIndex *ci, const AVIndexEntry *entries, int nb_entries)
+{
+    int64_t max_ts = entries[nb_entries - 1].timestamp;
+    int i, flags;
+
+    if (ci->nb_entries != nb_entries)
+        return 1;
+    for (i = 0; i < nb_entries; i++) {
+        const AVIndexEntry *a = &entries[i];
+        const AVIndexEntry *b = ff_compact_index_get(ci, i);
+        if (!b || a->pos != b->pos || a->timestamp != b->timestamp ||
+            a->size != b->size || a->flags != b->flags ||
+            a->min_distance != b->min_distance) {
+            printf("entry %d differs\n", i);
+            return 1;
+        }
+    }
+    for (flags = 0; flags < 8; flags++) {
+        int64_t ts;
+        for (ts = -3; ts <= max_ts + 3; ts++) {
+            int a = ff_index_search_timestamp(entries, nb_entries, ts, flags);
+            int b = ff_compact_index_search_timestamp(ci, ts, flags);
+            if (a != b) {
+                printf("search %"PRId64" flags %d: %d instead of %d\n", ts, flags, b, a);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    static AVIndexEntry entries[10000];
+    FFCompactIndex ci = { 0 };
+    AVLFG lfg;
+    int64_t pos = 48, ts = 0;
+    int i, distance = 0, ret = 0;
+
+    av_lfg_init(&lfg, 1);
+
+    /* runs of constant frames in chunks, keyframes and varying sizes */
+    for (i = 0; i < FF_ARRAY_ELEMS(entries); i++) {
+        AVIndexEntry *e = &entries[i];
+        unsigned r = av_lfg_get(&lfg);
+        int key = !(i % 30) || !(r & 0x3f);
+
+        distance = key ? 0 : distance + 1;
+        if (!(i % 7))
+            pos += r & 0xfff;
+        e->pos          = pos;
+        e->timestamp    = ts;
+        e->size         = i < 5000 ? 1024 : (r >> 8) & 0xffff;
+        e->flags        = key ? AVINDEX_KEYFRAME : 0;
+        e->min_distance = distance;
+        if (ff_compact_index_add(&ci, e->pos, e->timestamp, e->size,
+                                 e->min_distance, e->flags) < 0)
+            return 1;
+        pos += e->size;
+        ts  += i % 100 < 90 ? 3 : 1 + ((r >> 24) & 3);
+
+        /* check while the last block is being filled too */
+        if (i == 300 || i == 1000)
+            ret |= check(&ci, entries, i + 1);
+    }
+    ret |= check(&ci, entries, FF_ARRAY_ELEMS(entries));
+    printf("%d entries, %s\n", ci.nb_entries, ret ? "failed" : "ok");
+
+    ff_compact_index_reset(&ci);
+    ret |= ci.nb_entries != 0 || ff_compact_index_get(&ci, 0) != NULL;
+    ff_compact_index_free(&ci);
+    return ret;
+}
+#endif /* TEST */
@@ -0,0 +1,120 @@
+/*
+ * Compact in-memory index of a stream's samples
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_COMPACTINDEX_H
+#define AVFORMAT_COMPACTINDEX_H
+
+#include <stdint.h>
+
+#include "avformat.h"
+
+#define FF_COMPACT_INDEX_BLOCK_SIZE 256
+
+/**
+ * Start of a block of up to FF_COMPACT_INDEX_BLOCK_SIZE entries. The
+ * entries of a block are predicted from the entry preceding the block.
+ */
+typedef struct FFCompactIndexBlock {
+    int64_t first_timestamp;    ///< timestamp of the first entry of the block
+    int64_t prev_timestamp;     ///< timestamp of the entry before the block
+    int64_t prev_end;           ///< pos + size of the entry before the block
+    int prev_distance;          ///< min_distance of the entry before the block
+    unsigned data_offset;       ///< offset of the first run in data
+} FFCompactIndexBlock;
+
+/**
+ * Run of consecutive entries that differ from their predecessor in the
+ * same way: same timestamp delta, same gap between the end of one entry
+ * and the start of the next, same size, flags and distance step.
+ */
+typedef struct FFCompactIndexRun {
+    unsigned count;
+    int64_t  timestamp_delta;
+    int64_t  pos_gap;
+    int      size;
+    int      flags;
+    int      distance_step;     ///< min_distance - (previous min_distance + 1)
+} FFCompactIndexRun;
+
+/**
+ * Index of AVIndexEntry elements with nondecreasing timestamps, stored as
+ * runs of delta coded entries in blocks with a sparse top level, instead
+ * of one full AVIndexEntry per entry. Entries can only be appended.
+ *
+ * Entries are decoded a block at a time into a cache, so sequential
+ * access is cheap; random access decodes at most one block.
+ */
+typedef struct FFCompactIndex {
+    int nb_entries;
+
+    FFCompactIndexBlock *blocks;
+    unsigned nb_blocks;
+    unsigned blocks_allocated;
+
+    uint8_t *data;              ///< encoded runs of all blocks
+    unsigned data_size;
+    unsigned data_allocated;
+
+    FFCompactIndexRun run;      ///< last run, not yet in data
+    AVIndexEntry last;          ///< last entry added
+
+    AVIndexEntry cache[FF_COMPACT_INDEX_BLOCK_SIZE];
+    unsigned cached_block;      ///< 1 + index of the block in cache, 0 if none
+} FFCompactIndex;
+
+/**
+ * Append an entry to the index. Its timestamp must not be smaller than
+ * the one of the previous entry for searches to work.
+ *
+ * @return 0 on success, a negative AVERROR on failure
+ */
+int ff_compact_index_add(FFCompactIndex *ci, int64_t pos, int64_t timestamp,
+                         int size, int distance, int flags);
+
+/**
+ * Get entry n of the index. The returned entry is only valid until the
+ * next call of a function on the index; changes to it are not kept.
+ *
+ * @return the entry, or NULL if n is out of range
+ */
+AVIndexEntry *ff_compact_index_get(FFCompactIndex *ci, int n);
+
+/**
+ * Same as ff_index_search_timestamp(), for a compact index.
+ */
+int ff_compact_index_search_timestamp(FFCompactIndex *ci,
+                                      int64_t wanted_timestamp, int flags);
+
+/**
+ * Remove all entries, keeping the allocated memory.
+ */
+void ff_compact_index_reset(FFCompactIndex *ci);
+
+/**
+ * Free all memory of the index, leaving it empty.
+ */
+void ff_compact_index_free(FFCompactIndex *ci);
+
+/**
+ * @return the number of bytes allocated for the entries of the index
+ */
+size_t ff_compact_index_size(const FFCompactIndex *ci);
+
+#endif /* AVFORMAT_COMPACTINDEX_H */
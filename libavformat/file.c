@@ -32,6 +32,9 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include "os_support.h"
 #include "url.h"
 
@@ -44,18 +47,36 @@
 #  endif
 #endif
 
+/* amount of data ahead of the read position the system is asked to
+ * read in when the file is mapped */
+#define MMAP_READAHEAD (4 << 20)
+
+/* smaller packets are copied: mapping and faulting in a packet of its own
+ * only beats the copy from about 170 KiB up */
+#define MMAP_MIN_REF_SIZE (256 << 10)
+
 /* standard file protocol */
 
+typedef struct FileMapping {
+    uint8_t *addr;
+    int64_t size;
+} FileMapping;
+
 typedef struct FileContext {
     const AVClass *class;
     int fd;
     int trunc;
     int blocksize;
+    int use_mmap;
+    AVBufferRef *map;       ///< FileMapping of the whole file, if mapped
+    int64_t map_pos;        ///< read position in the mapping
+    int64_t advised;        ///< end of the range last hinted to the system
 } FileContext;
 
 static const AVOption file_options[] = {
     { "truncate", "truncate existing files on write", offsetof(FileContext, trunc), AV_OPT_TYPE_INT, { .i64 = 1 }, 0, 1, AV_OPT_FLAG_ENCODING_PARAM },
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
+    { "mmap", "map files opened for reading into memory", offsetof(FileContext, use_mmap), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL }
 };
 
@@ -78,11 +99,140 @@ static const AVClass pipe_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+#if HAVE_MMAP
+static void file_unmap(void *opaque, uint8_t *data)
+{
+    FileMapping *m = (FileMapping *)data;
+    munmap(m->addr, m->size);
+    av_free(m);
+}
+
+static int file_map(URLContext *h, const struct stat *st)
+{
+    FileContext *c = h->priv_data;
+    FileMapping *m;
+    void *addr;
+
+    if (!S_ISREG(st->st_mode) || st->st_size <= 0 || st->st_size > SIZE_MAX)
+        return AVERROR(ENOSYS);
+
+    addr = mmap(NULL, st->st_size, PROT_READ, MAP_SHARED, c->fd, 0);
+    if (addr == MAP_FAILED)
+        return AVERROR(errno);
+#ifdef MADV_SEQUENTIAL
+    madvise(addr, st->st_size, MADV_SEQUENTIAL);
+#endif
+
+    m = av_mallocz(sizeof(*m));
+    if (!m) {
+        munmap(addr, st->st_size);
+        return AVERROR(ENOMEM);
+    }
+    m->addr = addr;
+    m->size = st->st_size;
+    c->map = av_buffer_create((uint8_t *)m, sizeof(*m), file_unmap, NULL, 0);
+    if (!c->map) {
+        munmap(addr, st->st_size);
+        av_free(m);
+        return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+/**
+ * Ask the system to read in the part of the mapping following pos,
+ * a window at a time.
+ */
+static void file_advise(FileContext *c, int64_t pos)
+{
+#ifdef MADV_WILLNEED
+    FileMapping *m = (FileMapping *)c->map->data;
+    int64_t start, end;
+
+    if (pos > c->advised || pos < c->advised - MMAP_READAHEAD)
+        c->advised = pos;
+    if (c->advised - pos >= MMAP_READAHEAD / 2 || c->advised >= m->size)
+        return;
+
+    start = c->advised & ~(int64_t)(sysconf(_SC_PAGESIZE) - 1);
+    end   = FFMIN(pos + MMAP_READAHEAD, m->size);
+    madvise(m->addr + start, end - start, MADV_WILLNEED);
+    c->advised = end;
+#endif
+}
+
+static int file_read_map(URLContext *h, unsigned char *buf, int size)
+{
+    FileContext *c  = h->priv_data;
+    FileMapping *m  = (FileMapping *)c->map->data;
+
+    size = FFMIN(size, m->size - c->map_pos);
+    if (size <= 0)
+        return 0;
+    memcpy(buf, m->addr + c->map_pos, size);
+    c->map_pos += size;
+    file_advise(c, c->map_pos);
+    return size;
+}
+
+static void file_unmap_packet(void *opaque, uint8_t *data)
+{
+    FileMapping *m = opaque;
+    munmap(m->addr, m->size);
+    av_free(m);
+}
+
+static int file_get_buffer(URLContext *h, int64_t pos, int size, AVBufferRef **buf)
+{
+    FileContext *c = h->priv_data;
+    FileMapping *m, *pm;
+    int64_t page = sysconf(_SC_PAGESIZE), start, off;
+    void *addr;
+
+    if (!c->map)
+        return AVERROR(ENOSYS);
+    m = (FileMapping *)c->map->data;
+    /* the padding must be readable too; copy the end of the file */
+    if (pos < 0 || size < MMAP_MIN_REF_SIZE ||
+        pos + size + FF_INPUT_BUFFER_PADDING_SIZE > m->size)
+        return AVERROR(ENOSYS);
+
+    /* map the packet on its own, privately, so that its padding can be
+     * zeroed: only the page holding the padding is copied */
+    start = pos & ~(page - 1);
+    off   = pos - start;
+    pm    = av_mallocz(sizeof(*pm));
+    if (!pm)
+        return AVERROR(ENOMEM);
+    pm->size = off + size + FF_INPUT_BUFFER_PADDING_SIZE;
+    addr = mmap(NULL, pm->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, c->fd, start);
+    if (addr == MAP_FAILED) {
+        av_free(pm);
+        return AVERROR(errno);
+    }
+    pm->addr = addr;
+    memset(pm->addr + off + size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+
+    *buf = av_buffer_create(pm->addr + off, size + FF_INPUT_BUFFER_PADDING_SIZE,
+                            file_unmap_packet, pm, AV_BUFFER_FLAG_READONLY);
+    if (!*buf) {
+        file_unmap_packet(pm, NULL);
+        return AVERROR(ENOMEM);
+    }
+    file_advise(c, pos + size);
+    return size;
+}
+#endif /* HAVE_MMAP */
+
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int r;
     size = FFMIN(size, c->blocksize);
+#if HAVE_MMAP
+    if (c->map)
+        return file_read_map(h, buf, size);
+#endif
     r = read(c->fd, buf, size);
     return (-1 == r)?AVERROR(errno):r;
 }
@@ -163,6 +313,15 @@ static int file_open(URLContext *h, const char *filename, int flags)
 
     h->is_streamed = !fstat(fd, &st) && S_ISFIFO(st.st_mode);
 
+#if HAVE_MMAP
+    if (c->use_mmap && !(flags & AVIO_FLAG_WRITE) && !fstat(fd, &st)) {
+        int ret = file_map(h, &st);
+        if (ret < 0)
+            av_log(h, AV_LOG_VERBOSE, "Not mapping %s: %s\n",
+                   filename, av_err2str(ret));
+    }
+#endif
+
     return 0;
 }
 
@@ -172,6 +331,26 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
     FileContext *c = h->priv_data;
     int64_t ret;
 
+#if HAVE_MMAP
+    if (c->map) {
+        FileMapping *m = (FileMapping *)c->map->data;
+
+        if (whence == AVSEEK_SIZE)
+            return m->size;
+        if (whence == SEEK_CUR)
+            pos += c->map_pos;
+        else if (whence == SEEK_END)
+            pos += m->size;
+        else if (whence != SEEK_SET)
+            return AVERROR(EINVAL);
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        c->map_pos = pos;
+        file_advise(c, pos);
+        return pos;
+    }
+#endif
+
     if (whence == AVSEEK_SIZE) {
         struct stat st;
         ret = fstat(c->fd, &st);
@@ -186,6 +365,7 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
+    av_buffer_unref(&c->map);
     return close(c->fd);
 }
 
@@ -198,6 +378,9 @@ URLProtocol ff_file_protocol = {
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
     .url_check           = file_check,
+#if HAVE_MMAP
+    .url_get_buffer      = file_get_buffer,
+#endif
     .priv_data_size      = sizeof(FileContext),
     .priv_data_class     = &file_class,
 };
@@ -26,6 +26,12 @@
  * http://tools.ietf.org/html/draft-pantos-http-live-streaming
  */
 
+#include "config.h"
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #include "libavutil/avstring.h"
 #include "libavutil/avassert.h"
 #include "libavutil/intreadwrite.h"
@@ -40,6 +46,8 @@
 #include "id3v2.h"
 
 #define INITIAL_BUFFER_SIZE 32768
+#define MAX_PREFETCH_SEGMENTS 8
+#define PREFETCH_CHUNK_SIZE 32768
 
 #define MAX_FIELD_LEN 64
 #define MAX_CHARACTERISTICS_LEN 512
@@ -74,6 +82,37 @@ struct segment {
     uint8_t iv[16];
 };
 
+#if HAVE_PTHREADS
+/*
+ * A segment downloaded ahead of time by a background thread. At most
+ * max_size bytes of it are kept in memory; if the segment is larger, the
+ * download stops there and the reader continues from the still open input
+ * once the buffered data has been consumed.
+ */
+struct segment_prefetch {
+    int seq_no;
+    struct segment seg;             /* private copy, the playlist may be reloaded */
+    uint8_t key[16];
+    AVDictionary *opts;
+    AVFormatContext *parent;
+    AVIOInterruptCB interrupt_callback;
+
+    URLContext *input;
+    uint8_t *buf;
+    unsigned int buf_alloc;
+    int buf_len;                    /* bytes downloaded so far */
+    int buf_pos;                    /* bytes consumed by the reader */
+    int max_size;
+    int done;
+    int ret;                        /* >= 0 if input is still open */
+    int abort;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+};
+#endif
+
 struct rendition;
 
 enum PlaylistType {
@@ -112,6 +151,13 @@ struct playlist {
     char key_url[MAX_URL_SIZE];
     uint8_t key[16];
 
+    /* Segments following cur_seq_no that are being downloaded in the
+     * background, in sequence order, and the one currently being read if
+     * it was downloaded that way. */
+    struct segment_prefetch *prefetch[MAX_PREFETCH_SEGMENTS];
+    int n_prefetch;
+    struct segment_prefetch *cur_prefetch;
+
     /* ID3 timestamp handling (elementary audio streams have ID3 timestamps
      * (and possibly other ID3 tags) in the beginning of each segment) */
     int is_id3_timestamped; /* -1: not yet known */
@@ -164,6 +210,7 @@ struct variant {
 };
 
 typedef struct HLSContext {
+    AVClass *class;
     int n_variants;
     struct variant **variants;
     int n_playlists;
@@ -179,6 +226,9 @@ typedef struct HLSContext {
     char *user_agent;                    ///< holds HTTP user agent set as an AVOption to the HTTP protocol context
     char *cookies;                       ///< holds HTTP cookie values set in either the initial response or as an AVOption to the HTTP protocol context
     char *headers;                       ///< holds HTTP headers set as an AVOption to the HTTP protocol context
+    char *reuse_connections;             ///< holds the HTTP connection reuse setting of the HTTP protocol context
+    int prefetch_segments;
+    int prefetch_buffer_size;
 } HLSContext;
 
 static int read_chomp_line(AVIOContext *s, char *buf, int maxlen)
@@ -201,6 +251,50 @@ static void free_segment_list(struct playlist *pls)
     pls->n_segments = 0;
 }
 
+#if HAVE_PTHREADS
+static void free_prefetch(struct segment_prefetch **pp)
+{
+    struct segment_prefetch *p = *pp;
+
+    if (!p)
+        return;
+
+    pthread_mutex_lock(&p->mutex);
+    p->abort = 1;
+    pthread_mutex_unlock(&p->mutex);
+    pthread_join(p->thread, NULL);
+
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->mutex);
+    if (p->input)
+        ffurl_close(p->input);
+    av_dict_free(&p->opts);
+    av_free(p->seg.url);
+    av_free(p->buf);
+    av_freep(pp);
+}
+
+static void cancel_prefetch(struct playlist *pls)
+{
+    int i;
+    for (i = 0; i < pls->n_prefetch; i++)
+        free_prefetch(&pls->prefetch[i]);
+    pls->n_prefetch = 0;
+}
+#else
+static void free_prefetch(struct segment_prefetch **pp) { }
+static void cancel_prefetch(struct playlist *pls) { }
+#endif
+
+static void close_segment(struct playlist *pls)
+{
+    if (pls->input) {
+        ffurl_close(pls->input);
+        pls->input = NULL;
+    }
+    free_prefetch(&pls->cur_prefetch);
+}
+
 static void free_playlist_list(HLSContext *c)
 {
     int i;
@@ -213,8 +307,8 @@ static void free_playlist_list(HLSContext *c)
         ff_id3v2_free_extra_meta(&pls->id3_deferred_extra);
         av_free_packet(&pls->pkt);
         av_free(pls->pb.buffer);
-        if (pls->input)
-            ffurl_close(pls->input);
+        close_segment(pls);
+        cancel_prefetch(pls);
         if (pls->ctx) {
             pls->ctx->pb = NULL;
             avformat_close_input(&pls->ctx);
@@ -224,6 +318,7 @@ static void free_playlist_list(HLSContext *c)
     av_freep(&c->playlists);
     av_freep(&c->cookies);
     av_freep(&c->user_agent);
+    av_freep(&c->reuse_connections);
     c->n_playlists = 0;
 }
 
@@ -519,6 +614,7 @@ static int parse_playlist(HLSContext *c, const char *url,
         av_dict_set(&opts, "user-agent", c->user_agent, 0);
         av_dict_set(&opts, "cookies", c->cookies, 0);
         av_dict_set(&opts, "headers", c->headers, 0);
+        av_dict_set(&opts, "reuse_connections", c->reuse_connections, 0);
 
         ret = avio_open2(&in, url, AVIO_FLAG_READ,
                          c->interrupt_callback, &opts);
@@ -680,6 +776,58 @@ enum ReadFromURLMode {
     READ_COMPLETE,
 };
 
+#if HAVE_PTHREADS
+static int read_prefetched(struct playlist *pls, uint8_t *buf, int buf_size,
+                           enum ReadFromURLMode mode)
+{
+    struct segment_prefetch *p = pls->cur_prefetch;
+    int len = 0, ret;
+
+    pthread_mutex_lock(&p->mutex);
+    while (len < buf_size) {
+        int avail = p->buf_len - p->buf_pos;
+        if (avail > 0) {
+            int size = FFMIN(avail, buf_size - len);
+            memcpy(buf + len, p->buf + p->buf_pos, size);
+            p->buf_pos += size;
+            len        += size;
+            if (mode == READ_NORMAL)
+                break;
+        } else if (p->done) {
+            break;
+        } else {
+            pthread_cond_wait(&p->cond, &p->mutex);
+        }
+    }
+    pthread_mutex_unlock(&p->mutex);
+
+    if (len == buf_size || (len > 0 && mode == READ_NORMAL))
+        return len;
+
+    /* Everything kept in memory has been consumed. */
+    if (p->ret < 0)
+        return len > 0 ? len : p->ret;
+
+    /* The segment did not fit in memory, continue from where the download
+     * stopped. */
+    pls->input = p->input;
+    p->input   = NULL;
+    if (mode == READ_COMPLETE)
+        ret = ffurl_read_complete(pls->input, buf + len, buf_size - len);
+    else
+        ret = ffurl_read(pls->input, buf + len, buf_size - len);
+    if (ret < 0)
+        return len > 0 ? len : ret;
+    return len + ret;
+}
+#else
+static int read_prefetched(struct playlist *pls, uint8_t *buf, int buf_size,
+                           enum ReadFromURLMode mode)
+{
+    return AVERROR_BUG;
+}
+#endif
+
 /* read from URLContext, limiting read to current segment */
 static int read_from_url(struct playlist *pls, uint8_t *buf, int buf_size,
                          enum ReadFromURLMode mode)
@@ -691,7 +839,9 @@ static int read_from_url(struct playlist *pls, uint8_t *buf, int buf_size,
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, seg->size - pls->cur_seg_offset);
 
-    if (mode == READ_COMPLETE)
+    if (pls->cur_prefetch && !pls->input)
+        ret = read_prefetched(pls, buf, buf_size, mode);
+    else if (mode == READ_COMPLETE)
         ret = ffurl_read_complete(pls->input, buf, buf_size);
     else
         ret = ffurl_read(pls->input, buf, buf_size);
@@ -900,22 +1050,18 @@ static void intercept_id3(struct playlist *pls, uint8_t *buf,
         pls->is_id3_timestamped = (pls->id3_mpegts_timestamp != AV_NOPTS_VALUE);
 }
 
-static int open_input(HLSContext *c, struct playlist *pls)
+static void set_http_options(HLSContext *c, AVDictionary **opts)
 {
-    AVDictionary *opts = NULL;
-    AVDictionary *opts2 = NULL;
-    int ret;
-    struct segment *seg = pls->segments[pls->cur_seq_no - pls->start_seq_no];
-
     // broker prior HTTP options that should be consistent across requests
-    av_dict_set(&opts, "user-agent", c->user_agent, 0);
-    av_dict_set(&opts, "cookies", c->cookies, 0);
-    av_dict_set(&opts, "headers", c->headers, 0);
-    av_dict_set(&opts, "seekable", "0", 0);
-
-    // Same opts for key request (ffurl_open mutilates the opts so it cannot be used twice)
-    av_dict_copy(&opts2, opts, 0);
+    av_dict_set(opts, "user-agent", c->user_agent, 0);
+    av_dict_set(opts, "cookies", c->cookies, 0);
+    av_dict_set(opts, "headers", c->headers, 0);
+    av_dict_set(opts, "reuse_connections", c->reuse_connections, 0);
+    av_dict_set(opts, "seekable", "0", 0);
+}
 
+static void set_segment_range(struct segment *seg, AVDictionary **opts)
+{
     if (seg->size >= 0) {
         /* try to restrict the HTTP request to the part we want
          * (if this is in fact a HTTP request) */
@@ -925,52 +1071,39 @@ static int open_input(HLSContext *c, struct playlist *pls)
                  seg->url_offset);
         snprintf(end_offset, sizeof(end_offset) - 1, "%"PRId64,
                  seg->url_offset + seg->size);
-        av_dict_set(&opts, "offset", offset, 0);
-        av_dict_set(&opts, "end_offset", end_offset, 0);
+        av_dict_set(opts, "offset", offset, 0);
+        av_dict_set(opts, "end_offset", end_offset, 0);
     }
+}
 
-    av_log(pls->parent, AV_LOG_VERBOSE, "HLS request for url '%s', offset %"PRId64", playlist %d\n",
-           seg->url, seg->url_offset, pls->index);
+/* open the segment data, with the decryption key already known */
+static int open_segment_url(AVFormatContext *parent, URLContext **input,
+                            struct segment *seg, const uint8_t *key_data,
+                            AVDictionary **opts, AVIOInterruptCB *int_cb)
+{
+    int ret;
 
     if (seg->key_type == KEY_NONE) {
-        ret = ffurl_open(&pls->input, seg->url, AVIO_FLAG_READ,
-                          &pls->parent->interrupt_callback, &opts);
+        ret = ffurl_open(input, seg->url, AVIO_FLAG_READ, int_cb, opts);
 
     } else if (seg->key_type == KEY_AES_128) {
         char iv[33], key[33], url[MAX_URL_SIZE];
-        if (strcmp(seg->key, pls->key_url)) {
-            URLContext *uc;
-            if (ffurl_open(&uc, seg->key, AVIO_FLAG_READ,
-                           &pls->parent->interrupt_callback, &opts2) == 0) {
-                if (ffurl_read_complete(uc, pls->key, sizeof(pls->key))
-                    != sizeof(pls->key)) {
-                    av_log(NULL, AV_LOG_ERROR, "Unable to read key file %s\n",
-                           seg->key);
-                }
-                ffurl_close(uc);
-            } else {
-                av_log(NULL, AV_LOG_ERROR, "Unable to open key file %s\n",
-                       seg->key);
-            }
-            av_strlcpy(pls->key_url, seg->key, sizeof(pls->key_url));
-        }
         ff_data_to_hex(iv, seg->iv, sizeof(seg->iv), 0);
-        ff_data_to_hex(key, pls->key, sizeof(pls->key), 0);
+        ff_data_to_hex(key, key_data, 16, 0);
         iv[32] = key[32] = '\0';
         if (strstr(seg->url, "://"))
             snprintf(url, sizeof(url), "crypto+%s", seg->url);
         else
             snprintf(url, sizeof(url), "crypto:%s", seg->url);
-        if ((ret = ffurl_alloc(&pls->input, url, AVIO_FLAG_READ,
-                               &pls->parent->interrupt_callback)) < 0)
-            goto cleanup;
-        av_opt_set(pls->input->priv_data, "key", key, 0);
-        av_opt_set(pls->input->priv_data, "iv", iv, 0);
-
-        if ((ret = ffurl_connect(pls->input, &opts)) < 0) {
-            ffurl_close(pls->input);
-            pls->input = NULL;
-            goto cleanup;
+        if ((ret = ffurl_alloc(input, url, AVIO_FLAG_READ, int_cb)) < 0)
+            return ret;
+        av_opt_set((*input)->priv_data, "key", key, 0);
+        av_opt_set((*input)->priv_data, "iv", iv, 0);
+
+        if ((ret = ffurl_connect(*input, opts)) < 0) {
+            ffurl_close(*input);
+            *input = NULL;
+            return ret;
         }
         ret = 0;
     }
@@ -981,22 +1114,223 @@ static int open_input(HLSContext *c, struct playlist *pls)
      * should already be where want it to, but this allows e.g. local testing
      * without a HTTP server. */
     if (ret == 0 && seg->key_type == KEY_NONE) {
-        int seekret = ffurl_seek(pls->input, seg->url_offset, SEEK_SET);
+        int seekret = ffurl_seek(*input, seg->url_offset, SEEK_SET);
         if (seekret < 0) {
-            av_log(pls->parent, AV_LOG_ERROR, "Unable to seek to offset %"PRId64" of HLS segment '%s'\n", seg->url_offset, seg->url);
+            av_log(parent, AV_LOG_ERROR, "Unable to seek to offset %"PRId64" of HLS segment '%s'\n", seg->url_offset, seg->url);
             ret = seekret;
-            ffurl_close(pls->input);
-            pls->input = NULL;
+            ffurl_close(*input);
+            *input = NULL;
+        }
+    }
+
+    return ret;
+}
+
+static int open_input(HLSContext *c, struct playlist *pls)
+{
+    AVDictionary *opts = NULL;
+    AVDictionary *opts2 = NULL;
+    int ret;
+    struct segment *seg = pls->segments[pls->cur_seq_no - pls->start_seq_no];
+
+    set_http_options(c, &opts);
+
+    // Same opts for key request (ffurl_open mutilates the opts so it cannot be used twice)
+    av_dict_copy(&opts2, opts, 0);
+
+    set_segment_range(seg, &opts);
+
+    av_log(pls->parent, AV_LOG_VERBOSE, "HLS request for url '%s', offset %"PRId64", playlist %d\n",
+           seg->url, seg->url_offset, pls->index);
+
+    if (seg->key_type == KEY_AES_128 && strcmp(seg->key, pls->key_url)) {
+        URLContext *uc;
+        if (ffurl_open(&uc, seg->key, AVIO_FLAG_READ,
+                       &pls->parent->interrupt_callback, &opts2) == 0) {
+            if (ffurl_read_complete(uc, pls->key, sizeof(pls->key))
+                != sizeof(pls->key)) {
+                av_log(NULL, AV_LOG_ERROR, "Unable to read key file %s\n",
+                       seg->key);
+            }
+            ffurl_close(uc);
+        } else {
+            av_log(NULL, AV_LOG_ERROR, "Unable to open key file %s\n",
+                   seg->key);
         }
+        av_strlcpy(pls->key_url, seg->key, sizeof(pls->key_url));
     }
 
-cleanup:
+    ret = open_segment_url(pls->parent, &pls->input, seg, pls->key, &opts,
+                           &pls->parent->interrupt_callback);
+
     av_dict_free(&opts);
     av_dict_free(&opts2);
     pls->cur_seg_offset = 0;
     return ret;
 }
 
+#if HAVE_PTHREADS
+static int prefetch_check_interrupt(void *arg)
+{
+    struct segment_prefetch *p = arg;
+
+    if (p->abort)
+        return 1;
+
+    return ff_check_interrupt(&p->parent->interrupt_callback);
+}
+
+static void *prefetch_task(void *arg)
+{
+    struct segment_prefetch *p = arg;
+    uint8_t chunk[PREFETCH_CHUNK_SIZE];
+    int ret;
+
+    ret = open_segment_url(p->parent, &p->input, &p->seg, p->key, &p->opts,
+                           &p->interrupt_callback);
+
+    while (ret >= 0) {
+        int size = FFMIN(PREFETCH_CHUNK_SIZE, p->max_size - p->buf_len);
+        uint8_t *buf;
+
+        if (p->seg.size >= 0 && p->seg.size - p->buf_len < size) {
+            size = p->seg.size - p->buf_len;
+            if (size <= 0) {
+                ret = AVERROR_EOF;
+                break;
+            }
+        }
+        if (size <= 0)
+            break;
+
+        ret = ffurl_read(p->input, chunk, size);
+        if (ret <= 0) {
+            ret = ret ? ret : AVERROR_EOF;
+            break;
+        }
+
+        pthread_mutex_lock(&p->mutex);
+        buf = av_fast_realloc(p->buf, &p->buf_alloc, p->buf_len + ret);
+        if (buf) {
+            p->buf = buf;
+            memcpy(p->buf + p->buf_len, chunk, ret);
+            p->buf_len += ret;
+            pthread_cond_signal(&p->cond);
+        } else {
+            ret = AVERROR(ENOMEM);
+        }
+        pthread_mutex_unlock(&p->mutex);
+    }
+
+    pthread_mutex_lock(&p->mutex);
+    if (ret < 0 && p->input) {
+        ffurl_close(p->input);
+        p->input = NULL;
+    }
+    p->ret  = ret;
+    p->done = 1;
+    pthread_cond_signal(&p->cond);
+    pthread_mutex_unlock(&p->mutex);
+
+    return NULL;
+}
+
+static struct segment_prefetch *start_prefetch(HLSContext *c, struct playlist *pls,
+                                               int seq_no)
+{
+    struct segment *seg = pls->segments[seq_no - pls->start_seq_no];
+    struct segment_prefetch *p = av_mallocz(sizeof(*p));
+
+    if (!p)
+        return NULL;
+
+    p->seq_no   = seq_no;
+    p->seg      = *seg;
+    p->seg.key  = NULL;
+    p->seg.url  = av_strdup(seg->url);
+    p->parent   = pls->parent;
+    p->max_size = c->prefetch_buffer_size;
+    p->interrupt_callback.callback = prefetch_check_interrupt;
+    p->interrupt_callback.opaque   = p;
+    memcpy(p->key, pls->key, sizeof(p->key));
+    set_http_options(c, &p->opts);
+    set_segment_range(seg, &p->opts);
+    if (!p->seg.url)
+        goto fail;
+
+    if (pthread_mutex_init(&p->mutex, NULL))
+        goto fail;
+    if (pthread_cond_init(&p->cond, NULL)) {
+        pthread_mutex_destroy(&p->mutex);
+        goto fail;
+    }
+    if (pthread_create(&p->thread, NULL, prefetch_task, p)) {
+        pthread_cond_destroy(&p->cond);
+        pthread_mutex_destroy(&p->mutex);
+        goto fail;
+    }
+
+    av_log(pls->parent, AV_LOG_VERBOSE, "HLS prefetch for url '%s', offset %"PRId64", playlist %d\n",
+           seg->url, seg->url_offset, pls->index);
+    return p;
+
+fail:
+    av_dict_free(&p->opts);
+    av_free(p->seg.url);
+    av_free(p);
+    return NULL;
+}
+
+/* keep up to prefetch_segments segments after cur_seq_no downloading */
+static void prefetch_segments(HLSContext *c, struct playlist *pls)
+{
+    int seq_no = pls->cur_seq_no + 1;
+
+    if (pls->n_prefetch)
+        seq_no = FFMAX(seq_no, pls->prefetch[pls->n_prefetch - 1]->seq_no + 1);
+
+    while (pls->n_prefetch < c->prefetch_segments &&
+           seq_no < pls->start_seq_no + pls->n_segments) {
+        struct segment *seg = pls->segments[seq_no - pls->start_seq_no];
+        struct segment_prefetch *p;
+
+        /* a new key is fetched by open_input() once it is needed */
+        if (seg->key_type == KEY_AES_128 && strcmp(seg->key, pls->key_url))
+            break;
+        if (!(p = start_prefetch(c, pls, seq_no)))
+            break;
+        pls->prefetch[pls->n_prefetch++] = p;
+        seq_no++;
+    }
+}
+
+/* return the download of the current segment if it was started in advance */
+static struct segment_prefetch *take_prefetched_segment(struct playlist *pls)
+{
+    struct segment *seg = pls->segments[pls->cur_seq_no - pls->start_seq_no];
+
+    while (pls->n_prefetch && pls->prefetch[0]->seq_no <= pls->cur_seq_no) {
+        struct segment_prefetch *p = pls->prefetch[0];
+
+        pls->n_prefetch--;
+        memmove(pls->prefetch, pls->prefetch + 1,
+                pls->n_prefetch * sizeof(*pls->prefetch));
+        if (p->seq_no == pls->cur_seq_no && !strcmp(p->seg.url, seg->url) &&
+            p->seg.url_offset == seg->url_offset && p->seg.size == seg->size)
+            return p;
+        free_prefetch(&p);
+    }
+    return NULL;
+}
+#else
+static void prefetch_segments(HLSContext *c, struct playlist *pls) { }
+
+static struct segment_prefetch *take_prefetched_segment(struct playlist *pls)
+{
+    return NULL;
+}
+#endif
+
 static int64_t default_reload_interval(struct playlist *pls)
 {
     return pls->n_segments > 0 ?
@@ -1015,7 +1349,7 @@ restart:
     if (!v->needed)
         return AVERROR_EOF;
 
-    if (!v->input) {
+    if (!v->input && !v->cur_prefetch) {
         int64_t reload_interval;
 
         /* Check that the playlist is still needed before opening a new
@@ -1032,6 +1366,7 @@ restart:
         if (!v->needed) {
             av_log(v->parent, AV_LOG_INFO, "No longer receiving playlist %d\n",
                 v->index);
+            cancel_prefetch(v);
             return AVERROR_EOF;
         }
 
@@ -1070,12 +1405,18 @@ reload:
             goto reload;
         }
 
-        ret = open_input(c, v);
-        if (ret < 0) {
-            av_log(v->parent, AV_LOG_WARNING, "Failed to open segment of playlist %d\n",
-                   v->index);
-            return ret;
+        v->cur_prefetch = take_prefetched_segment(v);
+        if (v->cur_prefetch) {
+            v->cur_seg_offset = 0;
+        } else {
+            ret = open_input(c, v);
+            if (ret < 0) {
+                av_log(v->parent, AV_LOG_WARNING, "Failed to open segment of playlist %d\n",
+                       v->index);
+                return ret;
+            }
         }
+        prefetch_segments(c, v);
         just_opened = 1;
     }
 
@@ -1089,8 +1430,7 @@ reload:
 
         return ret;
     }
-    ffurl_close(v->input);
-    v->input = NULL;
+    close_segment(v);
     v->cur_seq_no++;
 
     c->cur_seq_no = v->cur_seq_no;
@@ -1267,6 +1607,9 @@ static int hls_read_header(AVFormatContext *s)
         av_opt_get(u->priv_data, "headers", 0, (uint8_t**)&(c->headers));
         if (c->headers && !strlen(c->headers))
             av_freep(&c->headers);
+
+        av_freep(&c->reuse_connections);
+        av_opt_get(u->priv_data, "reuse_connections", 0, (uint8_t**)&(c->reuse_connections));
     }
 
     if ((ret = parse_playlist(c, s->filename, NULL, s->pb)) < 0)
@@ -1462,9 +1805,8 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
             }
             av_log(s, AV_LOG_INFO, "Now receiving playlist %d, segment %d\n", i, pls->cur_seq_no);
         } else if (first && !pls->cur_needed && pls->needed) {
-            if (pls->input)
-                ffurl_close(pls->input);
-            pls->input = NULL;
+            close_segment(pls);
+            cancel_prefetch(pls);
             pls->needed = 0;
             changed = 1;
             av_log(s, AV_LOG_INFO, "No longer receiving playlist %d\n", i);
@@ -1665,10 +2007,8 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
     for (i = 0; i < c->n_playlists; i++) {
         /* Reset reading */
         struct playlist *pls = c->playlists[i];
-        if (pls->input) {
-            ffurl_close(pls->input);
-            pls->input = NULL;
-        }
+        close_segment(pls);
+        cancel_prefetch(pls);
         av_free_packet(&pls->pkt);
         reset_packet(&pls->pkt);
         pls->pb.eof_reached = 0;
@@ -1711,9 +2051,27 @@ static int hls_probe(AVProbeData *p)
     return 0;
 }
 
+#define OFFSET(x) offsetof(HLSContext, x)
+#define FLAGS AV_OPT_FLAG_DECODING_PARAM
+static const AVOption hls_options[] = {
+    { "prefetch_segments", "number of segments to download in advance per playlist",
+      OFFSET(prefetch_segments), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, MAX_PREFETCH_SEGMENTS, FLAGS },
+    { "prefetch_buffer_size", "maximum number of bytes of a segment to download in advance",
+      OFFSET(prefetch_buffer_size), AV_OPT_TYPE_INT, { .i64 = 4 * 1024 * 1024 }, PREFETCH_CHUNK_SIZE, INT_MAX, FLAGS },
+    { NULL },
+};
+
+static const AVClass hls_class = {
+    .class_name = "hls,applehttp",
+    .item_name  = av_default_item_name,
+    .option     = hls_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 AVInputFormat ff_hls_demuxer = {
     .name           = "hls,applehttp",
     .long_name      = NULL_IF_CONFIG_SMALL("Apple HTTP Live Streaming"),
+    .priv_class     = &hls_class,
     .priv_data_size = sizeof(HLSContext),
     .read_probe     = hls_probe,
     .read_header    = hls_read_header,
@@ -57,9 +57,25 @@ typedef struct HLSContext {
     ListEntry *end_list;
     char *basename;
     char *baseurl;
+    int reuse_connections;
     AVIOContext *pb;
 } HLSContext;
 
+static int hls_open_output(AVFormatContext *s, AVIOContext **pb,
+                           const char *filename)
+{
+    HLSContext *hls = s->priv_data;
+    AVDictionary *opts = NULL;
+    int ret;
+
+    /* upload the playlist and the segments over the same HTTP connection */
+    if (hls->reuse_connections)
+        av_dict_set(&opts, "reuse_connections", "1", 0);
+    ret = avio_open2(pb, filename, AVIO_FLAG_WRITE, &s->interrupt_callback, &opts);
+    av_dict_free(&opts);
+    return ret;
+}
+
 static int hls_mux_init(AVFormatContext *s)
 {
     HLSContext *hls = s->priv_data;
@@ -135,8 +151,7 @@ static int hls_window(AVFormatContext *s, int last)
     int ret = 0;
     int64_t sequence = FFMAX(hls->start_sequence, hls->sequence - hls->nb_entries);
 
-    if ((ret = avio_open2(&hls->pb, s->filename, AVIO_FLAG_WRITE,
-                          &s->interrupt_callback, NULL)) < 0)
+    if ((ret = hls_open_output(s, &hls->pb, s->filename)) < 0)
         goto fail;
 
     for (en = hls->list; en; en = en->next) {
@@ -180,8 +195,7 @@ static int hls_start(AVFormatContext *s)
     }
     c->number++;
 
-    if ((err = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
-                          &s->interrupt_callback, NULL)) < 0)
+    if ((err = hls_open_output(s, &oc->pb, oc->filename)) < 0)
         return err;
 
     if (oc->oformat->priv_class && oc->priv_data)
@@ -332,6 +346,7 @@ static const AVOption options[] = {
     {"hls_list_size", "set maximum number of playlist entries",  OFFSET(size),    AV_OPT_TYPE_INT,    {.i64 = 5},     0, INT_MAX, E},
     {"hls_wrap",      "set number after which the index wraps",  OFFSET(wrap),    AV_OPT_TYPE_INT,    {.i64 = 0},     0, INT_MAX, E},
     {"hls_base_url",  "url to prepend to each playlist entry",   OFFSET(baseurl), AV_OPT_TYPE_STRING, {.str = NULL},  0, 0,       E},
+    {"reuse_connections", "keep HTTP connections open for the next playlist and segment uploads", OFFSET(reuse_connections), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E},
     { NULL },
 };
 
@@ -26,6 +26,7 @@
  */
 
 #include "libavutil/avstring.h"
+#include "libavutil/opt.h"
 #include "libavutil/time.h"
 #include "avformat.h"
 #include "internal.h"
@@ -55,6 +56,7 @@ struct variant {
 };
 
 typedef struct HLSContext {
+    const AVClass *class;
     char playlisturl[MAX_URL_SIZE];
     int64_t target_duration;
     int start_seq_no;
@@ -66,8 +68,33 @@ typedef struct HLSContext {
     int cur_seq_no;
     URLContext *seg_hd;
     int64_t last_load_time;
+    int reuse_connections;
 } HLSContext;
 
+#define OFFSET(x) offsetof(HLSContext, x)
+#define D AV_OPT_FLAG_DECODING_PARAM
+static const AVOption options[] = {
+    { "reuse_connections", "keep HTTP connections open for the next playlist and segment requests (-1 = when reading only)", OFFSET(reuse_connections), AV_OPT_TYPE_INT, { .i64 = 0 }, -1, 1, D },
+    { NULL }
+};
+
+static const AVClass hls_class = {
+    .class_name     = "hls",
+    .item_name      = av_default_item_name,
+    .option         = options,
+    .version        = LIBAVUTIL_VERSION_INT,
+};
+
+/* options passed to the protocol opening each playlist and segment */
+static void set_nested_options(HLSContext *s, AVDictionary **opts)
+{
+    if (s->reuse_connections) {
+        char buf[8];
+        snprintf(buf, sizeof(buf), "%d", s->reuse_connections);
+        av_dict_set(opts, "reuse_connections", buf, 0);
+    }
+}
+
 static int read_chomp_line(AVIOContext *s, char *buf, int maxlen)
 {
     int len = ff_get_line(s, buf, maxlen);
@@ -111,13 +138,16 @@ static int parse_playlist(URLContext *h, const char *url)
 {
     HLSContext *s = h->priv_data;
     AVIOContext *in;
+    AVDictionary *opts = NULL;
     int ret = 0, is_segment = 0, is_variant = 0, bandwidth = 0;
     int64_t duration = 0;
     char line[1024];
     const char *ptr;
 
-    if ((ret = avio_open2(&in, url, AVIO_FLAG_READ,
-                          &h->interrupt_callback, NULL)) < 0)
+    set_nested_options(s, &opts);
+    ret = avio_open2(&in, url, AVIO_FLAG_READ, &h->interrupt_callback, &opts);
+    av_dict_free(&opts);
+    if (ret < 0)
         return ret;
 
     read_chomp_line(in, line, sizeof(line));
@@ -253,6 +283,7 @@ fail:
 static int hls_read(URLContext *h, uint8_t *buf, int size)
 {
     HLSContext *s = h->priv_data;
+    AVDictionary *opts = NULL;
     const char *url;
     int ret;
     int64_t reload_interval;
@@ -301,8 +332,10 @@ retry:
     }
     url = s->segments[s->cur_seq_no - s->start_seq_no]->url,
     av_log(h, AV_LOG_DEBUG, "opening %s\n", url);
+    set_nested_options(s, &opts);
     ret = ffurl_open(&s->seg_hd, url, AVIO_FLAG_READ,
-                     &h->interrupt_callback, NULL);
+                     &h->interrupt_callback, &opts);
+    av_dict_free(&opts);
     if (ret < 0) {
         if (ff_check_interrupt(&h->interrupt_callback))
             return AVERROR_EXIT;
@@ -314,10 +347,11 @@ retry:
 }
 
 URLProtocol ff_hls_protocol = {
-    .name           = "hls",
-    .url_open       = hls_open,
-    .url_read       = hls_read,
-    .url_close      = hls_close,
-    .flags          = URL_PROTOCOL_FLAG_NESTED_SCHEME,
-    .priv_data_size = sizeof(HLSContext),
+    .name            = "hls",
+    .url_open        = hls_open,
+    .url_read        = hls_read,
+    .url_close       = hls_close,
+    .flags           = URL_PROTOCOL_FLAG_NESTED_SCHEME,
+    .priv_data_size  = sizeof(HLSContext),
+    .priv_data_class = &hls_class,
 };
@@ -25,8 +25,13 @@
 #include <zlib.h>
 #endif /* CONFIG_ZLIB */
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
+#include "libavutil/time.h"
 
 #include "avformat.h"
 #include "http.h"
@@ -44,6 +49,7 @@
  * path names). */
 #define BUFFER_SIZE   MAX_URL_SIZE
 #define MAX_REDIRECTS 8
+#define MAX_IDLE_CONNECTIONS 32
 
 typedef struct {
     const AVClass *class;
@@ -54,6 +60,9 @@ typedef struct {
     /* Used if "Transfer-Encoding: chunked" otherwise -1. */
     int64_t chunksize;
     int64_t off, end_off, filesize;
+    /* Content-Length of the current response, -1 if unknown, and the
+     * offset its body starts at. */
+    int64_t content_length, body_start;
     char *location;
     HTTPAuthState auth_state;
     HTTPAuthState proxy_auth_state;
@@ -72,6 +81,14 @@ typedef struct {
     int end_header;
     /* A flag which indicates if we use persistent connections. */
     int multiple_requests;
+    /* Return the connection to the process-wide pool once the response
+     * has been read completely; -1 = only for reading. */
+    int reuse_connections;
+    int max_idle_per_host;
+    int idle_timeout;
+    /* URL and options of the lower level protocol the connection was opened
+     * with, empty if the connection must not be pooled. */
+    char pool_key[2048];
     uint8_t *post_data;
     int post_datalen;
     int is_akamai;
@@ -107,6 +124,9 @@ static const AVOption options[] = {
     { "user_agent", "override User-Agent header", OFFSET(user_agent), AV_OPT_TYPE_STRING, { .str = DEFAULT_USER_AGENT }, 0, 0, D },
     { "user-agent", "override User-Agent header", OFFSET(user_agent), AV_OPT_TYPE_STRING, { .str = DEFAULT_USER_AGENT }, 0, 0, D },
     { "multiple_requests", "use persistent connections", OFFSET(multiple_requests), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, D | E },
+    { "reuse_connections", "keep connections open for later requests to the same server (-1 = when reading only)", OFFSET(reuse_connections), AV_OPT_TYPE_INT, { .i64 = 0 }, -1, 1, D | E },
+    { "max_idle_per_host", "maximum number of idle connections kept per server", OFFSET(max_idle_per_host), AV_OPT_TYPE_INT, { .i64 = 4 }, 0, MAX_IDLE_CONNECTIONS, D | E },
+    { "idle_timeout", "close connections that have been idle for longer than this (in seconds)", OFFSET(idle_timeout), AV_OPT_TYPE_INT, { .i64 = 30 }, 0, INT_MAX, D | E },
     { "post_data", "set custom HTTP post data", OFFSET(post_data), AV_OPT_TYPE_BINARY, .flags = D | E },
     { "mime_type", "export the MIME type", OFFSET(mime_type), AV_OPT_TYPE_STRING, { 0 }, 0, 0, AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
     { "cookies", "set cookies to be sent in applicable future requests, use newline delimited Set-Cookie HTTP field value syntax", OFFSET(cookies), AV_OPT_TYPE_STRING, { 0 }, 0, 0, D },
@@ -128,6 +148,180 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
                         const char *hoststr, const char *auth,
                         const char *proxyauth, int *new_location);
 
+#if HAVE_PTHREADS
+/* Idle keep-alive connections shared by all http contexts of the process,
+ * oldest first. They are keyed by the URL of the lower level protocol,
+ * i.e. by scheme, host and port, and the options it was opened with. */
+typedef struct HTTPPoolEntry {
+    char key[2048];
+    URLContext *hd;
+    int64_t expires;
+} HTTPPoolEntry;
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static HTTPPoolEntry pool[MAX_IDLE_CONNECTIONS];
+static int pool_size;
+
+static void pool_remove(int i)
+{
+    pool_size--;
+    memmove(&pool[i], &pool[i + 1], (pool_size - i) * sizeof(*pool));
+}
+
+/* Move the connections idle for longer than their idle_timeout to expired,
+ * to be closed once pool_mutex is released. Must be called with pool_mutex
+ * held. */
+static int pool_expire(URLContext **expired)
+{
+    int64_t now = av_gettime();
+    int i, nb_expired = 0;
+
+    for (i = pool_size - 1; i >= 0; i--) {
+        if (now >= pool[i].expires) {
+            expired[nb_expired++] = pool[i].hd;
+            pool_remove(i);
+        }
+    }
+    return nb_expired;
+}
+#endif
+
+/**
+ * Build the pool key of a connection to the lower level protocol URL
+ * opened with options. Since the options include the TLS verification,
+ * certificate and timeout settings, a connection is only reused by requests
+ * that would have opened it the same way.
+ *
+ * @return 0 if the key does not fit, in which case the connection is not
+ *         pooled
+ */
+static int http_pool_make_key(char *key, int size, const char *url,
+                              AVDictionary *options)
+{
+    AVDictionaryEntry *e = NULL;
+
+    if (av_strlcpy(key, url, size) >= size)
+        goto fail;
+    while ((e = av_dict_get(options, "", e, AV_DICT_IGNORE_SUFFIX)))
+        if (av_strlcatf(key, size, "\n%s=%s", e->key, e->value) >= size)
+            goto fail;
+    return 1;
+fail:
+    key[0] = '\0';
+    return 0;
+}
+
+static int http_pool_enabled(URLContext *h)
+{
+#if HAVE_PTHREADS
+    HTTPContext *s = h->priv_data;
+
+    if (s->multiple_requests || !s->max_idle_per_host)
+        return 0;
+    if (s->reuse_connections == -1)
+        return !(h->flags & AVIO_FLAG_WRITE) && !s->post_data;
+    return s->reuse_connections;
+#else
+    return 0;
+#endif
+}
+
+/* Take the most recently used idle connection to key out of the pool,
+ * closing the ones that have expired on the way. */
+static URLContext *http_pool_get(URLContext *h, const char *key)
+{
+    URLContext *hd = NULL;
+#if HAVE_PTHREADS
+    URLContext *expired[MAX_IDLE_CONNECTIONS];
+    int i, nb_expired;
+    int enabled = http_pool_enabled(h) && key[0];
+
+    /* expired connections are closed on any request, even one which does
+     * not use the pool itself */
+    pthread_mutex_lock(&pool_mutex);
+    nb_expired = pool_expire(expired);
+    for (i = pool_size - 1; enabled && i >= 0; i--) {
+        if (!strcmp(pool[i].key, key)) {
+            hd = pool[i].hd;
+            pool_remove(i);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    for (i = 0; i < nb_expired; i++)
+        ffurl_close(expired[i]);
+
+    if (hd) {
+        int fd = ffurl_get_file_handle(hd);
+        struct pollfd p = { fd, POLLIN, 0 };
+
+        /* There is nothing to read on a healthy idle connection; if there
+         * is, the server has closed it or is talking garbage. */
+        if (fd >= 0 && poll(&p, 1, 0) != 0) {
+            ffurl_close(hd);
+            return http_pool_get(h, key);
+        }
+        hd->interrupt_callback = h->interrupt_callback;
+        av_log(h, AV_LOG_DEBUG, "Reusing connection to %.*s\n",
+               (int)strcspn(key, "\n"), key);
+    }
+#endif
+    return hd;
+}
+
+/* Move the connection of a completed request to the pool. */
+static void http_pool_put(URLContext *h)
+{
+#if HAVE_PTHREADS
+    HTTPContext *s = h->priv_data;
+    URLContext *expired[MAX_IDLE_CONNECTIONS], *evict = NULL;
+    int i, nb_expired, nb_host = 0, oldest = -1;
+
+    if (!s->pool_key[0] || !s->idle_timeout)
+        return;
+
+    memset(&s->hd->interrupt_callback, 0, sizeof(s->hd->interrupt_callback));
+
+    pthread_mutex_lock(&pool_mutex);
+    nb_expired = pool_expire(expired);
+    for (i = 0; i < pool_size; i++) {
+        if (!strcmp(pool[i].key, s->pool_key)) {
+            if (oldest < 0)
+                oldest = i;
+            nb_host++;
+        }
+    }
+    if (nb_host < s->max_idle_per_host)
+        oldest = pool_size == MAX_IDLE_CONNECTIONS ? 0 : -1;
+    if (oldest >= 0) {
+        evict = pool[oldest].hd;
+        pool_remove(oldest);
+    }
+    av_strlcpy(pool[pool_size].key, s->pool_key, sizeof(pool[pool_size].key));
+    pool[pool_size].hd      = s->hd;
+    pool[pool_size].expires = av_gettime() + s->idle_timeout * 1000000LL;
+    pool_size++;
+    pthread_mutex_unlock(&pool_mutex);
+
+    for (i = 0; i < nb_expired; i++)
+        ffurl_close(expired[i]);
+    if (evict)
+        ffurl_close(evict);
+    s->hd = NULL;
+#endif
+}
+
+/* whether the whole response has been read and the connection may be
+ * used for another request */
+static int http_response_complete(HTTPContext *s)
+{
+    return s->end_header && !s->willclose && s->chunksize < 0 &&
+           s->content_length >= 0 &&
+           s->off - s->body_start == s->content_length &&
+           s->buf_ptr == s->buf_end;
+}
+
 void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
 {
     memcpy(&((HTTPContext *)dest->priv_data)->auth_state,
@@ -147,6 +341,7 @@ static int http_open_cnx(URLContext *h, AVDictionary **options)
     char path1[MAX_URL_SIZE];
     char buf[1024], urlbuf[MAX_URL_SIZE];
     int port, use_proxy, err, location_changed = 0, redirects = 0, attempts = 0;
+    int pooled, pool_failed = 0;
     HTTPAuthType cur_auth_type, cur_proxy_auth_type;
     HTTPContext *s = h->priv_data;
 
@@ -188,18 +383,31 @@ redo:
 
     ff_url_join(buf, sizeof(buf), lower_proto, NULL, hostname, port, NULL);
 
+    pooled = 0;
     if (!s->hd) {
-        err = ffurl_open(&s->hd, buf, AVIO_FLAG_READ_WRITE,
-                         &h->interrupt_callback, options);
-        if (err < 0)
+        /* the key has to be built before ffurl_open() consumes the options */
+        http_pool_make_key(s->pool_key, sizeof(s->pool_key), buf,
+                           options ? *options : NULL);
+        if (!pool_failed && (s->hd = http_pool_get(h, s->pool_key)))
+            pooled = 1;
+        else if ((err = ffurl_open(&s->hd, buf, AVIO_FLAG_READ_WRITE,
+                                   &h->interrupt_callback, options)) < 0)
             goto fail;
     }
 
     cur_auth_type       = s->auth_state.auth_type;
     cur_proxy_auth_type = s->auth_state.auth_type;
     if (http_connect(h, path, local_path, hoststr,
-                     auth, proxyauth, &location_changed) < 0)
+                     auth, proxyauth, &location_changed) < 0) {
+        if (pooled) {
+            /* the server may have dropped the idle connection meanwhile,
+             * retry once on a new one */
+            ffurl_closep(&s->hd);
+            pool_failed = 1;
+            goto redo;
+        }
         goto fail;
+    }
     attempts++;
     if (s->http_code == 401) {
         if ((cur_auth_type == HTTP_AUTH_NONE || s->auth_state.stale) &&
@@ -468,8 +676,10 @@ static int process_line(URLContext *h, char *line, int line_count,
             if ((ret = parse_location(s, p)) < 0)
                 return ret;
             *new_location = 1;
-        } else if (!av_strcasecmp(tag, "Content-Length") && s->filesize == -1) {
-            s->filesize = strtoll(p, NULL, 10);
+        } else if (!av_strcasecmp(tag, "Content-Length")) {
+            s->content_length = strtoll(p, NULL, 10);
+            if (s->filesize == -1)
+                s->filesize = s->content_length;
         } else if (!av_strcasecmp(tag, "Content-Range")) {
             parse_content_range(h, p);
         } else if (!av_strcasecmp(tag, "Accept-Ranges") &&
@@ -658,6 +868,8 @@ static int http_read_header(URLContext *h, int *new_location)
     if (s->seekable == -1 && s->is_mediagateway && s->filesize == 2000000000)
         h->is_streamed = 1; /* we can in fact _not_ seek */
 
+    s->body_start = s->off;
+
     return err;
 }
 
@@ -729,7 +941,7 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
                            "Expect: 100-continue\r\n");
 
     if (!has_header(s->headers, "\r\nConnection: ")) {
-        if (s->multiple_requests)
+        if (s->multiple_requests || http_pool_enabled(h))
             len += av_strlcpy(headers + len, "Connection: keep-alive\r\n",
                               sizeof(headers) - len);
         else
@@ -793,6 +1005,7 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
     s->off              = 0;
     s->icy_data_read    = 0;
     s->filesize         = -1;
+    s->content_length   = -1;
     s->willclose        = 0;
     s->end_chunked_post = 0;
     s->end_header       = 0;
@@ -831,6 +1044,10 @@ static int http_buf_read(URLContext *h, uint8_t *buf, int size)
     } else {
         if (!s->willclose && s->filesize >= 0 && s->off >= s->filesize)
             return AVERROR_EOF;
+        /* a persistent connection stays open after the response */
+        if (!s->willclose && s->chunksize < 0 && s->content_length >= 0 &&
+            s->off - s->body_start >= s->content_length)
+            return AVERROR_EOF;
         len = ffurl_read(s->hd, buf, size);
     }
     if (len > 0) {
@@ -1037,6 +1254,15 @@ static int http_close(URLContext *h)
         /* Close the write direction by sending the end of chunked encoding. */
         ret = http_shutdown(h, h->flags);
 
+    if (s->hd && http_pool_enabled(h)) {
+        int new_location;
+        /* the reply to a chunked post has not been read yet */
+        if (s->end_chunked_post && !s->end_header)
+            http_read_header(h, &new_location);
+        if (http_response_complete(s))
+            http_pool_put(h);
+    }
+
     if (s->hd)
         ffurl_closep(&s->hd);
     av_dict_free(&s->chained_options);
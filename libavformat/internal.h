@@ -163,6 +163,14 @@ void ff_put_v(AVIOContext *bc, uint64_t val);
  */
 int ff_get_line(AVIOContext *s, char *buf, int maxlen);
 
+/**
+ * Same as av_get_packet(), but make the packet reference the data of the
+ * protocol instead of copying it when possible (see ffio_read_ref()).
+ * The packet data must then not be written to, so only use it where the
+ * packet is passed on unmodified.
+ */
+int ff_get_packet_ref(AVIOContext *s, AVPacket *pkt, int size);
+
 #define SPACE_CHARS " \t\r\n"
 
 /**
@@ -26,6 +26,7 @@
 
 #include "avio.h"
 #include "internal.h"
+#include "compactindex.h"
 #include "dv.h"
 
 /* isom.c */
@@ -88,6 +89,20 @@ typedef struct MOVTrackExt {
     unsigned flags;
 } MOVTrackExt;
 
+typedef struct MOVFragmentIndexItem {
+    int64_t moof_offset;
+    int64_t time;         ///< track time at the start of the fragment, in track timescale
+} MOVFragmentIndexItem;
+
+typedef struct MOVFragmentIndex {
+    unsigned track_id;
+    unsigned item_count;
+    unsigned items_allocated;
+    MOVFragmentIndexItem *items;  ///< sorted by moof_offset unless unsorted is set
+    int unsorted;         ///< items were appended out of order or duplicated
+    int64_t end_time;     ///< end of the last indexed fragment if known, else AV_NOPTS_VALUE
+} MOVFragmentIndex;
+
 typedef struct MOVSbgp {
     unsigned int count;
     unsigned int index;
@@ -148,6 +163,8 @@ typedef struct MOVStreamContext {
     int64_t duration_for_fps;
 
     int32_t *display_matrix;
+
+    FFCompactIndex *cindex; ///< sample index used instead of AVStream.index_entries if set
 } MOVStreamContext;
 
 typedef struct MOVContext {
@@ -171,8 +188,20 @@ typedef struct MOVContext {
     int *bitrates;          ///< bitrates read before streams creation
     int bitrates_count;
     int moov_retry;
+    MOVFragmentIndex **fragment_index_data;
+    unsigned fragment_index_count;
+    int has_looked_for_mfra;
+    int frag_index_mode;    ///< one of MOV_FRAG_INDEX_*
+    int frag_lazy;          ///< fragments are read on demand instead of when opening
+    int64_t frag_parsed_start; ///< offset of the first fragment whose samples are indexed
+    int64_t frag_parsed_end;   ///< offset of the last 'moof' whose samples are indexed
+    int compact_index;
 } MOVContext;
 
+#define MOV_FRAG_INDEX_NONE 0 ///< read all fragments when opening the file
+#define MOV_FRAG_INDEX_AUTO 1 ///< read fragments on demand if sidx/mfra index every track
+#define MOV_FRAG_INDEX_SCAN 2 ///< read fragments on demand, scanning for the seek target if needed
+
 int ff_mp4_read_descr_len(AVIOContext *pb);
 int ff_mp4_read_descr(AVFormatContext *fc, AVIOContext *pb, int *tag);
 int ff_mp4_read_dec_config_descr(AVFormatContext *fc, AVStream *st, AVIOContext *pb);
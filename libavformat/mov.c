@@ -776,10 +776,213 @@ static int mov_read_moov(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     return 0; /* now go for mdat */
 }
 
+static MOVFragmentIndex *mov_get_fragment_index(MOVContext *c, unsigned track_id,
+                                                int create)
+{
+    MOVFragmentIndex *index;
+    int i;
+
+    for (i = 0; i < c->fragment_index_count; i++)
+        if (c->fragment_index_data[i]->track_id == track_id)
+            return c->fragment_index_data[i];
+    if (!create)
+        return NULL;
+
+    if (av_reallocp_array(&c->fragment_index_data, c->fragment_index_count + 1,
+                          sizeof(*c->fragment_index_data)) < 0) {
+        c->fragment_index_count = 0;
+        return NULL;
+    }
+    index = av_mallocz(sizeof(*index));
+    if (!index)
+        return NULL;
+    index->track_id = track_id;
+    index->end_time = AV_NOPTS_VALUE;
+    c->fragment_index_data[c->fragment_index_count++] = index;
+    return index;
+}
+
+static int mov_add_fragment_index_item(MOVContext *c, unsigned track_id,
+                                       int64_t moof_offset, int64_t time)
+{
+    MOVFragmentIndex *index = mov_get_fragment_index(c, track_id, 1);
+    MOVFragmentIndexItem *items;
+
+    if (!index)
+        return AVERROR(ENOMEM);
+
+    /* items are appended and only sorted when the index is used, as inserting
+     * them in order is quadratic for an unordered mfra or rereading fragments */
+    if (index->item_count) {
+        int64_t last = index->items[index->item_count - 1].moof_offset;
+        if (last == moof_offset)
+            return 0;
+        if (last > moof_offset)
+            index->unsorted = 1;
+    }
+
+    if (index->item_count >= UINT_MAX / sizeof(*items) - 1)
+        return AVERROR_INVALIDDATA;
+    items = av_fast_realloc(index->items, &index->items_allocated,
+                            (index->item_count + 1) * sizeof(*items));
+    if (!items)
+        return AVERROR(ENOMEM);
+    index->items = items;
+
+    items[index->item_count].moof_offset = moof_offset;
+    items[index->item_count].time        = time;
+    index->item_count++;
+    return 0;
+}
+
+static int fragment_index_item_cmp(const void *a, const void *b)
+{
+    const MOVFragmentIndexItem *ia = a, *ib = b;
+    if (ia->moof_offset != ib->moof_offset)
+        return ia->moof_offset > ib->moof_offset ? 1 : -1;
+    return (ia->time > ib->time) - (ia->time < ib->time);
+}
+
+/* sort the items of all fragment indexes by moof_offset and drop duplicates */
+static void mov_sort_fragment_index(MOVContext *c)
+{
+    int i;
+
+    for (i = 0; i < c->fragment_index_count; i++) {
+        MOVFragmentIndex *index = c->fragment_index_data[i];
+        unsigned j, n = 0;
+
+        if (!index->unsorted)
+            continue;
+        qsort(index->items, index->item_count, sizeof(*index->items),
+              fragment_index_item_cmp);
+        for (j = 0; j < index->item_count; j++)
+            if (!n || index->items[n - 1].moof_offset != index->items[j].moof_offset)
+                index->items[n++] = index->items[j];
+        index->item_count = n;
+        index->unsorted   = 0;
+    }
+}
+
+static int mov_read_tfra(MOVContext *c, AVIOContext *pb)
+{
+    int64_t pos = avio_tell(pb);
+    uint32_t size = avio_rb32(pb);
+    unsigned track_id, item_count, i, j;
+    int version, fieldlength, ret;
+
+    if (avio_rb32(pb) != MKBETAG('t','f','r','a'))
+        return 1;
+    /* size, tag, version and flags, track_ID, field lengths, entry count */
+    if (size < 24)
+        return AVERROR_INVALIDDATA;
+
+    version     = avio_r8(pb);
+    avio_rb24(pb); /* flags */
+    track_id    = avio_rb32(pb);
+    fieldlength = avio_rb32(pb);
+    item_count  = avio_rb32(pb);
+    for (i = 0; i < item_count && !pb->eof_reached; i++) {
+        int64_t time, offset;
+        time   = version == 1 ? avio_rb64(pb) : avio_rb32(pb);
+        offset = version == 1 ? avio_rb64(pb) : avio_rb32(pb);
+        /* traf, trun and sample numbers */
+        for (j = 0; j < ((fieldlength >> 4) & 3) + 1; j++)
+            avio_r8(pb);
+        for (j = 0; j < ((fieldlength >> 2) & 3) + 1; j++)
+            avio_r8(pb);
+        for (j = 0; j < ((fieldlength >> 0) & 3) + 1; j++)
+            avio_r8(pb);
+        if ((ret = mov_add_fragment_index_item(c, track_id, offset, time)) < 0)
+            return ret;
+    }
+
+    avio_seek(pb, pos + size, SEEK_SET);
+    return 0;
+}
+
+/* read the random access index at the end of the file, if there is one */
+static int mov_read_mfra(MOVContext *c, AVIOContext *pb)
+{
+    int64_t stream_size  = avio_size(pb);
+    int64_t original_pos = avio_tell(pb);
+    int64_t seek_ret;
+    int32_t mfra_size;
+    int ret = -1;
+
+    if ((seek_ret = avio_seek(pb, stream_size - 4, SEEK_SET)) < 0) {
+        ret = seek_ret;
+        goto fail;
+    }
+    mfra_size = avio_rb32(pb);
+    if (mfra_size < 0 || mfra_size > stream_size) {
+        av_log(c->fc, AV_LOG_DEBUG, "doesn't look like mfra (unreasonable size)\n");
+        goto fail;
+    }
+    if ((seek_ret = avio_seek(pb, -mfra_size, SEEK_CUR)) < 0) {
+        ret = seek_ret;
+        goto fail;
+    }
+    if (avio_rb32(pb) != mfra_size) {
+        av_log(c->fc, AV_LOG_DEBUG, "doesn't look like mfra (size mismatch)\n");
+        goto fail;
+    }
+    if (avio_rb32(pb) != MKBETAG('m','f','r','a')) {
+        av_log(c->fc, AV_LOG_DEBUG, "doesn't look like mfra (tag mismatch)\n");
+        goto fail;
+    }
+    av_log(c->fc, AV_LOG_VERBOSE, "stream has mfra\n");
+    while (!(ret = mov_read_tfra(c, pb))) {
+        /* Empty */
+    }
+    if (ret > 0)
+        ret = 0;
+fail:
+    seek_ret = avio_seek(pb, original_pos, SEEK_SET);
+    if (seek_ret < 0) {
+        av_log(c->fc, AV_LOG_ERROR, "failed to seek back after looking for mfra\n");
+        ret = seek_ret;
+    }
+    return ret;
+}
+
+/* whether fragments are read on demand rather than all when opening */
+static int mov_fragments_lazy(MOVContext *c, AVIOContext *pb)
+{
+    int i;
+
+    if (!pb->seekable || c->fc->flags & AVFMT_FLAG_IGNIDX ||
+        c->frag_index_mode == MOV_FRAG_INDEX_NONE)
+        return 0;
+    mov_sort_fragment_index(c);
+    for (i = 0; i < c->fc->nb_streams; i++) {
+        AVStream *st = c->fc->streams[i];
+        MOVStreamContext *sc = st->priv_data;
+        MOVFragmentIndex *index = mov_get_fragment_index(c, st->id, 0);
+        /* samples from the moov atom would be lost when jumping to a fragment */
+        if (sc->sample_count)
+            return 0;
+        /* without an index entry, the start time of the track in a fragment
+         * is only known exactly if the fragment has a tfdt atom */
+        if (c->frag_index_mode == MOV_FRAG_INDEX_AUTO &&
+            (!index || !index->item_count))
+            return 0;
+    }
+    return 1;
+}
+
 static int mov_read_moof(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 {
     c->fragment.moof_offset = c->fragment.implicit_offset = avio_tell(pb) - 8;
     av_dlog(c->fc, "moof offset %"PRIx64"\n", c->fragment.moof_offset);
+    if (!c->has_looked_for_mfra) {
+        c->has_looked_for_mfra = 1;
+        if (pb->seekable && c->frag_index_mode != MOV_FRAG_INDEX_NONE)
+            mov_read_mfra(c, pb);
+        c->frag_lazy = mov_fragments_lazy(c, pb);
+        c->frag_parsed_start = c->fragment.moof_offset;
+    }
+    c->frag_parsed_end = FFMAX(c->frag_parsed_end, c->fragment.moof_offset);
     return mov_read_default(c, pb, atom);
 }
 
@@ -2099,6 +2302,36 @@ static int mov_read_sbgp(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     return pb->eof_reached ? AVERROR_EOF : 0;
 }
 
+/* Sample index access, through the compact index if the stream has one. */
+static int mov_nb_samples(AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    return sc->cindex ? sc->cindex->nb_entries : st->nb_index_entries;
+}
+
+static AVIndexEntry *mov_get_sample(AVStream *st, int n)
+{
+    MOVStreamContext *sc = st->priv_data;
+    return sc->cindex ? ff_compact_index_get(sc->cindex, n) : &st->index_entries[n];
+}
+
+static int mov_search_sample(AVStream *st, int64_t timestamp, int flags)
+{
+    MOVStreamContext *sc = st->priv_data;
+    if (sc->cindex)
+        return ff_compact_index_search_timestamp(sc->cindex, timestamp, flags);
+    return av_index_search_timestamp(st, timestamp, flags);
+}
+
+static int mov_add_sample(AVStream *st, int64_t pos, int64_t timestamp,
+                          int size, int distance, int flags)
+{
+    MOVStreamContext *sc = st->priv_data;
+    if (sc->cindex)
+        return ff_compact_index_add(sc->cindex, pos, timestamp, size, distance, flags);
+    return av_add_index_entry(st, pos, timestamp, size, distance, flags);
+}
+
 static void mov_build_index(MOVContext *mov, AVStream *st)
 {
     MOVStreamContext *sc = st->priv_data;
@@ -2140,17 +2373,19 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
 
         current_dts -= sc->dts_shift;
 
-        if (!sc->sample_count || st->nb_index_entries)
-            return;
-        if (sc->sample_count >= UINT_MAX / sizeof(*st->index_entries) - st->nb_index_entries)
-            return;
-        if (av_reallocp_array(&st->index_entries,
-                              st->nb_index_entries + sc->sample_count,
-                              sizeof(*st->index_entries)) < 0) {
-            st->nb_index_entries = 0;
+        if (!sc->sample_count || mov_nb_samples(st))
             return;
+        if (!sc->cindex) {
+            if (sc->sample_count >= UINT_MAX / sizeof(*st->index_entries) - st->nb_index_entries)
+                return;
+            if (av_reallocp_array(&st->index_entries,
+                                  st->nb_index_entries + sc->sample_count,
+                                  sizeof(*st->index_entries)) < 0) {
+                st->nb_index_entries = 0;
+                return;
+            }
+            st->index_entries_allocated_size = (st->nb_index_entries + sc->sample_count) * sizeof(*st->index_entries);
         }
-        st->index_entries_allocated_size = (st->nb_index_entries + sc->sample_count) * sizeof(*st->index_entries);
 
         for (i = 0; i < sc->chunk_count; i++) {
             int64_t next_offset = i+1 < sc->chunk_count ? sc->chunk_offsets[i+1] : INT64_MAX;
@@ -2203,16 +2438,22 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
                 sample_size = sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[current_sample];
                 if (sc->pseudo_stream_id == -1 ||
                    sc->stsc_data[stsc_index].id - 1 == sc->pseudo_stream_id) {
-                    AVIndexEntry *e = &st->index_entries[st->nb_index_entries++];
-                    e->pos = current_offset;
-                    e->timestamp = current_dts;
-                    e->size = sample_size;
-                    e->min_distance = distance;
-                    e->flags = keyframe ? AVINDEX_KEYFRAME : 0;
+                    if (sc->cindex) {
+                        if (ff_compact_index_add(sc->cindex, current_offset, current_dts, sample_size,
+                                                 distance, keyframe ? AVINDEX_KEYFRAME : 0) < 0)
+                            return;
+                    } else {
+                        AVIndexEntry *e = &st->index_entries[st->nb_index_entries++];
+                        e->pos = current_offset;
+                        e->timestamp = current_dts;
+                        e->size = sample_size;
+                        e->min_distance = distance;
+                        e->flags = keyframe ? AVINDEX_KEYFRAME : 0;
+                    }
                     av_dlog(mov->fc, "AVIndex stream %d, sample %d, offset %"PRIx64", dts %"PRId64", "
                             "size %d, distance %d, keyframe %d\n", st->index, current_sample,
                             current_offset, current_dts, sample_size, distance, keyframe);
-                    if (st->codec->codec_type == AVMEDIA_TYPE_VIDEO && st->nb_index_entries < 100)
+                    if (st->codec->codec_type == AVMEDIA_TYPE_VIDEO && mov_nb_samples(st) < 100)
                         ff_rfps_add_frame(mov->fc, st, current_dts);
                 }
 
@@ -2261,15 +2502,17 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
         }
 
         av_dlog(mov->fc, "chunk count %d\n", total);
-        if (total >= UINT_MAX / sizeof(*st->index_entries) - st->nb_index_entries)
-            return;
-        if (av_reallocp_array(&st->index_entries,
-                              st->nb_index_entries + total,
-                              sizeof(*st->index_entries)) < 0) {
-            st->nb_index_entries = 0;
-            return;
+        if (!sc->cindex) {
+            if (total >= UINT_MAX / sizeof(*st->index_entries) - st->nb_index_entries)
+                return;
+            if (av_reallocp_array(&st->index_entries,
+                                  st->nb_index_entries + total,
+                                  sizeof(*st->index_entries)) < 0) {
+                st->nb_index_entries = 0;
+                return;
+            }
+            st->index_entries_allocated_size = (st->nb_index_entries + total) * sizeof(*st->index_entries);
         }
-        st->index_entries_allocated_size = (st->nb_index_entries + total) * sizeof(*st->index_entries);
 
         // populate index
         for (i = 0; i < sc->chunk_count; i++) {
@@ -2280,7 +2523,6 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
             chunk_samples = sc->stsc_data[stsc_index].count;
 
             while (chunk_samples > 0) {
-                AVIndexEntry *e;
                 unsigned size, samples;
 
                 if (sc->samples_per_frame >= 160) { // gsm
@@ -2297,16 +2539,22 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
                     }
                 }
 
-                if (st->nb_index_entries >= total) {
+                if (mov_nb_samples(st) >= total) {
                     av_log(mov->fc, AV_LOG_ERROR, "wrong chunk count %d\n", total);
                     return;
                 }
-                e = &st->index_entries[st->nb_index_entries++];
-                e->pos = current_offset;
-                e->timestamp = current_dts;
-                e->size = size;
-                e->min_distance = 0;
-                e->flags = AVINDEX_KEYFRAME;
+                if (sc->cindex) {
+                    if (ff_compact_index_add(sc->cindex, current_offset, current_dts,
+                                             size, 0, AVINDEX_KEYFRAME) < 0)
+                        return;
+                } else {
+                    AVIndexEntry *e = &st->index_entries[st->nb_index_entries++];
+                    e->pos = current_offset;
+                    e->timestamp = current_dts;
+                    e->size = size;
+                    e->min_distance = 0;
+                    e->flags = AVINDEX_KEYFRAME;
+                }
                 av_dlog(mov->fc, "AVIndex stream %d, chunk %d, offset %"PRIx64", dts %"PRId64", "
                         "size %d, duration %d\n", st->index, i, current_offset, current_dts,
                         size, samples);
@@ -2409,7 +2657,12 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 
     avpriv_set_pts_info(st, 64, 1, sc->time_scale);
 
+    if (c->compact_index && !(sc->cindex = av_mallocz(sizeof(*sc->cindex))))
+        return AVERROR(ENOMEM);
     mov_build_index(c, st);
+    if (sc->cindex)
+        av_log(c->fc, AV_LOG_DEBUG, "stream %d: %d index entries in %"SIZE_SPECIFIER" bytes\n",
+               st->index, sc->cindex->nb_entries, ff_compact_index_size(sc->cindex));
 
     if (sc->dref_id-1 < sc->drefs_count && sc->drefs[sc->dref_id-1].path) {
         MOVDref *dref = &sc->drefs[sc->dref_id - 1];
@@ -2743,6 +2996,81 @@ static int mov_read_tfhd(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     return 0;
 }
 
+static int mov_read_tfdt(MOVContext *c, AVIOContext *pb, MOVAtom atom)
+{
+    MOVStreamContext *sc;
+    int64_t base_media_decode_time;
+    int version, i;
+
+    version = avio_r8(pb);
+    avio_rb24(pb); /* flags */
+    base_media_decode_time = version ? avio_rb64(pb) : avio_rb32(pb);
+
+    /* When reading fragments in order the track time is the sum of the
+     * sample durations, which is only unknown after a jump. Only trust the
+     * stored time in that mode to keep the timestamps of other files as
+     * they are. */
+    if (!c->frag_lazy)
+        return 0;
+    for (i = 0; i < c->fc->nb_streams; i++) {
+        if (c->fc->streams[i]->id == c->fragment.track_id) {
+            sc = c->fc->streams[i]->priv_data;
+            sc->track_end = base_media_decode_time;
+            break;
+        }
+    }
+    return 0;
+}
+
+static int mov_read_sidx(MOVContext *c, AVIOContext *pb, MOVAtom atom)
+{
+    int64_t offset = avio_tell(pb) + atom.size, pts;
+    MOVFragmentIndex *index;
+    MOVStreamContext *sc = NULL;
+    unsigned track_id, timescale, item_count, i;
+    int version, ret;
+
+    version  = avio_r8(pb);
+    avio_rb24(pb); /* flags */
+    track_id = avio_rb32(pb);
+    for (i = 0; i < c->fc->nb_streams; i++) {
+        if (c->fc->streams[i]->id == track_id) {
+            sc = c->fc->streams[i]->priv_data;
+            break;
+        }
+    }
+    timescale = avio_rb32(pb);
+    if (!sc || !timescale || !sc->time_scale)
+        return 0;
+
+    pts     = version ? avio_rb64(pb) : avio_rb32(pb);
+    offset += version ? avio_rb64(pb) : avio_rb32(pb);
+    avio_rb16(pb); /* reserved */
+    item_count = avio_rb16(pb);
+
+    for (i = 0; i < item_count && !pb->eof_reached; i++) {
+        uint32_t size     = avio_rb32(pb);
+        uint32_t duration = avio_rb32(pb);
+        avio_rb32(pb); /* SAP */
+        /* references to further sidx atoms are not followed */
+        if (!(size & 0x80000000)) {
+            ret = mov_add_fragment_index_item(c, track_id, offset,
+                                              av_rescale(pts, sc->time_scale, timescale));
+            if (ret < 0)
+                return ret;
+        }
+        offset += size & 0x7fffffff;
+        pts    += duration;
+    }
+
+    if ((index = mov_get_fragment_index(c, track_id, 0))) {
+        pts = av_rescale(pts, sc->time_scale, timescale);
+        if (index->end_time == AV_NOPTS_VALUE || index->end_time < pts)
+            index->end_time = pts;
+    }
+    return 0;
+}
+
 static int mov_read_chap(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 {
     c->chapter_track = avio_rb32(pb);
@@ -2828,6 +3156,11 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         sc->ctts_count = 0;
         return err;
     }
+    /* remember where the fragments read so far are, to get back to them */
+    if (c->frag_lazy &&
+        (err = mov_add_fragment_index_item(c, frag->track_id, frag->moof_offset,
+                                           sc->track_end)) < 0)
+        return err;
     if (flags & MOV_TRUN_DATA_OFFSET)        data_offset        = avio_rb32(pb);
     if (flags & MOV_TRUN_FIRST_SAMPLE_FLAGS) first_sample_flags = avio_rb32(pb);
     dts    = sc->track_end - sc->time_offset;
@@ -2856,8 +3189,8 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
                                   MOV_FRAG_SAMPLE_FLAG_DEPENDS_YES));
         if (keyframe)
             distance = 0;
-        av_add_index_entry(st, offset, dts, sample_size, distance,
-                           keyframe ? AVINDEX_KEYFRAME : 0);
+        mov_add_sample(st, offset, dts, sample_size, distance,
+                       keyframe ? AVINDEX_KEYFRAME : 0);
         av_dlog(c->fc, "AVIndex stream %d, sample %d, offset %"PRIx64", dts %"PRId64", "
                 "size %d, distance %d, keyframe %d\n", st->index, sc->sample_count+i,
                 offset, dts, sample_size, distance, keyframe);
@@ -2873,7 +3206,10 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         return AVERROR_EOF;
 
     frag->implicit_offset = offset;
-    st->duration = sc->track_end = dts + sc->time_offset;
+    sc->track_end = dts + sc->time_offset;
+    /* fragments may be read out of order after a seek */
+    if (!c->frag_lazy || st->duration < sc->track_end)
+        st->duration = sc->track_end;
     return 0;
 }
 
@@ -3138,6 +3474,8 @@ static const MOVParseTableEntry mov_default_parse_table[] = {
 { MKTAG('c','h','a','n'), mov_read_chan }, /* channel layout */
 { MKTAG('d','v','c','1'), mov_read_dvc1 },
 { MKTAG('s','b','g','p'), mov_read_sbgp },
+{ MKTAG('s','i','d','x'), mov_read_sidx },
+{ MKTAG('t','f','d','t'), mov_read_tfdt },
 { MKTAG('h','v','c','C'), mov_read_glbl },
 { MKTAG('u','u','i','d'), mov_read_uuid },
 { MKTAG('C','i','n', 0x8e), mov_read_targa_y216 },
@@ -3219,9 +3557,9 @@ static int mov_read_default(MOVContext *c, AVIOContext *pb, MOVAtom atom)
             if (err < 0)
                 return err;
             if (c->found_moov && c->found_mdat &&
-                ((!pb->seekable || c->fc->flags & AVFMT_FLAG_IGNIDX) ||
+                ((!pb->seekable || c->fc->flags & AVFMT_FLAG_IGNIDX || c->frag_lazy) ||
                  start_pos + a.size == avio_size(pb))) {
-                if (!pb->seekable || c->fc->flags & AVFMT_FLAG_IGNIDX)
+                if (!pb->seekable || c->fc->flags & AVFMT_FLAG_IGNIDX || c->frag_lazy)
                     c->next_root_atom = start_pos + a.size;
                 return 0;
             }
@@ -3349,26 +3687,26 @@ static void mov_read_chapters(AVFormatContext *s)
     sc = st->priv_data;
     cur_pos = avio_tell(sc->pb);
 
-    for (i = 0; i < st->nb_index_entries; i++) {
-        AVIndexEntry *sample = &st->index_entries[i];
-        int64_t end = i+1 < st->nb_index_entries ? st->index_entries[i+1].timestamp : st->duration;
+    for (i = 0; i < mov_nb_samples(st); i++) {
+        AVIndexEntry sample = *mov_get_sample(st, i);
+        int64_t end = i+1 < mov_nb_samples(st) ? mov_get_sample(st, i+1)->timestamp : st->duration;
         uint8_t *title;
         uint16_t ch;
         int len, title_len;
 
-        if (end < sample->timestamp) {
+        if (end < sample.timestamp) {
             av_log(s, AV_LOG_WARNING, "ignoring stream duration which is shorter than chapters\n");
             end = AV_NOPTS_VALUE;
         }
 
-        if (avio_seek(sc->pb, sample->pos, SEEK_SET) != sample->pos) {
+        if (avio_seek(sc->pb, sample.pos, SEEK_SET) != sample.pos) {
             av_log(s, AV_LOG_ERROR, "Chapter %d not found in file\n", i);
             goto finish;
         }
 
         // the first two bytes are the length of the title
         len = avio_rb16(sc->pb);
-        if (len > sample->size-2)
+        if (len > sample.size-2)
             continue;
         title_len = 2*len + 1;
         if (!(title = av_mallocz(title_len)))
@@ -3394,7 +3732,7 @@ static void mov_read_chapters(AVFormatContext *s)
             }
         }
 
-        avpriv_new_chapter(s, i, st->time_base, sample->timestamp, end, title);
+        avpriv_new_chapter(s, i, st->time_base, sample.timestamp, end, title);
         av_freep(&title);
     }
 finish:
@@ -3423,10 +3761,10 @@ static int mov_read_timecode_track(AVFormatContext *s, AVStream *st)
     int64_t cur_pos = avio_tell(sc->pb);
     uint32_t value;
 
-    if (!st->nb_index_entries)
+    if (!mov_nb_samples(st))
         return -1;
 
-    avio_seek(sc->pb, st->index_entries->pos, SEEK_SET);
+    avio_seek(sc->pb, mov_get_sample(st, 0)->pos, SEEK_SET);
     value = avio_rb32(s->pb);
 
     if (sc->tmcd_flags & 0x0001) flags |= AV_TIMECODE_FLAG_DROPFRAME;
@@ -3454,6 +3792,9 @@ static int mov_read_close(AVFormatContext *s)
         MOVStreamContext *sc = st->priv_data;
 
         av_freep(&sc->ctts_data);
+        if (sc->cindex)
+            ff_compact_index_free(sc->cindex);
+        av_freep(&sc->cindex);
         for (j = 0; j < sc->drefs_count; j++) {
             av_freep(&sc->drefs[j].path);
             av_freep(&sc->drefs[j].dir);
@@ -3484,6 +3825,13 @@ static int mov_read_close(AVFormatContext *s)
     av_freep(&mov->trex_data);
     av_freep(&mov->bitrates);
 
+    for (i = 0; i < mov->fragment_index_count; i++) {
+        av_freep(&mov->fragment_index_data[i]->items);
+        av_freep(&mov->fragment_index_data[i]);
+    }
+    av_freep(&mov->fragment_index_data);
+    mov->fragment_index_count = 0;
+
     return 0;
 }
 
@@ -3613,6 +3961,24 @@ static int mov_read_header(AVFormatContext *s)
         }
     }
 
+    /* only the first fragment has been read, take the duration from the index;
+     * without a sidx, the start of the last fragment is the best estimate */
+    if (mov->frag_lazy) {
+        mov_sort_fragment_index(mov);
+        for (i = 0; i < s->nb_streams; i++) {
+            AVStream *st = s->streams[i];
+            MOVStreamContext *sc = st->priv_data;
+            MOVFragmentIndex *index = mov_get_fragment_index(mov, st->id, 0);
+            int64_t end_time = sc->track_end;
+
+            if (index && index->end_time != AV_NOPTS_VALUE)
+                end_time = FFMAX(end_time, index->end_time);
+            else if (index && index->item_count)
+                end_time = FFMAX(end_time, index->items[index->item_count - 1].time);
+            st->duration = end_time - sc->time_offset;
+        }
+    }
+
     for (i = 0; i < mov->bitrates_count && i < s->nb_streams; i++) {
         if (mov->bitrates[i]) {
             s->streams[i]->codec->bit_rate = mov->bitrates[i];
@@ -3666,8 +4032,8 @@ static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *avst = s->streams[i];
         MOVStreamContext *msc = avst->priv_data;
-        if (msc->pb && msc->current_sample < avst->nb_index_entries) {
-            AVIndexEntry *current_sample = &avst->index_entries[msc->current_sample];
+        if (msc->pb && msc->current_sample < mov_nb_samples(avst)) {
+            AVIndexEntry *current_sample = mov_get_sample(avst, msc->current_sample);
             int64_t dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
             av_dlog(s, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
             if (!sample || (!s->pb->seekable && current_sample->pos < sample->pos) ||
@@ -3684,29 +4050,43 @@ static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
     return sample;
 }
 
+static int mov_read_next_fragment(AVFormatContext *s)
+{
+    MOVContext *mov = s->priv_data;
+
+    mov->found_mdat = 0;
+    if (!mov->next_root_atom)
+        return AVERROR_EOF;
+    avio_seek(s->pb, mov->next_root_atom, SEEK_SET);
+    mov->next_root_atom = 0;
+    if (mov_read_default(mov, s->pb, (MOVAtom){ AV_RL32("root"), INT64_MAX }) < 0 ||
+        url_feof(s->pb))
+        return AVERROR_EOF;
+    av_dlog(s, "read fragments, offset 0x%"PRIx64"\n", avio_tell(s->pb));
+    return 0;
+}
+
 static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MOVContext *mov = s->priv_data;
     MOVStreamContext *sc;
-    AVIndexEntry *sample;
+    AVIndexEntry *sample, compact_sample;
     AVStream *st = NULL;
     int ret;
     mov->fc = s;
  retry:
     sample = mov_find_next_sample(s, &st);
     if (!sample) {
-        mov->found_mdat = 0;
-        if (!mov->next_root_atom)
-            return AVERROR_EOF;
-        avio_seek(s->pb, mov->next_root_atom, SEEK_SET);
-        mov->next_root_atom = 0;
-        if (mov_read_default(mov, s->pb, (MOVAtom){ AV_RL32("root"), INT64_MAX }) < 0 ||
-            url_feof(s->pb))
-            return AVERROR_EOF;
-        av_dlog(s, "read fragments, offset 0x%"PRIx64"\n", avio_tell(s->pb));
+        if ((ret = mov_read_next_fragment(s)) < 0)
+            return ret;
         goto retry;
     }
     sc = st->priv_data;
+    /* entries of a compact index only live until its next access */
+    if (sc->cindex) {
+        compact_sample = *sample;
+        sample = &compact_sample;
+    }
     /* must be done just before reading, to avoid infinite loop on sample */
     sc->current_sample++;
 
@@ -3721,7 +4101,10 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
                    sc->ffindex, sample->pos);
             return AVERROR_INVALIDDATA;
         }
-        ret = av_get_packet(sc->pb, pkt, sample->size);
+        if (mov->dv_demux && sc->dv_audio_container)
+            ret = av_get_packet(sc->pb, pkt, sample->size);
+        else
+            ret = ff_get_packet_ref(sc->pb, pkt, sample->size);
         if (ret < 0)
             return ret;
         if (sc->has_palette) {
@@ -3761,8 +4144,8 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         if (sc->wrong_dts)
             pkt->dts = AV_NOPTS_VALUE;
     } else {
-        int64_t next_dts = (sc->current_sample < st->nb_index_entries) ?
-            st->index_entries[sc->current_sample].timestamp : st->duration;
+        int64_t next_dts = (sc->current_sample < mov_nb_samples(st)) ?
+            mov_get_sample(st, sc->current_sample)->timestamp : st->duration;
         pkt->duration = next_dts - pkt->dts;
         pkt->pts = pkt->dts;
     }
@@ -3781,9 +4164,9 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
     int sample, time_sample;
     int i;
 
-    sample = av_index_search_timestamp(st, timestamp, flags);
+    sample = mov_search_sample(st, timestamp, flags);
     av_dlog(s, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
-    if (sample < 0 && st->nb_index_entries && timestamp < st->index_entries[0].timestamp)
+    if (sample < 0 && mov_nb_samples(st) && timestamp < mov_get_sample(st, 0)->timestamp)
         sample = 0;
     if (sample < 0) /* not sure what to do */
         return AVERROR_INVALIDDATA;
@@ -3805,6 +4188,131 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
     return sample;
 }
 
+/**
+ * Drop the samples of all fragments read so far and continue reading at the
+ * moof atom at offset, which starts at time (in time base tb) for the track
+ * it was found for.
+ */
+static int mov_switch_fragment(AVFormatContext *s, int64_t offset,
+                               int64_t time, AVRational tb)
+{
+    MOVContext *mov = s->priv_data;
+    int i, j, ret;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        MOVStreamContext *sc = st->priv_data;
+        MOVFragmentIndex *index = mov_get_fragment_index(mov, st->id, 0);
+
+        st->nb_index_entries = 0;
+        if (sc->cindex)
+            ff_compact_index_reset(sc->cindex);
+        sc->current_sample   = 0;
+        sc->ctts_count       = 0;
+        sc->ctts_index       = 0;
+        sc->ctts_sample      = 0;
+        sc->track_end        = av_rescale_q(time, tb, st->time_base);
+        /* the first fragment of the track at or after offset */
+        for (j = 0; index && j < index->item_count; j++) {
+            if (index->items[j].moof_offset >= offset) {
+                sc->track_end = index->items[j].time;
+                break;
+            }
+        }
+    }
+
+    av_dlog(s, "switch to fragment at 0x%"PRIx64"\n", offset);
+    mov->frag_parsed_start = mov->frag_parsed_end = offset;
+    mov->found_mdat     = 0;
+    mov->next_root_atom = 0;
+    if (avio_seek(s->pb, offset, SEEK_SET) != offset)
+        return AVERROR_INVALIDDATA;
+    ret = mov_read_default(mov, s->pb, (MOVAtom){ AV_RL32("root"), INT64_MAX });
+    return ret < 0 ? ret : 0;
+}
+
+/* read fragments until st has samples up to timestamp or the file ends */
+static void mov_read_fragments_until(AVFormatContext *s, AVStream *st,
+                                     int64_t timestamp)
+{
+    MOVContext *mov = s->priv_data;
+
+    if (!mov->frag_lazy)
+        return;
+    while (!mov_nb_samples(st) ||
+           mov_get_sample(st, mov_nb_samples(st) - 1)->timestamp < timestamp)
+        if (mov_read_next_fragment(s) < 0)
+            break;
+}
+
+/* index of the last fragment of the track starting at or before ts */
+static int mov_find_fragment_index_item(MOVFragmentIndex *index,
+                                        MOVStreamContext *sc, int64_t ts)
+{
+    int i, item = 0;
+
+    for (i = 1; i < index->item_count; i++) {
+        if (index->items[i].time - sc->time_offset > ts)
+            break;
+        item = i;
+    }
+    return item;
+}
+
+/**
+ * Make sure the fragment containing timestamp has been read, using the
+ * fragment index to jump to it instead of reading all fragments before it.
+ * Tracks may be stored in separate fragments, and the other tracks are
+ * aligned to the keyframe found in st, so the jump goes to the first
+ * fragment any indexed track needs at the start of the fragment of st.
+ */
+static int mov_seek_fragment(AVFormatContext *s, AVStream *st, int64_t timestamp)
+{
+    MOVContext *mov = s->priv_data;
+    MOVStreamContext *sc = st->priv_data;
+    MOVFragmentIndex *index;
+    AVRational tb = { 0, 1 };
+    int64_t offset = INT64_MAX, time = 0, start = timestamp;
+    int i, item, ret;
+
+    if (!mov->frag_lazy)
+        return 0;
+
+    mov_sort_fragment_index(mov);
+    index = mov_get_fragment_index(mov, st->id, 0);
+    if (index && index->item_count) {
+        item  = mov_find_fragment_index_item(index, sc, timestamp);
+        start = FFMIN(start, index->items[item].time - sc->time_offset);
+    }
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *ist = s->streams[i];
+        MOVStreamContext *isc = ist->priv_data;
+
+        index = mov_get_fragment_index(mov, ist->id, 0);
+        if (!index || !index->item_count)
+            continue;
+        item = mov_find_fragment_index_item(index, isc,
+                   av_rescale_q(start, st->time_base, ist->time_base));
+        if (index->items[item].moof_offset < offset) {
+            offset = index->items[item].moof_offset;
+            time   = index->items[item].time;
+            tb     = ist->time_base;
+        }
+    }
+    if (offset == INT64_MAX)
+        return 0;
+
+    if (offset < mov->frag_parsed_start || offset > mov->frag_parsed_end) {
+        ret = mov_switch_fragment(s, offset, time, tb);
+        if (ret < 0)
+            return ret;
+    }
+
+    mov_read_fragments_until(s, st, timestamp);
+    return 0;
+}
+
 static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_time, int flags)
 {
     AVStream *st;
@@ -3816,12 +4324,14 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
         return AVERROR_INVALIDDATA;
 
     st = s->streams[stream_index];
+    if ((sample = mov_seek_fragment(s, st, sample_time)) < 0)
+        return sample;
     sample = mov_seek_stream(s, st, sample_time, flags);
     if (sample < 0)
         return sample;
 
     /* adjust seek timestamp to found sample timestamp */
-    seek_timestamp = st->index_entries[sample].timestamp;
+    seek_timestamp = mov_get_sample(st, sample)->timestamp;
 
     for (i = 0; i < s->nb_streams; i++) {
         MOVStreamContext *sc = s->streams[i]->priv_data;
@@ -3832,6 +4342,7 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
             continue;
 
         timestamp = av_rescale_q(seek_timestamp, s->streams[stream_index]->time_base, st->time_base);
+        mov_read_fragments_until(s, st, timestamp);
         mov_seek_stream(s, st, timestamp, flags);
     }
     return 0;
@@ -3844,6 +4355,18 @@ static const AVOption options[] = {
         0, 1, AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_DECODING_PARAM},
     {"ignore_editlist", "", offsetof(MOVContext, ignore_editlist), FF_OPT_TYPE_INT, {.i64 = 0},
         0, 1, AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_DECODING_PARAM},
+    {"compact_index", "keep the sample index in a compact form instead of AVStream.index_entries",
+        offsetof(MOVContext, compact_index), FF_OPT_TYPE_INT, {.i64 = 0},
+        0, 1, AV_OPT_FLAG_DECODING_PARAM},
+    {"frag_index", "use the sidx/mfra index of fragmented files to seek",
+        offsetof(MOVContext, frag_index_mode), FF_OPT_TYPE_INT, {.i64 = MOV_FRAG_INDEX_NONE},
+        MOV_FRAG_INDEX_NONE, MOV_FRAG_INDEX_SCAN, AV_OPT_FLAG_DECODING_PARAM, "frag_index"},
+    {"none", "read all fragments when opening the file", 0, FF_OPT_TYPE_CONST,
+        {.i64 = MOV_FRAG_INDEX_NONE}, 0, 0, AV_OPT_FLAG_DECODING_PARAM, "frag_index"},
+    {"auto", "read fragments on demand if the file has an index", 0, FF_OPT_TYPE_CONST,
+        {.i64 = MOV_FRAG_INDEX_AUTO}, 0, 0, AV_OPT_FLAG_DECODING_PARAM, "frag_index"},
+    {"scan", "always read fragments on demand, indexing them as they are read", 0, FF_OPT_TYPE_CONST,
+        {.i64 = MOV_FRAG_INDEX_SCAN}, 0, 0, AV_OPT_FLAG_DECODING_PARAM, "frag_index"},
     {NULL}
 };
 
@@ -71,6 +71,8 @@ static const AVOption options[] = {
     { "use_editlist", "use edit list", offsetof(MOVMuxContext, use_editlist), AV_OPT_TYPE_INT, {.i64 = -1}, -1, 1, AV_OPT_FLAG_ENCODING_PARAM},
     { "video_track_timescale", "set timescale of all video tracks", offsetof(MOVMuxContext, video_track_timescale), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM},
     { "brand",    "Override major brand", offsetof(MOVMuxContext, major_brand),   AV_OPT_TYPE_STRING, {.str = NULL}, .flags = AV_OPT_FLAG_ENCODING_PARAM },
+    { "faststart_duration", "Expected duration, used with faststart to reserve space for the moov atom", offsetof(MOVMuxContext, faststart_duration), AV_OPT_TYPE_DURATION, {.i64 = 0}, 0, 7 * 24 * 3600 * (int64_t)AV_TIME_BASE, AV_OPT_FLAG_ENCODING_PARAM},
+    { "faststart_samples", "Expected number of samples, used with faststart to reserve space for the moov atom", offsetof(MOVMuxContext, faststart_samples), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM},
     { NULL },
 };
 
@@ -3886,6 +3888,67 @@ static int mov_create_dvd_sub_decoder_specific_info(MOVTrack *track,
     return 0;
 }
 
+/*
+ * Estimate the size of the moov atom of the finished file from the expected
+ * duration or number of samples, erring on the large side: the reserved
+ * space is wasted, but running out of it means falling back to shifting
+ * the whole file at the end.
+ */
+static int estimate_moov_size(AVFormatContext *s)
+{
+    MOVMuxContext *mov = s->priv_data;
+    int64_t size = 4096;
+    int i;
+
+    for (i = 0; i < mov->nb_streams; i++) {
+        MOVTrack *track = &mov->tracks[i];
+        AVCodecContext *enc = track->enc;
+        AVStream *st = i < s->nb_streams ? s->streams[i] : NULL;
+        AVRational rate = { 1, 1 };
+        int64_t samples;
+        int sample_size;
+
+        /* stsz, co64 and an stsc entry for every few samples, plus ctts
+         * and stss entries for video */
+        switch (enc->codec_type) {
+        case AVMEDIA_TYPE_VIDEO:
+            if (st && st->avg_frame_rate.num && st->avg_frame_rate.den)
+                rate = st->avg_frame_rate;
+            else if (enc->time_base.num && enc->time_base.den)
+                rate = av_inv_q(enc->time_base);
+            sample_size = 4 + 12 + 12;
+            break;
+        case AVMEDIA_TYPE_AUDIO:
+            rate = (AVRational){ enc->sample_rate, enc->frame_size > 0 ? enc->frame_size : 1024 };
+            sample_size = 4 + 12;
+            break;
+        default:
+            sample_size = 4 + 12 + 8;
+            break;
+        }
+
+        if (mov->faststart_samples > 0)
+            samples = mov->faststart_samples;
+        else
+            samples = av_rescale(mov->faststart_duration, rate.num,
+                                 (int64_t)rate.den * AV_TIME_BASE);
+        size += 1024 + enc->extradata_size;
+        samples = av_clip64(samples, 0, FFMAX(INT_MAX - size, 0) / sample_size);
+        size += samples * sample_size;
+    }
+    /* leave some room for misestimated frame rates */
+    size += size / 8;
+
+    if (size > MOV_MAX_RESERVED_MOOV_SIZE) {
+        av_log(s, AV_LOG_ERROR, "The moov atom for faststart_duration/"
+               "faststart_samples would need about %"PRId64" bytes, more "
+               "than the %d bytes that can be reserved for it\n",
+               size, MOV_MAX_RESERVED_MOOV_SIZE);
+        return AVERROR(EINVAL);
+    }
+    return size;
+}
+
 static int mov_write_header(AVFormatContext *s)
 {
     AVIOContext *pb = s->pb;
@@ -3930,7 +3993,7 @@ static int mov_write_header(AVFormatContext *s)
             av_log(s, AV_LOG_WARNING, "The faststart flag is incompatible "
                    "with fragmentation and custom IO, disabling faststart\n");
             mov->flags &= ~FF_MOV_FLAG_FASTSTART;
-        } else
+        } else if (!mov->reserved_moov_size)
             mov->reserved_moov_size = -1;
     }
 
@@ -4150,11 +4213,21 @@ static int mov_write_header(AVFormatContext *s)
 
     enable_tracks(s);
 
+    if (mov->reserved_moov_size < 0 &&
+        (mov->faststart_duration > 0 || mov->faststart_samples > 0)) {
+        if ((ret = estimate_moov_size(s)) < 0)
+            return ret;
+        mov->reserved_moov_size = ret;
+    }
 
     if (mov->reserved_moov_size){
         mov->reserved_moov_pos= avio_tell(pb);
-        if (mov->reserved_moov_size > 0)
-            avio_skip(pb, mov->reserved_moov_size);
+        if (mov->reserved_moov_size > 0) {
+            /* keep the file parsable until the moov atom is written there */
+            avio_wb32(pb, mov->reserved_moov_size);
+            ffio_wfourcc(pb, "free");
+            ffio_fill(pb, 0, mov->reserved_moov_size - 8);
+        }
     }
 
     if (mov->flags & FF_MOV_FLAG_FRAGMENT) {
@@ -4164,7 +4237,7 @@ static int mov_write_header(AVFormatContext *s)
             !mov->max_fragment_duration && !mov->max_fragment_size)
             mov->flags |= FF_MOV_FLAG_FRAG_KEYFRAME;
     } else {
-        if (mov->flags & FF_MOV_FLAG_FASTSTART)
+        if (mov->reserved_moov_size < 0)
             mov->reserved_moov_pos = avio_tell(pb);
         mov_write_mdat_tag(pb, mov);
     }
@@ -4379,7 +4452,30 @@ static int mov_write_trailer(AVFormatContext *s)
             ffio_wfourcc(pb, "mdat");
             avio_wb64(pb, mov->mdat_size + 16);
         }
-        avio_seek(pb, mov->reserved_moov_size > 0 ? mov->reserved_moov_pos : moov_pos, SEEK_SET);
+
+        /* the moov atom fits into the space reserved for it, or exactly
+         * fills it, unless more samples than expected were written */
+        if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->reserved_moov_size > 0) {
+            int moov_size = get_moov_size(s);
+            if (moov_size < 0) {
+                res = moov_size;
+                goto error;
+            }
+            if (moov_size == mov->reserved_moov_size ||
+                moov_size + 8 <= mov->reserved_moov_size) {
+                av_log(s, AV_LOG_VERBOSE, "Writing the moov atom into the "
+                       "reserved space (%d of %d bytes used)\n",
+                       moov_size, mov->reserved_moov_size);
+                mov->flags &= ~FF_MOV_FLAG_FASTSTART;
+            } else {
+                av_log(s, AV_LOG_WARNING, "The moov atom (%d bytes) does not "
+                       "fit into the %d bytes reserved for it\n",
+                       moov_size, mov->reserved_moov_size);
+            }
+        }
+
+        avio_seek(pb, mov->reserved_moov_size > 0 && !(mov->flags & FF_MOV_FLAG_FASTSTART) ?
+                      mov->reserved_moov_pos : moov_pos, SEEK_SET);
 
         if (mov->flags & FF_MOV_FLAG_FASTSTART) {
             av_log(s, AV_LOG_INFO, "Starting second pass: moving the moov atom to the beginning of the file\n");
@@ -4392,13 +4488,15 @@ static int mov_write_trailer(AVFormatContext *s)
             int64_t size;
             mov_write_moov_tag(pb, mov, s);
             size = mov->reserved_moov_size - (avio_tell(pb) - mov->reserved_moov_pos);
-            if (size < 8){
+            if (size < 8 && size != 0){
                 av_log(s, AV_LOG_ERROR, "reserved_moov_size is too small, needed %"PRId64" additional\n", 8-size);
                 return -1;
             }
-            avio_wb32(pb, size);
-            ffio_wfourcc(pb, "free");
-            ffio_fill(pb, 0, size - 8);
+            if (size) {
+                avio_wb32(pb, size);
+                ffio_wfourcc(pb, "free");
+                ffio_fill(pb, 0, size - 8);
+            }
             avio_seek(pb, moov_pos, SEEK_SET);
         } else {
             mov_write_moov_tag(pb, mov, s);
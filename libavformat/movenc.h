@@ -29,6 +29,7 @@
 #define MOV_FRAG_INFO_ALLOC_INCREMENT 64
 #define MOV_INDEX_CLUSTER_SIZE 1024
 #define MOV_TIMESCALE 1000
+#define MOV_MAX_RESERVED_MOOV_SIZE (256 << 20) ///< upper bound for the faststart_duration/faststart_samples estimate
 
 #define RTP_MAX_PACKET_SIZE 1450
 
@@ -175,6 +176,8 @@ typedef struct MOVMuxContext {
 
     int reserved_moov_size; ///< 0 for disabled, -1 for automatic, size otherwise
     int64_t reserved_moov_pos;
+    int64_t faststart_duration; ///< expected duration in AV_TIME_BASE units, to reserve moov space
+    int64_t faststart_samples;  ///< expected number of samples per track, to reserve moov space
 
     char *major_brand;
 
@@ -78,6 +78,9 @@ typedef struct MpegTSSectionFilter {
     uint8_t *section_buf;
     unsigned int check_crc : 1;
     unsigned int end_of_section_reached : 1;
+    int last_ver;       ///< version of the last section handled, -1 if none
+    unsigned crc;       ///< CRC of the current section
+    unsigned last_crc;  ///< CRC of the last section handled
     SectionCallback *section_cb;
     void *opaque;
 } MpegTSSectionFilter;
@@ -148,9 +151,23 @@ struct MpegTSContext {
     struct Program *prg;
 
     int8_t crc_validity[NB_PID_MAX];
+
+    /** PID_USED / PID_DISCARDED flags of every pid, see discard_pid() */
+    uint8_t discard_map[NB_PID_MAX];
+    /** discard_map must be rebuilt before it is used */
+    int discard_map_dirty;
+    /** true if any pid is discarded according to discard_map */
+    int discard_any;
+    /** AVProgram.discard values discard_map was built for */
+    enum AVDiscard *prg_discard;
+    int nb_prg_discard;
+
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
     int current_pid;
+
+    /** pools of PES packet buffers, indexed by av_log2() of their size */
+    AVBufferPool *pools[32];
 };
 
 static const AVOption mpegtsraw_options[] = {
@@ -265,12 +282,14 @@ static void clear_program(MpegTSContext *ts, unsigned int programid)
             ts->prg[i].nb_pids = 0;
             ts->prg[i].pmt_found = 0;
         }
+    ts->discard_map_dirty = 1;
 }
 
 static void clear_programs(MpegTSContext *ts)
 {
     av_freep(&ts->prg);
     ts->nb_prg = 0;
+    ts->discard_map_dirty = 1;
 }
 
 static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
@@ -285,6 +304,7 @@ static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
     p->nb_pids = 0;
     p->pmt_found = 0;
     ts->nb_prg++;
+    ts->discard_map_dirty = 1;
 }
 
 static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid,
@@ -297,6 +317,7 @@ static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid,
     if (p->nb_pids >= MAX_PIDS_PER_PROGRAM)
         return;
     p->pids[p->nb_pids++] = pid;
+    ts->discard_map_dirty = 1;
 }
 
 static void set_pmt_found(MpegTSContext *ts, unsigned int programid)
@@ -319,46 +340,84 @@ static void set_pcr_pid(AVFormatContext *s, unsigned int programid, unsigned int
     }
 }
 
+#define PID_USED      1
+#define PID_DISCARDED 2
+
 /**
- * @brief discard_pid() decides if the pid is to be discarded according
- *                      to caller's programs selection
- * @param ts    : - TS context
- * @param pid   : - pid
- * @return 1 if the pid is only comprised in programs that have .discard=AVDISCARD_ALL
- *         0 otherwise
+ * Invalidate the discard map if the discard setting of any program
+ * changed since it was built. This is cheap enough to be called once per
+ * batch of packets, but not for every packet.
  */
-static int discard_pid(MpegTSContext *ts, unsigned int pid)
+static void check_program_discard(MpegTSContext *ts)
+{
+    AVFormatContext *s = ts->stream;
+    int i;
+
+    if (ts->nb_prg_discard != s->nb_programs) {
+        if (av_reallocp_array(&ts->prg_discard, s->nb_programs,
+                              sizeof(*ts->prg_discard)) < 0) {
+            ts->nb_prg_discard = 0;
+            return;
+        }
+        ts->nb_prg_discard = s->nb_programs;
+        for (i = 0; i < s->nb_programs; i++)
+            ts->prg_discard[i] = s->programs[i]->discard;
+        ts->discard_map_dirty = 1;
+        return;
+    }
+    for (i = 0; i < s->nb_programs; i++) {
+        if (ts->prg_discard[i] != s->programs[i]->discard) {
+            ts->prg_discard[i] = s->programs[i]->discard;
+            ts->discard_map_dirty = 1;
+        }
+    }
+}
+
+static void update_discard_map(MpegTSContext *ts)
 {
-    int i, j, k;
-    int used = 0, discarded = 0;
+    AVFormatContext *s = ts->stream;
     struct Program *p;
+    int i, j, k, flag;
+
+    ts->discard_map_dirty = 0;
+    memset(ts->discard_map, 0, sizeof(ts->discard_map));
 
     /* If none of the programs have .discard=AVDISCARD_ALL then there's
-     * no way we have to discard this packet */
-    for (k = 0; k < ts->stream->nb_programs; k++)
-        if (ts->stream->programs[k]->discard == AVDISCARD_ALL)
+     * no way we have to discard any packet */
+    for (k = 0; k < s->nb_programs; k++)
+        if (s->programs[k]->discard == AVDISCARD_ALL)
             break;
-    if (k == ts->stream->nb_programs)
-        return 0;
+    ts->discard_any = k < s->nb_programs;
+    if (!ts->discard_any)
+        return;
 
     for (i = 0; i < ts->nb_prg; i++) {
         p = &ts->prg[i];
-        for (j = 0; j < p->nb_pids; j++) {
-            if (p->pids[j] != pid)
+        // is program with id p->id set to be discarded?
+        for (k = 0; k < s->nb_programs; k++) {
+            if (s->programs[k]->id != p->id)
                 continue;
-            // is program with id p->id set to be discarded?
-            for (k = 0; k < ts->stream->nb_programs; k++) {
-                if (ts->stream->programs[k]->id == p->id) {
-                    if (ts->stream->programs[k]->discard == AVDISCARD_ALL)
-                        discarded++;
-                    else
-                        used++;
-                }
-            }
+            flag = s->programs[k]->discard == AVDISCARD_ALL ? PID_DISCARDED
+                                                             : PID_USED;
+            for (j = 0; j < p->nb_pids; j++)
+                ts->discard_map[p->pids[j]] |= flag;
         }
     }
+}
 
-    return !used && discarded;
+/**
+ * @brief discard_pid() decides if the pid is to be discarded according
+ *                      to caller's programs selection
+ * @param ts    : - TS context
+ * @param pid   : - pid
+ * @return 1 if the pid is only comprised in programs that have .discard=AVDISCARD_ALL
+ *         0 otherwise
+ */
+static av_always_inline int discard_pid(MpegTSContext *ts, unsigned int pid)
+{
+    if (ts->discard_map_dirty)
+        update_discard_map(ts);
+    return ts->discard_any && ts->discard_map[pid] == PID_DISCARDED;
 }
 
 /**
@@ -407,6 +466,7 @@ static void write_section_data(MpegTSContext *ts, MpegTSFilter *tss1,
                 ts->crc_validity[ tss1->pid ]--;
             }else
                 crc_valid = 2;
+            tss->crc = AV_RB32(tss->section_buf + tss->section_h_size - 4);
         }
         if (crc_valid)
             tss->section_cb(tss1, tss->section_buf, tss->section_h_size);
@@ -452,6 +512,7 @@ static MpegTSFilter *mpegts_open_section_filter(MpegTSContext *ts,
     sec->opaque      = opaque;
     sec->section_buf = av_malloc(MAX_SECTION_SIZE);
     sec->check_crc   = check_crc;
+    sec->last_ver    = -1;
     if (!sec->section_buf) {
         av_free(filter);
         return NULL;
@@ -510,7 +571,11 @@ static int analyze(const uint8_t *buf, int size, int packet_size, int *index)
     memset(stat, 0, packet_size * sizeof(*stat));
 
     for (i = 0; i < size - 3; i++) {
-        if (buf[i] == 0x47 && !(buf[i + 1] & 0x80) && buf[i + 3] != 0x47) {
+        const uint8_t *sync = memchr(buf + i, 0x47, size - 3 - i);
+        if (!sync)
+            break;
+        i = sync - buf;
+        if (!(buf[i + 1] & 0x80) && buf[i + 3] != 0x47) {
             int x = i % packet_size;
             stat[x]++;
             if (stat[x] > best_score) {
@@ -556,6 +621,20 @@ typedef struct SectionHeader {
     uint8_t last_sec_num;
 } SectionHeader;
 
+/**
+ * Check if a section is a repetition of the last one handled by its
+ * filter, so that the tables it describes need not be rebuilt.
+ */
+static int skip_identical(const SectionHeader *h, MpegTSSectionFilter *tssf)
+{
+    if (h->version == tssf->last_ver && tssf->crc == tssf->last_crc)
+        return 1;
+
+    tssf->last_ver = h->version;
+    tssf->last_crc = tssf->crc;
+    return 0;
+}
+
 static inline int get8(const uint8_t **pp, const uint8_t *p_end)
 {
     const uint8_t *p;
@@ -803,6 +882,28 @@ static void reset_pes_packet_state(PESContext *pes)
     av_buffer_unref(&pes->buffer);
 }
 
+/**
+ * Get a buffer for a PES packet of up to size bytes, plus padding.
+ *
+ * Unbounded video PES packets need a buffer of MAX_PES_PAYLOAD bytes each;
+ * allocating those anew for every packet costs more than filling them, so
+ * buffers are recycled once the packets they were handed out with are
+ * freed.
+ */
+static AVBufferRef *buffer_pool_get(MpegTSContext *ts, int size)
+{
+    int index = av_log2(size + FF_INPUT_BUFFER_PADDING_SIZE);
+
+    if (!ts->pools[index]) {
+        int pool_size = FFMIN(MAX_PES_PAYLOAD + FF_INPUT_BUFFER_PADDING_SIZE,
+                              2 << index);
+        ts->pools[index] = av_buffer_pool_init(pool_size, NULL);
+        if (!ts->pools[index])
+            return NULL;
+    }
+    return av_buffer_pool_get(ts->pools[index]);
+}
+
 static void new_pes_packet(PESContext *pes, AVPacket *pkt)
 {
     av_init_packet(pkt);
@@ -977,8 +1078,7 @@ static int mpegts_push_data(MpegTSFilter *filter,
                         pes->total_size = MAX_PES_PAYLOAD;
 
                     /* allocate pes buffer */
-                    pes->buffer = av_buffer_alloc(pes->total_size +
-                                                  FF_INPUT_BUFFER_PADDING_SIZE);
+                    pes->buffer = buffer_pool_get(ts, pes->total_size);
                     if (!pes->buffer)
                         return AVERROR(ENOMEM);
 
@@ -1128,8 +1228,7 @@ skip:
                     pes->data_index + buf_size > pes->total_size) {
                     new_pes_packet(pes, ts->pkt);
                     pes->total_size = MAX_PES_PAYLOAD;
-                    pes->buffer = av_buffer_alloc(pes->total_size +
-                                                  FF_INPUT_BUFFER_PADDING_SIZE);
+                    pes->buffer = buffer_pool_get(ts, pes->total_size);
                     if (!pes->buffer)
                         return AVERROR(ENOMEM);
                     ts->stop_parse = 1;
@@ -1734,6 +1833,8 @@ static void pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
         return;
     if (ts->skip_changes)
         return;
+    if (skip_identical(h, &filter->u.section_filter))
+        return;
 
     clear_program(ts, h->id);
     pcr_pid = get16(&p, p_end);
@@ -1870,6 +1971,26 @@ out:
         av_free(mp4_descr[i].dec_config_descr);
 }
 
+/* reopen the PMT filters of the programs of the current PAT that were closed
+ * since it was parsed, e.g. because their pid was reused for a stream */
+static void reopen_pmt_filters(MpegTSContext *ts)
+{
+    AVFormatContext *s = ts->stream;
+    int i, j;
+
+    for (i = 0; i < ts->nb_prg; i++) {
+        for (j = 0; j < s->nb_programs; j++) {
+            AVProgram *program = s->programs[j];
+            if (program->id != ts->prg[i].id)
+                continue;
+            if (program->pmt_pid > 0 && program->pmt_pid < NB_PID_MAX &&
+                !ts->pids[program->pmt_pid])
+                mpegts_open_section_filter(ts, program->pmt_pid, pmt_cb, ts, 1);
+            break;
+        }
+    }
+}
+
 static void pat_cb(MpegTSFilter *filter, const uint8_t *section, int section_len)
 {
     MpegTSContext *ts = filter->u.section_filter.opaque;
@@ -1889,6 +2010,10 @@ static void pat_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
         return;
     if (ts->skip_changes)
         return;
+    if (skip_identical(h, &filter->u.section_filter)) {
+        reopen_pmt_filters(ts);
+        return;
+    }
 
     ts->stream->ts_id = h->id;
 
@@ -1919,6 +2044,9 @@ static void pat_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
                     || fil->pid != pmt_pid
                     || fil->u.section_filter.section_cb != pmt_cb)
                     mpegts_close_filter(ts, ts->pids[pmt_pid]);
+            /* the program was cleared, so its pmt must be parsed again */
+            if (fil && ts->pids[pmt_pid])
+                fil->u.section_filter.last_ver = -1;
 
             if (!ts->pids[pmt_pid])
                 mpegts_open_section_filter(ts, pmt_pid, pmt_cb, ts, 1);
@@ -2188,7 +2316,8 @@ static void reanalyze(MpegTSContext *ts) {
 static int mpegts_resync(AVFormatContext *s)
 {
     AVIOContext *pb = s->pb;
-    int c, i;
+    const uint8_t *sync;
+    int c, i, len;
 
     for (i = 0; i < MAX_RESYNC_SIZE; i++) {
         c = avio_r8(pb);
@@ -2199,6 +2328,16 @@ static int mpegts_resync(AVFormatContext *s)
             reanalyze(s->priv_data);
             return 0;
         }
+        /* search the rest of the buffered data at once */
+        len  = FFMIN(pb->buf_end - pb->buf_ptr, MAX_RESYNC_SIZE - i - 1);
+        sync = memchr(pb->buf_ptr, 0x47, len);
+        if (sync) {
+            pb->buf_ptr = (uint8_t *)sync;
+            reanalyze(s->priv_data);
+            return 0;
+        }
+        pb->buf_ptr += len;
+        i           += len;
     }
     av_log(s, AV_LOG_ERROR,
            "max resync size reached, could not find sync byte\n");
@@ -2242,6 +2381,31 @@ static void finished_reading_packet(AVFormatContext *s, int raw_packet_size)
         avio_skip(pb, skip);
 }
 
+/**
+ * Skip the buffered packets that would be dropped by handle_packet()
+ * without looking further than their header: packets of discarded pids
+ * and packets of pids without a filter.
+ *
+ * @return the number of packets skipped, at most max_packets
+ */
+static int skip_unused_packets(MpegTSContext *ts, int max_packets)
+{
+    AVIOContext *pb = ts->stream->pb;
+    const uint8_t *p = pb->buf_ptr;
+    int n = FFMIN((pb->buf_end - p) / TS_PACKET_SIZE, max_packets);
+    int i, pid;
+
+    for (i = 0; i < n; i++, p += TS_PACKET_SIZE) {
+        if (p[0] != 0x47)
+            break;
+        pid = AV_RB16(p + 1) & 0x1fff;
+        if (!pid || !discard_pid(ts, pid) && (ts->pids[pid] || ts->auto_guess))
+            break;
+    }
+    pb->buf_ptr = (uint8_t *)p;
+    return i;
+}
+
 static int handle_packets(MpegTSContext *ts, int nb_packets)
 {
     AVFormatContext *s = ts->stream;
@@ -2267,10 +2431,15 @@ static int handle_packets(MpegTSContext *ts, int nb_packets)
         }
     }
 
+    check_program_discard(ts);
+
     ts->stop_parse = 0;
     packet_num = 0;
     memset(packet + TS_PACKET_SIZE, 0, FF_INPUT_BUFFER_PADDING_SIZE);
     for (;;) {
+        if (ts->raw_packet_size == TS_PACKET_SIZE && !ts->stop_parse)
+            packet_num += skip_unused_packets(ts, nb_packets ? nb_packets - packet_num - 1
+                                                             : INT_MAX);
         packet_num++;
         if (nb_packets != 0 && packet_num >= nb_packets ||
             ts->stop_parse > 1) {
@@ -2541,6 +2710,11 @@ static void mpegts_free(MpegTSContext *ts)
     int i;
 
     clear_programs(ts);
+    av_freep(&ts->prg_discard);
+    ts->nb_prg_discard = 0;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(ts->pools); i++)
+        av_buffer_pool_uninit(&ts->pools[i]);
 
     for (i = 0; i < NB_PID_MAX; i++)
         if (ts->pids[i])
@@ -2650,6 +2824,7 @@ int ff_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
 
     len1 = len;
     ts->pkt = pkt;
+    check_program_discard(ts);
     for (;;) {
         ts->stop_parse = 0;
         if (len < TS_PACKET_SIZE)
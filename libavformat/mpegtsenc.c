@@ -53,6 +53,7 @@ typedef struct MpegTSService {
     int pcr_pid;
     int pcr_packet_count;
     int pcr_packet_period;
+    int64_t last_pcr;  /* PCR of the last packet with a PCR, CBR only */
 } MpegTSService;
 
 typedef struct MpegTSWrite {
@@ -68,6 +69,8 @@ typedef struct MpegTSWrite {
     int onid;
     int tsid;
     int64_t first_pcr;
+    int64_t nb_packets; ///< number of TS packets written
+    int64_t next_pcr;   ///< earliest PCR at which any service needs a PCR, CBR only
     int mux_rate; ///< set to 1 when VBR
     int pes_payload_size;
 
@@ -528,17 +531,20 @@ static MpegTSService *mpegts_add_service(MpegTSWrite *ts,
     return service;
 }
 
-static int64_t get_pcr(const MpegTSWrite *ts, AVIOContext *pb)
+/* PCR of the next TS packet, from its place in the constant rate
+ * timeline rather than from the output position, which also counts
+ * the m2ts headers and whatever was written before the header */
+static int64_t get_pcr(const MpegTSWrite *ts)
 {
-    return av_rescale(avio_tell(pb) + 11, 8 * PCR_TIME_BASE, ts->mux_rate) +
-           ts->first_pcr;
+    return av_rescale(ts->nb_packets * TS_PACKET_SIZE + 11,
+                      8 * PCR_TIME_BASE, ts->mux_rate) + ts->first_pcr;
 }
 
 static void mpegts_prefix_m2ts_header(AVFormatContext *s)
 {
     MpegTSWrite *ts = s->priv_data;
     if (ts->m2ts_mode) {
-        int64_t pcr = get_pcr(s->priv_data, s->pb);
+        int64_t pcr = get_pcr(s->priv_data);
         uint32_t tp_extra_header = pcr % 0x3fffffff;
         tp_extra_header = AV_RB32(&tp_extra_header);
         avio_write(s->pb, (unsigned char *) &tp_extra_header,
@@ -546,11 +552,18 @@ static void mpegts_prefix_m2ts_header(AVFormatContext *s)
     }
 }
 
+static void write_packet(AVFormatContext *s, const uint8_t *packet)
+{
+    MpegTSWrite *ts = s->priv_data;
+    mpegts_prefix_m2ts_header(s);
+    avio_write(s->pb, packet, TS_PACKET_SIZE);
+    ts->nb_packets++;
+}
+
 static void section_write_packet(MpegTSSection *s, const uint8_t *packet)
 {
     AVFormatContext *ctx = s->opaque;
-    mpegts_prefix_m2ts_header(ctx);
-    avio_write(ctx->pb, packet, TS_PACKET_SIZE);
+    write_packet(ctx, packet);
 }
 
 static int mpegts_write_header(AVFormatContext *s)
@@ -701,6 +714,10 @@ static int mpegts_write_header(AVFormatContext *s)
 
         if(ts->copyts < 1)
             ts->first_pcr = av_rescale(s->max_delay, PCR_TIME_BASE, AV_TIME_BASE);
+
+        // output a PCR as soon as possible
+        service->last_pcr = INT64_MIN / 2;
+        ts->next_pcr      = INT64_MIN;
     } else {
         /* Arbitrary values, PAT/PMT will also be written on video key frames */
         ts->sdt_packet_period = 200;
@@ -813,8 +830,7 @@ static void mpegts_insert_null_packet(AVFormatContext *s)
     *q++ = 0xff;
     *q++ = 0x10;
     memset(q, 0x0FF, TS_PACKET_SIZE - (q - buf));
-    mpegts_prefix_m2ts_header(s);
-    avio_write(s->pb, buf, TS_PACKET_SIZE);
+    write_packet(s, buf);
 }
 
 /* Write a single transport stream packet with a PCR and no payload */
@@ -835,12 +851,58 @@ static void mpegts_insert_pcr_only(AVFormatContext *s, AVStream *st)
     *q++ = 0x10;               /* Adaptation flags: PCR present */
 
     /* PCR coded into 6 bytes */
-    q += write_pcr_bits(q, get_pcr(ts, s->pb));
+    q += write_pcr_bits(q, get_pcr(ts));
 
     /* stuffing bytes */
     memset(q, 0xFF, TS_PACKET_SIZE - (q - buf));
-    mpegts_prefix_m2ts_header(s);
-    avio_write(s->pb, buf, TS_PACKET_SIZE);
+    write_packet(s, buf);
+}
+
+/**
+ * Check which services are due for a PCR at the current point of the
+ * constant rate timeline. A PCR-only packet is inserted for every such
+ * service whose PCR is not carried by st, so that PCRs are at most
+ * pcr_period apart in every service no matter how the services' streams
+ * are interleaved.
+ *
+ * @return 1 if the next packet of st must carry a PCR, 0 otherwise
+ */
+static int mpegts_schedule_pcr(AVFormatContext *s, AVStream *st)
+{
+    MpegTSWrite *ts = s->priv_data;
+    MpegTSWriteStream *ts_st = st->priv_data;
+    int64_t pcr_period = av_rescale(ts->pcr_period, PCR_TIME_BASE, 1000);
+    int64_t pcr = get_pcr(ts), next_pcr = INT64_MAX;
+    int i, j, write_pcr = 0;
+
+    if (pcr < ts->next_pcr)
+        return 0;
+
+    for (i = 0; i < ts->nb_services; i++) {
+        MpegTSService *service = ts->services[i];
+
+        if (pcr - service->last_pcr >= pcr_period) {
+            /* do not let late PCRs accumulate into a burst */
+            service->last_pcr = FFMAX(pcr - pcr_period,
+                                      service->last_pcr + pcr_period);
+            if (service->pcr_pid == ts_st->pid) {
+                write_pcr = 1;
+            } else {
+                for (j = 0; j < s->nb_streams; j++) {
+                    MpegTSWriteStream *ts_st2 = s->streams[j]->priv_data;
+                    if (ts_st2->pid == service->pcr_pid) {
+                        mpegts_insert_pcr_only(s, s->streams[j]);
+                        pcr = get_pcr(ts);
+                        break;
+                    }
+                }
+            }
+        }
+        next_pcr = FFMIN(next_pcr, service->last_pcr + pcr_period);
+    }
+    ts->next_pcr = next_pcr;
+
+    return write_pcr;
 }
 
 static void write_pts(uint8_t *q, int fourbits, int64_t pts)
@@ -915,8 +977,11 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         force_pat = 0;
 
         write_pcr = 0;
-        if (ts_st->pid == ts_st->service->pcr_pid) {
-            if (ts->mux_rate > 1 || is_start) // VBR pcr period is based on frames
+        if (ts->mux_rate > 1) {
+            /* CBR pcr period is based on the packet timeline */
+            write_pcr = mpegts_schedule_pcr(s, st);
+        } else if (ts_st->pid == ts_st->service->pcr_pid) {
+            if (is_start) // VBR pcr period is based on frames
                 ts_st->service->pcr_packet_count++;
             if (ts_st->service->pcr_packet_count >=
                 ts_st->service->pcr_packet_period) {
@@ -926,7 +991,7 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         }
 
         if (ts->mux_rate > 1 && dts != AV_NOPTS_VALUE &&
-            (dts - get_pcr(ts, s->pb)/300) > delay) {
+            (dts - get_pcr(ts)/300) > delay) {
             /* pcr insert gets priority over null packet insert */
             if (write_pcr)
                 mpegts_insert_pcr_only(s, st);
@@ -956,9 +1021,10 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
             set_af_flag(buf, 0x10);
             q = get_ts_payload_start(buf);
             // add 11, pcr references the last byte of program clock reference base
-            if (ts->mux_rate > 1)
-                pcr = get_pcr(ts, s->pb);
-            else
+            if (ts->mux_rate > 1) {
+                pcr = get_pcr(ts);
+                ts_st->service->last_pcr = FFMAX(ts_st->service->last_pcr, pcr);
+            } else
                 pcr = (dts - delay)*300;
             if (dts != AV_NOPTS_VALUE && dts < pcr / 300)
                 av_log(s, AV_LOG_WARNING, "dts < pcr, TS is invalid\n");
@@ -1136,8 +1202,7 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
 
         payload += len;
         payload_size -= len;
-        mpegts_prefix_m2ts_header(s);
-        avio_write(s->pb, buf, TS_PACKET_SIZE);
+        write_packet(s, buf);
     }
     avio_flush(s->pb);
     ts_st->prev_payload_key = key;
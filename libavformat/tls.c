@@ -60,6 +60,7 @@
 typedef struct {
     const AVClass *class;
     URLContext *tcp;
+    AVIOInterruptCB tcp_interrupt_callback;
 #if CONFIG_GNUTLS
     gnutls_session_t session;
     gnutls_certificate_credentials_t cred;
@@ -163,6 +164,15 @@ static void set_options(URLContext *h, const char *uri)
         c->key_file = av_strdup(buf);
 }
 
+/* Forward to the callback of the tls context, so that it remains the only
+ * one to update when the connection changes hands (e.g. when reused by a
+ * later http request). */
+static int tls_check_interrupt(void *opaque)
+{
+    URLContext *h = opaque;
+    return ff_check_interrupt(&h->interrupt_callback);
+}
+
 static int tls_open(URLContext *h, const char *uri, int flags)
 {
     TLSContext *c = h->priv_data;
@@ -206,8 +216,10 @@ static int tls_open(URLContext *h, const char *uri, int flags)
                     proxy_port, "/%s", dest);
     }
 
+    c->tcp_interrupt_callback.callback = tls_check_interrupt;
+    c->tcp_interrupt_callback.opaque   = h;
     ret = ffurl_open(&c->tcp, buf, AVIO_FLAG_READ_WRITE,
-                     &h->interrupt_callback, NULL);
+                     &c->tcp_interrupt_callback, NULL);
     if (ret)
         goto fail;
     c->fd = ffurl_get_file_handle(c->tcp);
@@ -25,6 +25,7 @@
  */
 
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() */
 
 #include "avformat.h"
 #include "avio_internal.h"
@@ -48,6 +49,8 @@
 #define HAVE_PTHREAD_CANCEL 0
 #endif
 
+#define HAVE_MMSG (HAVE_RECVMMSG && HAVE_SENDMMSG)
+
 #ifndef IPV6_ADD_MEMBERSHIP
 #define IPV6_ADD_MEMBERSHIP IPV6_JOIN_GROUP
 #define IPV6_DROP_MEMBERSHIP IPV6_LEAVE_GROUP
@@ -55,6 +58,8 @@
 
 #define UDP_TX_BUF_SIZE 32768
 #define UDP_MAX_PKT_SIZE 65536
+/* number of datagrams received or sent per system call by the threads */
+#define UDP_BATCH_SIZE 16
 
 typedef struct {
     const AVClass *class;
@@ -74,11 +79,21 @@ typedef struct {
     int circular_buffer_size;
     AVFifoBuffer *fifo;
     int circular_buffer_error;
+    int64_t bitrate;    /* fixed bitrate of the sending thread, 0 if none */
+    int64_t burst_bits; /* size of the bitrate limiter's token bucket */
+    int close_req;
 #if HAVE_PTHREAD_CANCEL
     pthread_t circular_buffer_thread;
     pthread_mutex_t mutex;
     pthread_cond_t cond;
     int thread_started;
+#endif
+    /* UDP_BATCH_SIZE buffers of UDP_MAX_PKT_SIZE+4 bytes for the threads */
+    uint8_t *batch_buf;
+#if HAVE_MMSG
+    struct mmsghdr msgs[UDP_BATCH_SIZE];
+    struct iovec iovs[UDP_BATCH_SIZE];
+    int no_mmsg;
 #endif
     uint8_t tmp[UDP_MAX_PKT_SIZE+4];
     int remaining_in_dg;
@@ -101,7 +116,9 @@ static const AVOption options[] = {
 {"ttl", "set the time to live value (for multicast only)", OFFSET(ttl), AV_OPT_TYPE_INT, {.i64 = 16}, 0, INT_MAX, E },
 {"connect", "set if connect() should be called on socket", OFFSET(is_connected), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, D|E },
 /* TODO 'sources', 'block' option */
-{"fifo_size", "set the UDP receiving circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D },
+{"fifo_size", "set the UDP circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D|E },
+{"bitrate", "send datagrams from a thread at this fixed bitrate, in bits per second", OFFSET(bitrate), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, E },
+{"burst_bits", "maximum number of bits sent at once above the bitrate", OFFSET(burst_bits), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, E },
 {"overrun_nonfatal", "survive in case of UDP receiving circular buffer overrun", OFFSET(overrun_nonfatal), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, D },
 {"timeout", "set raise error timeout (only in read mode)", OFFSET(timeout), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, D },
 {NULL}
@@ -444,7 +461,64 @@ static int udp_get_file_handle(URLContext *h)
     return s->udp_fd;
 }
 
+static int udp_send(UDPContext *s, const uint8_t *buf, int size)
+{
+    int ret;
+
+    if (!s->is_connected) {
+        ret = sendto (s->udp_fd, buf, size, 0,
+                      (struct sockaddr *) &s->dest_addr,
+                      s->dest_addr_len);
+    } else
+        ret = send(s->udp_fd, buf, size, 0);
+
+    return ret < 0 ? ff_neterrno() : ret;
+}
+
 #if HAVE_PTHREAD_CANCEL
+/**
+ * Receive up to UDP_BATCH_SIZE datagrams, blocking until at least one is
+ * available. Datagram i is stored at bufs[i] + 4 and its size in sizes[i].
+ *
+ * @return number of datagrams received or a negative AVERROR
+ */
+static int udp_recv_batch(UDPContext *s, uint8_t **bufs, int *sizes)
+{
+    int len;
+
+#if HAVE_MMSG
+    if (!s->no_mmsg) {
+        int i, n;
+
+        for (i = 0; i < UDP_BATCH_SIZE; i++) {
+            s->iovs[i].iov_base = s->batch_buf + i * (UDP_MAX_PKT_SIZE + 4) + 4;
+            s->iovs[i].iov_len  = UDP_MAX_PKT_SIZE;
+            memset(&s->msgs[i].msg_hdr, 0, sizeof(s->msgs[i].msg_hdr));
+            s->msgs[i].msg_hdr.msg_iov    = &s->iovs[i];
+            s->msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        n = recvmmsg(s->udp_fd, s->msgs, UDP_BATCH_SIZE, MSG_WAITFORONE, NULL);
+        if (n >= 0) {
+            for (i = 0; i < n; i++) {
+                bufs[i]  = s->batch_buf + i * (UDP_MAX_PKT_SIZE + 4);
+                sizes[i] = s->msgs[i].msg_len;
+            }
+            return n;
+        }
+        if (errno != ENOSYS)
+            return ff_neterrno();
+        s->no_mmsg = 1;
+    }
+#endif
+
+    len = recv(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0);
+    if (len < 0)
+        return ff_neterrno();
+    bufs[0]  = s->tmp;
+    sizes[0] = len;
+    return 1;
+}
+
 static void *circular_buffer_task( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -459,41 +533,165 @@ static void *circular_buffer_task( void *_URLContext)
         goto end;
     }
     while(1) {
-        int len;
+        uint8_t *bufs[UDP_BATCH_SIZE];
+        int sizes[UDP_BATCH_SIZE];
+        int i, n, len;
 
         pthread_mutex_unlock(&s->mutex);
         /* Blocking operations are always cancellation points;
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        len = recv(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0);
+        n = udp_recv_batch(s, bufs, sizes);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
         pthread_mutex_lock(&s->mutex);
-        if (len < 0) {
-            if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
-                s->circular_buffer_error = ff_neterrno();
+        if (n < 0) {
+            if (n != AVERROR(EAGAIN) && n != AVERROR(EINTR)) {
+                s->circular_buffer_error = n;
                 goto end;
             }
             continue;
         }
-        AV_WL32(s->tmp, len);
+        for (i = 0; i < n; i++) {
+            len = sizes[i];
+            AV_WL32(bufs[i], len);
+
+            if(av_fifo_space(s->fifo) < len + 4) {
+                /* No Space left */
+                if (s->overrun_nonfatal) {
+                    av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                            "Surviving due to overrun_nonfatal option\n");
+                    continue;
+                } else {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                            "To avoid, increase fifo_size URL option. "
+                            "To survive in such case, use overrun_nonfatal option\n");
+                    s->circular_buffer_error = AVERROR(EIO);
+                    goto end;
+                }
+            }
+            av_fifo_generic_write(s->fifo, bufs[i], len+4, NULL);
+        }
+        pthread_cond_signal(&s->cond);
+    }
 
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
-                continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
+end:
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+    return NULL;
+}
+
+/**
+ * Send n datagrams, datagram i being sizes[i] bytes at bufs[i] + 4.
+ *
+ * @return 0 on success or a negative AVERROR
+ */
+static int udp_send_batch(UDPContext *s, uint8_t **bufs, const int *sizes, int n)
+{
+    int i = 0, ret;
+
+#if HAVE_MMSG
+    while (!s->no_mmsg && i < n) {
+        int j;
+
+        for (j = i; j < n; j++) {
+            s->iovs[j].iov_base = bufs[j] + 4;
+            s->iovs[j].iov_len  = sizes[j];
+            memset(&s->msgs[j].msg_hdr, 0, sizeof(s->msgs[j].msg_hdr));
+            s->msgs[j].msg_hdr.msg_iov    = &s->iovs[j];
+            s->msgs[j].msg_hdr.msg_iovlen = 1;
+            if (!s->is_connected) {
+                s->msgs[j].msg_hdr.msg_name    = &s->dest_addr;
+                s->msgs[j].msg_hdr.msg_namelen = s->dest_addr_len;
             }
         }
-        av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
+        ret = sendmmsg(s->udp_fd, s->msgs + i, n - i, 0);
+        if (ret > 0) {
+            i += ret;
+        } else if (ret < 0 && errno == ENOSYS) {
+            s->no_mmsg = 1;
+        } else if (ret < 0 && errno != EINTR && errno != EAGAIN) {
+            return ff_neterrno();
+        }
+    }
+#endif
+
+    for (; i < n; i++) {
+        ret = udp_send(s, bufs[i] + 4, sizes[i]);
+        if (ret < 0 && ret != AVERROR(EINTR) && ret != AVERROR(EAGAIN))
+            return ret;
+    }
+    return 0;
+}
+
+/**
+ * Send the datagrams queued by udp_write(), batched, at s->bitrate.
+ * The pacing is a token bucket: tokens accumulate at the bitrate, up to
+ * burst_bits, and a datagram is sent once there are as many tokens as it
+ * has bits.
+ */
+static void *circular_buffer_task_tx( void *_URLContext)
+{
+    URLContext *h = _URLContext;
+    UDPContext *s = h->priv_data;
+    int64_t burst_bits = FFMAX(s->burst_bits, 8LL * s->packet_size);
+    int64_t tokens = burst_bits, last_time = av_gettime_relative();
+    int ret;
+
+    if (ff_socket_nonblock(s->udp_fd, 0) < 0) {
+        av_log(h, AV_LOG_ERROR, "Failed to set blocking mode");
+        pthread_mutex_lock(&s->mutex);
+        s->circular_buffer_error = AVERROR(EIO);
+        goto end;
+    }
+
+    pthread_mutex_lock(&s->mutex);
+    while (1) {
+        uint8_t *bufs[UDP_BATCH_SIZE];
+        int sizes[UDP_BATCH_SIZE];
+        int64_t now;
+        int i, n = 0;
+
+        if (!av_fifo_size(s->fifo)) {
+            if (s->close_req)
+                break;
+            pthread_cond_wait(&s->cond, &s->mutex);
+            continue;
+        }
+
+        now        = av_gettime_relative();
+        tokens     = FFMIN(tokens + av_rescale(now - last_time, s->bitrate, 1000000),
+                           burst_bits);
+        last_time  = now;
+
+        /* take as many datagrams as the tokens allow */
+        while (n < UDP_BATCH_SIZE && av_fifo_size(s->fifo)) {
+            uint8_t *buf = s->batch_buf + n * (UDP_MAX_PKT_SIZE + 4);
+            for (i = 0; i < 4; i++)
+                buf[i] = *av_fifo_peek2(s->fifo, i);
+            sizes[n] = AV_RL32(buf);
+            if (tokens < 8LL * sizes[n])
+                break;
+            av_fifo_generic_read(s->fifo, buf, sizes[n] + 4, NULL);
+            tokens -= 8LL * sizes[n];
+            bufs[n++] = buf;
+        }
         pthread_cond_signal(&s->cond);
+        pthread_mutex_unlock(&s->mutex);
+
+        if (n) {
+            ret = udp_send_batch(s, bufs, sizes, n);
+        } else {
+            /* wait for the tokens of the next datagram */
+            ret = 0;
+            av_usleep(av_rescale(8LL * sizes[0] - tokens, 1000000, s->bitrate) + 1);
+        }
+
+        pthread_mutex_lock(&s->mutex);
+        if (ret < 0) {
+            s->circular_buffer_error = ret;
+            break;
+        }
     }
 
 end:
@@ -589,6 +787,16 @@ static int udp_open(URLContext *h, const char *uri, int flags)
                        "'circular_buffer_size' option was set but it is not supported "
                        "on this build (pthread support is required)\n");
         }
+        if (is_output && av_find_info_tag(buf, sizeof(buf), "bitrate", p)) {
+            s->bitrate = strtoll(buf, NULL, 10);
+            if (!HAVE_PTHREAD_CANCEL)
+                av_log(h, AV_LOG_WARNING,
+                       "'bitrate' option was set but it is not supported "
+                       "on this build (pthread support is required)\n");
+        }
+        if (is_output && av_find_info_tag(buf, sizeof(buf), "burst_bits", p)) {
+            s->burst_bits = strtoll(buf, NULL, 10);
+        }
         if (av_find_info_tag(buf, sizeof(buf), "localaddr", p)) {
             av_strlcpy(localaddr, buf, sizeof(localaddr));
         }
@@ -616,6 +824,21 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     }
     h->rw_timeout = s->timeout;
 
+    if (HAVE_PTHREAD_CANCEL && is_output && s->bitrate) {
+        if (!s->circular_buffer_size) {
+            av_log(h, AV_LOG_ERROR,
+                   "'bitrate' requires a nonzero 'fifo_size' to queue the datagrams\n");
+            goto fail;
+        }
+        /* every datagram is queued with its 4 byte length */
+        if (s->circular_buffer_size < s->packet_size + 4) {
+            av_log(h, AV_LOG_ERROR,
+                   "'fifo_size' of %d bytes cannot hold a packet of pkt_size %d\n",
+                   s->circular_buffer_size, s->packet_size);
+            goto fail;
+        }
+    }
+
     /* fill the dest addr */
     av_url_split(NULL, 0, NULL, 0, hostname, sizeof(hostname), &port, NULL, 0, uri);
 
@@ -738,11 +961,14 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     s->udp_fd = udp_fd;
 
 #if HAVE_PTHREAD_CANCEL
-    if (!is_output && s->circular_buffer_size) {
+    if (s->circular_buffer_size && (!is_output || s->bitrate)) {
         int ret;
 
         /* start the task going */
-        s->fifo = av_fifo_alloc(s->circular_buffer_size);
+        s->fifo      = av_fifo_alloc(s->circular_buffer_size);
+        s->batch_buf = av_malloc(UDP_BATCH_SIZE * (UDP_MAX_PKT_SIZE + 4));
+        if (!s->fifo || !s->batch_buf)
+            goto fail;
         ret = pthread_mutex_init(&s->mutex, NULL);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
@@ -753,7 +979,8 @@ static int udp_open(URLContext *h, const char *uri, int flags)
             av_log(h, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", strerror(ret));
             goto cond_fail;
         }
-        ret = pthread_create(&s->circular_buffer_thread, NULL, circular_buffer_task, h);
+        ret = pthread_create(&s->circular_buffer_thread, NULL,
+                             is_output ? circular_buffer_task_tx : circular_buffer_task, h);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", strerror(ret));
             goto thread_fail;
@@ -773,6 +1000,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_freep(&s->fifo);
+    av_freep(&s->batch_buf);
     for (i = 0; i < num_include_sources; i++)
         av_freep(&include_sources[i]);
     for (i = 0; i < num_exclude_sources; i++)
@@ -844,20 +1072,43 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
     UDPContext *s = h->priv_data;
     int ret;
 
+#if HAVE_PTHREAD_CANCEL
+    if (s->fifo) {
+        uint8_t tmp[4];
+
+        /* would never fit, even with the queue empty */
+        if (size + 4 > s->circular_buffer_size)
+            return AVERROR(EINVAL);
+
+        pthread_mutex_lock(&s->mutex);
+        while (!s->circular_buffer_error && av_fifo_space(s->fifo) < size + 4) {
+            if (h->flags & AVIO_FLAG_NONBLOCK) {
+                pthread_mutex_unlock(&s->mutex);
+                return AVERROR(EAGAIN);
+            }
+            pthread_cond_wait(&s->cond, &s->mutex);
+        }
+        if (s->circular_buffer_error) {
+            ret = s->circular_buffer_error;
+            pthread_mutex_unlock(&s->mutex);
+            return ret;
+        }
+        AV_WL32(tmp, size);
+        av_fifo_generic_write(s->fifo, tmp, 4, NULL);
+        av_fifo_generic_write(s->fifo, (uint8_t *)buf, size, NULL);
+        pthread_cond_signal(&s->cond);
+        pthread_mutex_unlock(&s->mutex);
+        return size;
+    }
+#endif
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 1);
         if (ret < 0)
             return ret;
     }
 
-    if (!s->is_connected) {
-        ret = sendto (s->udp_fd, buf, size, 0,
-                      (struct sockaddr *) &s->dest_addr,
-                      s->dest_addr_len);
-    } else
-        ret = send(s->udp_fd, buf, size, 0);
-
-    return ret < 0 ? ff_neterrno() : ret;
+    return udp_send(s, buf, size);
 }
 
 static int udp_close(URLContext *h)
@@ -865,12 +1116,22 @@ static int udp_close(URLContext *h)
     UDPContext *s = h->priv_data;
     int ret;
 
+#if HAVE_PTHREAD_CANCEL
+    /* let the sending thread send what was written */
+    if (s->thread_started && !(h->flags & AVIO_FLAG_READ)) {
+        pthread_mutex_lock(&s->mutex);
+        s->close_req = 1;
+        pthread_cond_signal(&s->cond);
+        pthread_mutex_unlock(&s->mutex);
+    }
+#endif
+
     if (s->is_multicast && (h->flags & AVIO_FLAG_READ))
         udp_leave_multicast_group(s->udp_fd, (struct sockaddr *)&s->dest_addr,(struct sockaddr *)&s->local_addr_storage);
-    closesocket(s->udp_fd);
 #if HAVE_PTHREAD_CANCEL
     if (s->thread_started) {
-        pthread_cancel(s->circular_buffer_thread);
+        if (h->flags & AVIO_FLAG_READ)
+            pthread_cancel(s->circular_buffer_thread);
         ret = pthread_join(s->circular_buffer_thread, NULL);
         if (ret != 0)
             av_log(h, AV_LOG_ERROR, "pthread_join(): %s\n", strerror(ret));
@@ -878,7 +1139,9 @@ static int udp_close(URLContext *h)
         pthread_cond_destroy(&s->cond);
     }
 #endif
+    closesocket(s->udp_fd);
     av_fifo_freep(&s->fifo);
+    av_freep(&s->batch_buf);
     return 0;
 }
 
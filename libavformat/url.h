@@ -28,6 +28,7 @@
 #include "avio.h"
 #include "libavformat/version.h"
 
+#include "libavutil/buffer.h"
 #include "libavutil/dict.h"
 #include "libavutil/log.h"
 
@@ -89,6 +90,16 @@ typedef struct URLProtocol {
     const AVClass *priv_data_class;
     int flags;
     int (*url_check)(URLContext *h, int mask);
+    /**
+     * Get a read-only reference to size bytes of the resource starting at
+     * pos, without copying them. The referenced data must be followed by
+     * FF_INPUT_BUFFER_PADDING_SIZE zeroed bytes, which are part of the
+     * buffer size. The read position is not changed.
+     *
+     * @return size on success, a negative AVERROR if the data cannot be
+     *         referenced this way
+     */
+    int (*url_get_buffer)(URLContext *h, int64_t pos, int size, AVBufferRef **buf);
 } URLProtocol;
 
 /**
@@ -28,6 +28,7 @@
 
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
+#include "libavutil/cpu.h"
 #include "libavutil/dict.h"
 #include "libavutil/internal.h"
 #include "libavutil/mathematics.h"
@@ -53,6 +54,10 @@
 #include "riff.h"
 #include "url.h"
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 /**
  * @file
  * various utility functions for use within FFmpeg
@@ -231,6 +236,22 @@ int av_get_packet(AVIOContext *s, AVPacket *pkt, int size)
     return append_packet_chunked(s, pkt, size);
 }
 
+int ff_get_packet_ref(AVIOContext *s, AVPacket *pkt, int size)
+{
+    AVBufferRef *buf;
+    int64_t pos = avio_tell(s);
+
+    if (size <= 0 || ffio_read_ref(s, &buf, size) < 0)
+        return av_get_packet(s, pkt, size);
+
+    av_init_packet(pkt);
+    pkt->buf  = buf;
+    pkt->data = buf->data;
+    pkt->size = size;
+    pkt->pos  = pos;
+    return size;
+}
+
 int av_append_packet(AVIOContext *s, AVPacket *pkt, int size)
 {
     if (!pkt->size)
@@ -2699,18 +2720,12 @@ static int has_codec_parameters(AVStream *st, const char **errmsg_ptr)
     return 1;
 }
 
-/* returns 1 or 0 if or if not decoded data was returned, or a negative error */
-static int try_decode_frame(AVFormatContext *s, AVStream *st, AVPacket *avpkt,
-                            AVDictionary **options)
+/* Open the decoder used to analyze the stream, if not done yet. */
+static int open_probe_decoder(AVFormatContext *s, AVStream *st,
+                              AVDictionary **options)
 {
     const AVCodec *codec;
-    int got_picture = 1, ret = 0;
-    AVFrame *frame = av_frame_alloc();
-    AVSubtitle subtitle;
-    AVPacket pkt = *avpkt;
-
-    if (!frame)
-        return AVERROR(ENOMEM);
+    int ret;
 
     if (!avcodec_is_open(st->codec) &&
         st->info->found_decoder <= 0 &&
@@ -2721,8 +2736,7 @@ static int try_decode_frame(AVFormatContext *s, AVStream *st, AVPacket *avpkt,
 
         if (!codec) {
             st->info->found_decoder = -st->codec->codec_id;
-            ret                     = -1;
-            goto fail;
+            return -1;
         }
 
         /* Force thread count to 1 since the H.264 decoder will not extract
@@ -2733,16 +2747,30 @@ static int try_decode_frame(AVFormatContext *s, AVStream *st, AVPacket *avpkt,
             av_dict_free(&thread_opt);
         if (ret < 0) {
             st->info->found_decoder = -st->codec->codec_id;
-            goto fail;
+            return ret;
         }
         st->info->found_decoder = 1;
     } else if (!st->info->found_decoder)
         st->info->found_decoder = 1;
 
-    if (st->info->found_decoder < 0) {
-        ret = -1;
+    return st->info->found_decoder < 0 ? -1 : 0;
+}
+
+/* returns 1 or 0 if or if not decoded data was returned, or a negative error */
+static int try_decode_frame(AVFormatContext *s, AVStream *st, AVPacket *avpkt,
+                            AVDictionary **options)
+{
+    int got_picture = 1, ret = 0;
+    AVFrame *frame = av_frame_alloc();
+    AVSubtitle subtitle;
+    AVPacket pkt = *avpkt;
+
+    if (!frame)
+        return AVERROR(ENOMEM);
+
+    ret = open_probe_decoder(s, st, options);
+    if (ret < 0)
         goto fail;
-    }
 
     while ((pkt.size > 0 || (!pkt.data && got_picture)) &&
            ret >= 0 &&
@@ -3103,6 +3131,237 @@ void ff_rfps_calculate(AVFormatContext *ic)
     }
 }
 
+#define MAX_INFO_THREADS 16
+/* number of packets read before the frames queued for decoding are decoded */
+#define INFO_BATCH_SIZE 32
+
+typedef struct InfoPacket {
+    AVPacket *pkt;
+    int nb_frames;          ///< codec_info_nb_frames when the packet was read
+} InfoPacket;
+
+typedef struct InfoQueue {
+    InfoPacket pkts[INFO_BATCH_SIZE];
+    int nb_pkts;
+} InfoQueue;
+
+/**
+ * Decodes the frames read by avformat_find_stream_info() in batches, the
+ * frames of each stream in order, different streams in parallel. Nothing
+ * else accesses the streams while a batch is decoded.
+ */
+typedef struct InfoThreadContext {
+    AVFormatContext *ic;
+    InfoQueue *queues;
+    int nb_queues;
+    int nb_queued;          ///< number of packets in all queues
+    int flush;              ///< drain the decoders instead of decoding the queues
+
+#if HAVE_PTHREADS
+    pthread_t *threads;
+    int nb_threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_cond_t cond_done;
+    int next_stream;        ///< next stream to be decoded by a thread
+    int nb_streams;         ///< number of streams to decode in this batch
+    int pending;            ///< number of streams of this batch not done yet
+    int exit;
+#endif
+} InfoThreadContext;
+
+static void flush_probe_decoder(AVFormatContext *ic, AVStream *st,
+                                AVDictionary **options)
+{
+    AVPacket empty_pkt = { 0 };
+    int err = 0;
+
+    if (st->info->found_decoder != 1)
+        return;
+
+    av_init_packet(&empty_pkt);
+    do {
+        err = try_decode_frame(ic, st, &empty_pkt, options);
+    } while (err > 0 && !has_codec_parameters(st, NULL));
+
+    if (err < 0) {
+        av_log(ic, AV_LOG_INFO,
+            "decoding for stream %d failed\n", st->index);
+    }
+}
+
+static void info_decode_stream(InfoThreadContext *c, int i)
+{
+    AVStream *st  = c->ic->streams[i];
+    int64_t start = av_gettime_relative();
+
+    if (c->flush) {
+        flush_probe_decoder(c->ic, st, NULL);
+    } else {
+        InfoQueue *q  = &c->queues[i];
+        int nb_frames = st->codec_info_nb_frames;
+        int j;
+
+        for (j = 0; j < q->nb_pkts; j++) {
+            st->codec_info_nb_frames = q->pkts[j].nb_frames;
+            try_decode_frame(c->ic, st, q->pkts[j].pkt, NULL);
+        }
+        st->codec_info_nb_frames = nb_frames;
+        q->nb_pkts = 0;
+    }
+    st->info->decode_time += av_gettime_relative() - start;
+}
+
+#if HAVE_PTHREADS
+static void *info_thread(void *arg)
+{
+    InfoThreadContext *c = arg;
+
+    pthread_mutex_lock(&c->mutex);
+    for (;;) {
+        int i;
+
+        while (!c->exit && c->next_stream >= c->nb_streams)
+            pthread_cond_wait(&c->cond, &c->mutex);
+        if (c->exit)
+            break;
+        i = c->next_stream++;
+        pthread_mutex_unlock(&c->mutex);
+
+        info_decode_stream(c, i);
+
+        pthread_mutex_lock(&c->mutex);
+        if (!--c->pending)
+            pthread_cond_signal(&c->cond_done);
+    }
+    pthread_mutex_unlock(&c->mutex);
+
+    return NULL;
+}
+#endif
+
+/**
+ * Decode the queued packets, or drain the decoders if c->flush is set,
+ * using the calling thread as one of the threads.
+ */
+static void info_run(InfoThreadContext *c)
+{
+    int nb_streams = c->flush ? c->ic->nb_streams : c->nb_queues;
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&c->mutex);
+    c->nb_streams  = nb_streams;
+    c->next_stream = 0;
+    c->pending     = nb_streams;
+    pthread_cond_broadcast(&c->cond);
+    while (c->next_stream < c->nb_streams) {
+        int i = c->next_stream++;
+        pthread_mutex_unlock(&c->mutex);
+        info_decode_stream(c, i);
+        pthread_mutex_lock(&c->mutex);
+        c->pending--;
+    }
+    while (c->pending)
+        pthread_cond_wait(&c->cond_done, &c->mutex);
+    pthread_mutex_unlock(&c->mutex);
+#else
+    int i;
+    for (i = 0; i < nb_streams; i++)
+        info_decode_stream(c, i);
+#endif
+    c->nb_queued = 0;
+}
+
+/**
+ * Queue a packet for decoding, opening the decoder first: only the
+ * decoding itself runs in the threads.
+ */
+static int info_queue_packet(InfoThreadContext *c, AVStream *st, AVPacket *pkt,
+                             AVDictionary **options)
+{
+    InfoQueue *q;
+    int ret;
+
+    if (c->nb_queues < c->ic->nb_streams) {
+        ret = av_reallocp_array(&c->queues, c->ic->nb_streams, sizeof(*c->queues));
+        if (ret < 0) {
+            c->nb_queues = 0;
+            return ret;
+        }
+        memset(c->queues + c->nb_queues, 0,
+               (c->ic->nb_streams - c->nb_queues) * sizeof(*c->queues));
+        c->nb_queues = c->ic->nb_streams;
+    }
+
+    if (open_probe_decoder(c->ic, st, options) < 0)
+        return 0;
+
+    q = &c->queues[st->index];
+    q->pkts[q->nb_pkts].pkt       = pkt;
+    q->pkts[q->nb_pkts].nb_frames = st->codec_info_nb_frames;
+    q->nb_pkts++;
+
+    if (++c->nb_queued >= INFO_BATCH_SIZE)
+        info_run(c);
+    return 0;
+}
+
+static int info_init(InfoThreadContext *c, AVFormatContext *ic, int nb_threads)
+{
+#if HAVE_PTHREADS
+    int i, ret;
+
+    memset(c, 0, sizeof(*c));
+    c->ic = ic;
+
+    c->threads = av_mallocz_array(nb_threads - 1, sizeof(*c->threads));
+    if (!c->threads)
+        return AVERROR(ENOMEM);
+    if ((ret = pthread_mutex_init(&c->mutex, NULL))) {
+        av_freep(&c->threads);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&c->cond, NULL))) {
+        pthread_mutex_destroy(&c->mutex);
+        av_freep(&c->threads);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&c->cond_done, NULL))) {
+        pthread_cond_destroy(&c->cond);
+        pthread_mutex_destroy(&c->mutex);
+        av_freep(&c->threads);
+        return AVERROR(ret);
+    }
+    for (i = 0; i < nb_threads - 1; i++) {
+        if (pthread_create(&c->threads[i], NULL, info_thread, c))
+            break;
+        c->nb_threads++;
+    }
+    return 0;
+#else
+    return AVERROR(ENOSYS);
+#endif
+}
+
+static void info_uninit(InfoThreadContext *c)
+{
+#if HAVE_PTHREADS
+    int i;
+
+    pthread_mutex_lock(&c->mutex);
+    c->exit = 1;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->mutex);
+    for (i = 0; i < c->nb_threads; i++)
+        pthread_join(c->threads[i], NULL);
+
+    pthread_cond_destroy(&c->cond_done);
+    pthread_cond_destroy(&c->cond);
+    pthread_mutex_destroy(&c->mutex);
+    av_freep(&c->threads);
+#endif
+    av_freep(&c->queues);
+}
+
 int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 {
     int i, count, ret = 0, j;
@@ -3114,6 +3373,8 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     int orig_nb_streams = ic->nb_streams;
     int flush_codecs    = ic->probesize > 0;
     int64_t max_analyze_duration = ic->max_analyze_duration2;
+    InfoThreadContext info_ctx, *tc = NULL;
+    int nb_threads = ic->info_threads ? ic->info_threads : av_cpu_count();
     if (!max_analyze_duration)
         max_analyze_duration = ic->max_analyze_duration;
 
@@ -3190,6 +3451,13 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         ic->streams[i]->info->fps_last_dts  = AV_NOPTS_VALUE;
     }
 
+    /* Packets are only kept for the threads in the packet buffer. */
+    nb_threads = FFMIN(nb_threads, MAX_INFO_THREADS);
+    if (nb_threads > 1 && !(ic->flags & AVFMT_FLAG_NOBUFFER)) {
+        if (info_init(&info_ctx, ic, nb_threads) >= 0)
+            tc = &info_ctx;
+    }
+
     count     = 0;
     read_size = 0;
     for (;;) {
@@ -3204,6 +3472,8 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
             int fps_analyze_framecount = 20;
 
             st = ic->streams[i];
+            if (tc && i < tc->nb_queues && tc->queues[i].nb_pkts)
+                break;
             if (!has_codec_parameters(st, NULL))
                 break;
             /* If the timebase is coarse (like the usual millisecond precision
@@ -3217,6 +3487,10 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
                 fps_analyze_framecount = ic->fps_probe_size;
             if (st->disposition & AV_DISPOSITION_ATTACHED_PIC)
                 fps_analyze_framecount = 0;
+            /* the container gives the frame rate */
+            if ((ic->flags & AVFMT_FLAG_FAST_INFO) &&
+                (st->r_frame_rate.num || st->avg_frame_rate.num))
+                fps_analyze_framecount = 0;
             /* variable fps and no guess at the real fps */
             if (!(st->r_frame_rate.num && st->avg_frame_rate.num) &&
                 st->info->duration_count < fps_analyze_framecount &&
@@ -3285,6 +3559,7 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         st = ic->streams[pkt->stream_index];
         if (!(st->disposition & AV_DISPOSITION_ATTACHED_PIC))
             read_size += pkt->size;
+        st->info->read_size += pkt->size;
 
         if (pkt->dts != AV_NOPTS_VALUE && st->codec_info_nb_frames > 1) {
             /* check for non-increasing dts */
@@ -3357,8 +3632,10 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         if (st->parser && st->parser->parser->split && !st->codec->extradata) {
             int i = st->parser->parser->split(st->codec, pkt->data, pkt->size);
             if (i > 0 && i < FF_MAX_EXTRADATA_SIZE) {
-                if (ff_alloc_extradata(st->codec, i))
-                    return AVERROR(ENOMEM);
+                if (ff_alloc_extradata(st->codec, i)) {
+                    ret = AVERROR(ENOMEM);
+                    goto find_stream_info_err;
+                }
                 memcpy(st->codec->extradata, pkt->data,
                        st->codec->extradata_size);
             }
@@ -3373,37 +3650,52 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
          * least one frame of codec data, this makes sure the codec initializes
          * the channel configuration and does not only trust the values from
          * the container. */
-        try_decode_frame(ic, st, pkt,
-                         (options && i < orig_nb_streams) ? &options[i] : NULL);
+        if (tc) {
+            ret = info_queue_packet(tc, st, pkt,
+                                    (options && st->index < orig_nb_streams)
+                                    ? &options[st->index] : NULL);
+            if (ret < 0)
+                goto find_stream_info_err;
+        } else {
+            int64_t start = av_gettime_relative();
+            try_decode_frame(ic, st, pkt,
+                             (options && i < orig_nb_streams) ? &options[i] : NULL);
+            st->info->decode_time += av_gettime_relative() - start;
+        }
 
         st->codec_info_nb_frames++;
         count++;
     }
 
-    if (flush_codecs) {
-        AVPacket empty_pkt = { 0 };
-        int err = 0;
-        av_init_packet(&empty_pkt);
-
-        for (i = 0; i < ic->nb_streams; i++) {
+    if (tc && tc->nb_queued)
+        info_run(tc);
 
-            st = ic->streams[i];
-
-            /* flush the decoders */
-            if (st->info->found_decoder == 1) {
-                do {
-                    err = try_decode_frame(ic, st, &empty_pkt,
-                                            (options && i < orig_nb_streams)
+    if (flush_codecs) {
+        if (tc) {
+            tc->flush = 1;
+            info_run(tc);
+        } else {
+            for (i = 0; i < ic->nb_streams; i++) {
+                int64_t start = av_gettime_relative();
+                st = ic->streams[i];
+                /* flush the decoders */
+                flush_probe_decoder(ic, st, (options && i < orig_nb_streams)
                                             ? &options[i] : NULL);
-                } while (err > 0 && !has_codec_parameters(st, NULL));
-
-                if (err < 0) {
-                    av_log(ic, AV_LOG_INFO,
-                        "decoding for stream %d failed\n", st->index);
-                }
+                st->info->decode_time += av_gettime_relative() - start;
             }
         }
     }
+    if (tc) {
+        info_uninit(tc);
+        tc = NULL;
+    }
+
+    for (i = 0; i < ic->nb_streams; i++) {
+        st = ic->streams[i];
+        av_log(ic, AV_LOG_VERBOSE, "Stream #%d: analyzed %d packets, %"PRId64" bytes, "
+               "decoded %d frames in %"PRId64" us\n", i, st->codec_info_nb_frames,
+               st->info->read_size, st->nb_decoded_frames, st->info->decode_time);
+    }
     av_opt_set(ic, "skip_clear", "0", AV_OPT_SEARCH_CHILDREN);
 
     // close codecs which were opened in try_decode_frame()
@@ -3514,6 +3806,8 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     compute_chapters_end(ic);
 
 find_stream_info_err:
+    if (tc)
+        info_uninit(tc);
     for (i = 0; i < ic->nb_streams; i++) {
         st = ic->streams[i];
         if (ic->streams[i]->codec->codec_type != AVMEDIA_TYPE_AUDIO)
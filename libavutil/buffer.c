@@ -19,6 +19,11 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "config.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #include "atomic.h"
 #include "buffer_internal.h"
 #include "common.h"
@@ -209,6 +214,15 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
     if (!pool)
         return NULL;
 
+    pool->shards_buf = av_mallocz(BUFFER_POOL_SHARDS * sizeof(*pool->shards) +
+                                  BUFFER_POOL_SHARD_SIZE - 1);
+    if (!pool->shards_buf) {
+        av_freep(&pool);
+        return NULL;
+    }
+    pool->shards = (BufferPoolShard *)FFALIGN((uintptr_t)pool->shards_buf,
+                                              BUFFER_POOL_SHARD_SIZE);
+
     pool->size     = size;
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
 
@@ -223,13 +237,20 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
  */
 static void buffer_pool_free(AVBufferPool *pool)
 {
-    while (pool->pool) {
-        BufferPoolEntry *buf = pool->pool;
-        pool->pool = buf->next;
+    int i;
 
-        buf->free(buf->opaque, buf->data);
-        av_freep(&buf);
+    for (i = 0; i < BUFFER_POOL_SHARDS; i++) {
+        BufferPoolShard *shard = &pool->shards[i];
+
+        while (shard->list) {
+            BufferPoolEntry *buf = shard->list;
+            shard->list = buf->next;
+
+            buf->free(buf->opaque, buf->data);
+            av_freep(&buf);
+        }
     }
+    av_freep(&pool->shards_buf);
     av_freep(&pool);
 }
 
@@ -246,14 +267,60 @@ void av_buffer_pool_uninit(AVBufferPool **ppool)
         buffer_pool_free(pool);
 }
 
-/* remove the whole buffer list from the pool and return it */
-static BufferPoolEntry *get_pool(AVBufferPool *pool)
+#if HAVE_PTHREADS
+static pthread_key_t  shard_key;
+static pthread_once_t shard_key_once = PTHREAD_ONCE_INIT;
+static int shard_key_ok;
+static volatile int shard_next;
+
+static void shard_key_init(void)
 {
-    BufferPoolEntry *cur = *(void * volatile *)&pool->pool, *last = NULL;
+    shard_key_ok = !pthread_key_create(&shard_key, NULL);
+}
+#endif
+
+/*
+ * Select the shard used by the calling thread. With pthreads, each thread
+ * is given the next shard round-robin on first use and keeps it in a
+ * thread-specific key, so threads only share a shard once there are more
+ * threads than shards.
+ * Otherwise this is an approximation: the shard is picked by hashing the
+ * address of the stack, which is different in every thread and does not
+ * change much within one, but may map several threads to the same shard or
+ * one thread to several shards.
+ */
+static BufferPoolShard *pool_shard(AVBufferPool *pool)
+{
+    uintptr_t addr;
+    unsigned idx;
+
+#if HAVE_PTHREADS
+    pthread_once(&shard_key_once, shard_key_init);
+    if (shard_key_ok) {
+        uintptr_t id = (uintptr_t)pthread_getspecific(shard_key);
+        if (!id) {
+            /* ids start at 1, since 0 is the value of an unset key */
+            id = (unsigned)avpriv_atomic_int_add_and_fetch(&shard_next, 1);
+            pthread_setspecific(shard_key, (void *)id);
+        }
+        return &pool->shards[(id - 1) & (BUFFER_POOL_SHARDS - 1)];
+    }
+#endif
+
+    addr = (uintptr_t)&addr >> 16;
+    idx  = (uint32_t)(addr * 2654435761U) >> 24;
+
+    return &pool->shards[idx & (BUFFER_POOL_SHARDS - 1)];
+}
+
+/* remove the whole buffer list from the shard and return it */
+static BufferPoolEntry *get_pool(BufferPoolShard *shard)
+{
+    BufferPoolEntry *cur = *(void * volatile *)&shard->list, *last = NULL;
 
     while (cur != last) {
         last = cur;
-        cur = avpriv_atomic_ptr_cas((void * volatile *)&pool->pool, last, NULL);
+        cur = avpriv_atomic_ptr_cas((void * volatile *)&shard->list, last, NULL);
         if (!cur)
             return NULL;
     }
@@ -261,27 +328,48 @@ static BufferPoolEntry *get_pool(AVBufferPool *pool)
     return cur;
 }
 
-static void add_to_pool(BufferPoolEntry *buf)
+static void add_to_pool(BufferPoolShard *shard, BufferPoolEntry *buf)
 {
-    AVBufferPool *pool;
     BufferPoolEntry *cur, *end = buf;
 
     if (!buf)
         return;
-    pool = buf->pool;
 
     while (end->next)
         end = end->next;
 
-    while (avpriv_atomic_ptr_cas((void * volatile *)&pool->pool, NULL, buf)) {
-        /* pool is not empty, retrieve it and append it to our list */
-        cur = get_pool(pool);
+    while (avpriv_atomic_ptr_cas((void * volatile *)&shard->list, NULL, buf)) {
+        /* shard is not empty, retrieve it and append it to our list */
+        cur = get_pool(shard);
         end->next = cur;
         while (end->next)
             end = end->next;
     }
 }
 
+/* take a buffer from the first non-empty shard, starting with our own */
+static BufferPoolEntry *get_from_shards(AVBufferPool *pool, BufferPoolShard *own)
+{
+    BufferPoolEntry *buf;
+    int i, start = own - pool->shards;
+
+    for (i = 0; i < BUFFER_POOL_SHARDS; i++) {
+        BufferPoolShard *shard = &pool->shards[(start + i) & (BUFFER_POOL_SHARDS - 1)];
+
+        if (!shard->list)
+            continue;
+        buf = get_pool(shard);
+        if (buf) {
+            /* keep the first entry, return the rest of the list */
+            add_to_pool(shard, buf->next);
+            buf->next = NULL;
+            return buf;
+        }
+    }
+
+    return NULL;
+}
+
 static void pool_release_buffer(void *opaque, uint8_t *data)
 {
     BufferPoolEntry *buf = opaque;
@@ -290,7 +378,7 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
     if(CONFIG_MEMORY_POISONING)
         memset(buf->data, FF_MEMORY_POISON, pool->size);
 
-    add_to_pool(buf);
+    add_to_pool(pool_shard(pool), buf);
     if (!avpriv_atomic_int_add_and_fetch(&pool->refcount, -1))
         buffer_pool_free(pool);
 }
@@ -328,31 +416,81 @@ static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
 
 AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
 {
+    BufferPoolShard *shard = pool_shard(pool);
     AVBufferRef *ret;
     BufferPoolEntry *buf;
 
     /* check whether the pool is empty */
-    buf = get_pool(pool);
+    buf = get_from_shards(pool, shard);
     if (!buf && pool->refcount <= pool->nb_allocated) {
         av_log(NULL, AV_LOG_DEBUG, "Pool race dectected, spining to avoid overallocation and eventual OOM\n");
         while (!buf && avpriv_atomic_int_get(&pool->refcount) <= avpriv_atomic_int_get(&pool->nb_allocated))
-            buf = get_pool(pool);
+            buf = get_from_shards(pool, shard);
     }
 
-    if (!buf)
+    if (!buf) {
+        avpriv_atomic_int_add_and_fetch(&shard->misses, 1);
         return pool_alloc_buffer(pool);
-
-    /* keep the first entry, return the rest of the list to the pool */
-    add_to_pool(buf->next);
-    buf->next = NULL;
+    }
 
     ret = av_buffer_create(buf->data, pool->size, pool_release_buffer,
                            buf, 0);
     if (!ret) {
-        add_to_pool(buf);
+        add_to_pool(shard, buf);
         return NULL;
     }
     avpriv_atomic_int_add_and_fetch(&pool->refcount, 1);
+    avpriv_atomic_int_add_and_fetch(&shard->hits, 1);
 
     return ret;
 }
+
+void av_buffer_pool_get_stats(AVBufferPool *pool, AVBufferPoolStats *stats)
+{
+    int i;
+
+    memset(stats, 0, sizeof(*stats));
+    for (i = 0; i < BUFFER_POOL_SHARDS; i++) {
+        stats->hits   += (unsigned)avpriv_atomic_int_get(&pool->shards[i].hits);
+        stats->misses += (unsigned)avpriv_atomic_int_get(&pool->shards[i].misses);
+    }
+    stats->nb_allocated   = avpriv_atomic_int_get(&pool->nb_allocated);
+    stats->nb_outstanding = avpriv_atomic_int_get(&pool->refcount) - 1;
+}
+
+#ifdef TEST
+
+static void print_stats(AVBufferPool *pool)
+{
+    AVBufferPoolStats stats;
+
+    av_buffer_pool_get_stats(pool, &stats);
+    printf("hits %u misses %u allocated %d outstanding %d\n",
+           stats.hits, stats.misses, stats.nb_allocated, stats.nb_outstanding);
+}
+
+int main(void)
+{
+    AVBufferPool *pool = av_buffer_pool_init(1024, NULL);
+    AVBufferRef *buf[4];
+    int i, j;
+
+    if (!pool)
+        return 1;
+
+    for (j = 0; j < 3; j++) {
+        for (i = 0; i < 3 + (j == 2); i++)
+            if (!(buf[i] = av_buffer_pool_get(pool)))
+                return 1;
+        print_stats(pool);
+        for (i = 0; i < 3 + (j == 2); i++)
+            av_buffer_unref(&buf[i]);
+        print_stats(pool);
+    }
+
+    av_buffer_pool_uninit(&pool);
+
+    return 0;
+}
+
+#endif
@@ -267,6 +267,43 @@ void av_buffer_pool_uninit(AVBufferPool **pool);
  */
 AVBufferRef *av_buffer_pool_get(AVBufferPool *pool);
 
+/**
+ * Usage statistics of a buffer pool, see av_buffer_pool_get_stats().
+ */
+typedef struct AVBufferPoolStats {
+    /**
+     * Number of av_buffer_pool_get() calls served with a buffer reused from
+     * the pool, modulo 2^32.
+     */
+    unsigned hits;
+    /**
+     * Number of av_buffer_pool_get() calls which had to allocate a new buffer,
+     * modulo 2^32.
+     */
+    unsigned misses;
+    /**
+     * Number of buffers allocated by the pool. Since a buffer is only
+     * allocated when none is available for reuse, this is also the peak
+     * number of buffers in use at the same time.
+     */
+    int nb_allocated;
+    /**
+     * Number of buffers currently in use, i.e. returned by
+     * av_buffer_pool_get() and not released yet.
+     */
+    int nb_outstanding;
+} AVBufferPoolStats;
+
+/**
+ * Get the usage statistics of a buffer pool.
+ * This function may be called simultaneously with av_buffer_pool_get() from
+ * other threads, in which case the statistics are only a snapshot.
+ *
+ * @note hits and misses are 32-bit counters, so they wrap around in long
+ *       running processes.
+ */
+void av_buffer_pool_get_stats(AVBufferPool *pool, AVBufferPoolStats *stats);
+
 /**
  * @}
  */
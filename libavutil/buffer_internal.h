@@ -71,8 +71,39 @@ typedef struct BufferPoolEntry {
     struct BufferPoolEntry * volatile next;
 } BufferPoolEntry;
 
+/**
+ * Number of free lists in a pool, must be a power of 2.
+ */
+#define BUFFER_POOL_SHARDS 8
+
+/**
+ * Size and alignment of a shard, at least the cache line size.
+ */
+#define BUFFER_POOL_SHARD_SIZE 64
+
+/**
+ * A free list of a pool, together with the statistics of the threads using
+ * it. Padded to a whole cache line, and the shards of a pool are allocated
+ * line aligned, so that threads working on different shards do not contend.
+ */
+typedef struct BufferPoolShard {
+    BufferPoolEntry * volatile list;
+
+    volatile int hits;    ///< number of buffers reused from the pool
+    volatile int misses;  ///< number of buffers newly allocated
+
+    uint8_t padding[BUFFER_POOL_SHARD_SIZE - sizeof(BufferPoolEntry *) - 2 * sizeof(int)];
+} BufferPoolShard;
+
 struct AVBufferPool {
-    BufferPoolEntry * volatile pool;
+    /*
+     * Free buffers, spread over BUFFER_POOL_SHARDS lists to reduce contention
+     * when the pool is used from several threads. Each thread preferably uses
+     * the list selected by pool_shard().
+     * shards points into shards_buf, aligned to BUFFER_POOL_SHARD_SIZE.
+     */
+    BufferPoolShard *shards;
+    uint8_t *shards_buf;
 
     /*
      * This is used to track when the pool is to be freed.
@@ -26,8 +26,37 @@
  */
 
 #include "libavutil/avassert.h"
+#include "libavutil/cpu.h"
 #include "resample.h"
 
+/**
+ * Filter bank shared by all resample contexts using the same filter, as
+ * building one is slow for large phase counts.
+ */
+typedef struct SharedFilterBank {
+    struct SharedFilterBank *next;
+    int refcount;
+    uint8_t *filter_bank;
+
+    /* parameters the filter bank was built with */
+    enum AVSampleFormat format;
+    double factor;
+    int filter_length;
+    int filter_alloc;
+    int phase_shift;
+    enum SwrFilterType filter_type;
+    int kaiser_beta;
+} SharedFilterBank;
+
+#if HAVE_PTHREADS
+static SharedFilterBank *shared_banks;
+static pthread_mutex_t shared_banks_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* minimum number of filter taps applied per channel and call for the
+ * channels to be resampled in parallel */
+#define MIN_THREADED_TAPS 16384
+
 /**
  * 0th order modified bessel function of the first kind.
  */
@@ -171,9 +200,199 @@ static int build_filter(ResampleContext *c, void *filter, double factor, int tap
     return 0;
 }
 
+static int alloc_filter_bank(ResampleContext *c, int phase_count)
+{
+    c->filter_bank = av_calloc(c->filter_alloc, (phase_count+1)*c->felem_size);
+    if (!c->filter_bank)
+        return AVERROR(ENOMEM);
+    if (build_filter(c, (void*)c->filter_bank, c->factor, c->filter_length, c->filter_alloc, phase_count, 1<<c->filter_shift, c->filter_type, c->kaiser_beta)) {
+        av_freep(&c->filter_bank);
+        return AVERROR(ENOMEM);
+    }
+    memcpy(c->filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, c->filter_bank, (c->filter_alloc-1)*c->felem_size);
+    memcpy(c->filter_bank + (c->filter_alloc*phase_count  )*c->felem_size, c->filter_bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
+    return 0;
+}
+
+/**
+ * Set c->filter_bank to a filter bank for the parameters of c, shared
+ * with other contexts using the same filter if possible.
+ */
+static int get_filter_bank(ResampleContext *c, int phase_count)
+{
+#if HAVE_PTHREADS
+    SharedFilterBank *b;
+    int ret = 0;
+
+    pthread_mutex_lock(&shared_banks_lock);
+    for (b = shared_banks; b; b = b->next) {
+        if (b->format        == c->format        &&
+            b->factor        == c->factor        &&
+            b->filter_length == c->filter_length &&
+            b->filter_alloc  == c->filter_alloc  &&
+            b->phase_shift   == c->phase_shift   &&
+            b->filter_type   == c->filter_type   &&
+            b->kaiser_beta   == c->kaiser_beta)
+            break;
+    }
+    if (b) {
+        b->refcount++;
+    } else {
+        b = av_mallocz(sizeof(*b));
+        if (!b) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        if ((ret = alloc_filter_bank(c, phase_count)) < 0) {
+            av_free(b);
+            goto end;
+        }
+        b->refcount      = 1;
+        b->filter_bank   = c->filter_bank;
+        b->format        = c->format;
+        b->factor        = c->factor;
+        b->filter_length = c->filter_length;
+        b->filter_alloc  = c->filter_alloc;
+        b->phase_shift   = c->phase_shift;
+        b->filter_type   = c->filter_type;
+        b->kaiser_beta   = c->kaiser_beta;
+        b->next          = shared_banks;
+        shared_banks     = b;
+    }
+    c->filter_bank = b->filter_bank;
+    c->shared_bank = b;
+end:
+    pthread_mutex_unlock(&shared_banks_lock);
+    return ret;
+#else
+    return alloc_filter_bank(c, phase_count);
+#endif
+}
+
+static void release_filter_bank(ResampleContext *c)
+{
+#if HAVE_PTHREADS
+    SharedFilterBank **b;
+
+    if (!c->shared_bank)
+        return;
+
+    pthread_mutex_lock(&shared_banks_lock);
+    if (!--c->shared_bank->refcount) {
+        for (b = &shared_banks; *b != c->shared_bank; b = &(*b)->next)
+            ;
+        *b = c->shared_bank->next;
+        av_free(c->shared_bank->filter_bank);
+        av_free(c->shared_bank);
+    }
+    pthread_mutex_unlock(&shared_banks_lock);
+    c->shared_bank = NULL;
+    c->filter_bank = NULL;
+#else
+    av_freep(&c->filter_bank);
+#endif
+}
+
+#if HAVE_PTHREADS
+static void resample_channel(ResampleContext *c, int i);
+
+static void *resample_thread(void *arg)
+{
+    ResampleContext *c = arg;
+
+    pthread_mutex_lock(&c->mutex);
+    for (;;) {
+        int i;
+
+        while (!c->exit && c->next_ch >= c->nb_ch)
+            pthread_cond_wait(&c->cond, &c->mutex);
+        if (c->exit)
+            break;
+        i = c->next_ch++;
+        pthread_mutex_unlock(&c->mutex);
+
+        resample_channel(c, i);
+
+        pthread_mutex_lock(&c->mutex);
+        if (!--c->pending)
+            pthread_cond_signal(&c->cond_done);
+    }
+    pthread_mutex_unlock(&c->mutex);
+
+    return NULL;
+}
+
+static void free_threads(ResampleContext *c)
+{
+    int i;
+
+    if (!c->threads)
+        return;
+
+    pthread_mutex_lock(&c->mutex);
+    c->exit = 1;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->mutex);
+    for (i = 0; i < c->nb_threads; i++)
+        pthread_join(c->threads[i], NULL);
+
+    pthread_cond_destroy(&c->cond_done);
+    pthread_cond_destroy(&c->cond);
+    pthread_mutex_destroy(&c->mutex);
+    av_freep(&c->threads);
+    c->nb_threads = 0;
+    c->exit       = 0;
+}
+
+/**
+ * Start nb_threads - 1 threads; on failure fewer or none are used.
+ */
+static void init_threads(ResampleContext *c, int nb_threads)
+{
+    int i;
+
+    if (!nb_threads)
+        nb_threads = av_cpu_count();
+    nb_threads = FFMIN(nb_threads, SWR_CH_MAX);
+    if (c->threads && c->nb_threads == nb_threads - 1)
+        return;
+    free_threads(c);
+    if (nb_threads <= 1)
+        return;
+
+    c->threads = av_mallocz_array(nb_threads - 1, sizeof(*c->threads));
+    if (!c->threads)
+        return;
+    if (pthread_mutex_init(&c->mutex, NULL)) {
+        av_freep(&c->threads);
+        return;
+    }
+    if (pthread_cond_init(&c->cond, NULL)) {
+        pthread_mutex_destroy(&c->mutex);
+        av_freep(&c->threads);
+        return;
+    }
+    if (pthread_cond_init(&c->cond_done, NULL)) {
+        pthread_cond_destroy(&c->cond);
+        pthread_mutex_destroy(&c->mutex);
+        av_freep(&c->threads);
+        return;
+    }
+    for (i = 0; i < nb_threads - 1; i++) {
+        if (pthread_create(&c->threads[i], NULL, resample_thread, c))
+            break;
+        c->nb_threads++;
+    }
+    if (!c->nb_threads)
+        free_threads(c);
+}
+#endif
+
+static void resample_free(ResampleContext **c);
+
 static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_rate, int filter_size, int phase_shift, int linear,
                                     double cutoff0, enum AVSampleFormat format, enum SwrFilterType filter_type, int kaiser_beta,
-                                    double precision, int cheby)
+                                    double precision, int cheby, int nb_threads)
 {
     double cutoff = cutoff0? cutoff0 : 0.97;
     double factor= FFMIN(out_rate * cutoff / in_rate, 1.0);
@@ -182,6 +401,7 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
     if (!c || c->phase_shift != phase_shift || c->linear!=linear || c->factor != factor
            || c->filter_length != FFMAX((int)ceil(filter_size/factor), 1) || c->format != format
            || c->filter_type != filter_type || c->kaiser_beta != kaiser_beta) {
+        resample_free(&c);
         c = av_mallocz(sizeof(*c));
         if (!c)
             return NULL;
@@ -217,15 +437,10 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
         c->factor        = factor;
         c->filter_length = FFMAX((int)ceil(filter_size/factor), 1);
         c->filter_alloc  = FFALIGN(c->filter_length, 8);
-        c->filter_bank   = av_calloc(c->filter_alloc, (phase_count+1)*c->felem_size);
         c->filter_type   = filter_type;
         c->kaiser_beta   = kaiser_beta;
-        if (!c->filter_bank)
-            goto error;
-        if (build_filter(c, (void*)c->filter_bank, factor, c->filter_length, c->filter_alloc, phase_count, 1<<c->filter_shift, filter_type, kaiser_beta))
+        if (get_filter_bank(c, phase_count) < 0)
             goto error;
-        memcpy(c->filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, c->filter_bank, (c->filter_alloc-1)*c->felem_size);
-        memcpy(c->filter_bank + (c->filter_alloc*phase_count  )*c->felem_size, c->filter_bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
     }
 
     c->compensation_distance= 0;
@@ -240,17 +455,23 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
 
     swri_resample_dsp_init(c);
 
+#if HAVE_PTHREADS
+    init_threads(c, nb_threads);
+#endif
+
     return c;
 error:
-    av_freep(&c->filter_bank);
-    av_free(c);
+    resample_free(&c);
     return NULL;
 }
 
 static void resample_free(ResampleContext **c){
     if(!*c)
         return;
-    av_freep(&(*c)->filter_bank);
+#if HAVE_PTHREADS
+    free_threads(*c);
+#endif
+    release_filter_bank(*c);
     av_freep(c);
 }
 
@@ -305,23 +526,91 @@ static int swri_resample(ResampleContext *c,
     return dst_size;
 }
 
+static int need_emms(ResampleContext *c)
+{
+    int av_unused mm_flags = av_get_cpu_flags();
+    return c->format == AV_SAMPLE_FMT_S16P && ARCH_X86_32 &&
+           (mm_flags & (AV_CPU_FLAG_MMX2 | AV_CPU_FLAG_SSE2)) == AV_CPU_FLAG_MMX2;
+}
+
+#if HAVE_PTHREADS
+static void resample_channel(ResampleContext *c, int i)
+{
+    AudioData *dst = c->job_dst, *src = c->job_src;
+
+    if (i + 1 == dst->ch_count) {
+        /* the other channels read c while they are resampled, so the
+         * last channel updates a copy that is written back afterwards */
+        ResampleContext tmp = *c;
+        c->job_ret   = swri_resample(&tmp, dst->ch[i], src->ch[i], &c->job_consumed,
+                                     c->job_src_size, c->job_dst_size, 1);
+        c->job_index = tmp.index;
+        c->job_frac  = tmp.frac;
+    } else {
+        int consumed;
+        swri_resample(c, dst->ch[i], src->ch[i], &consumed,
+                      c->job_src_size, c->job_dst_size, 0);
+    }
+    if (need_emms(c))
+        emms_c();
+}
+
+/**
+ * Resample all channels, the calling thread taking part in the work.
+ */
+static int threaded_resample(ResampleContext *c, AudioData *dst, int dst_size,
+                             AudioData *src, int src_size, int *consumed)
+{
+    pthread_mutex_lock(&c->mutex);
+    c->job_dst      = dst;
+    c->job_src      = src;
+    c->job_dst_size = dst_size;
+    c->job_src_size = src_size;
+    c->nb_ch        = dst->ch_count;
+    c->next_ch      = 0;
+    c->pending      = dst->ch_count;
+    pthread_cond_broadcast(&c->cond);
+    while (c->next_ch < c->nb_ch) {
+        int i = c->next_ch++;
+        pthread_mutex_unlock(&c->mutex);
+        resample_channel(c, i);
+        pthread_mutex_lock(&c->mutex);
+        c->pending--;
+    }
+    while (c->pending)
+        pthread_cond_wait(&c->cond_done, &c->mutex);
+    c->nb_ch = 0;
+    pthread_mutex_unlock(&c->mutex);
+
+    c->index  = c->job_index;
+    c->frac   = c->job_frac;
+    *consumed = c->job_consumed;
+    return c->job_ret;
+}
+#endif
+
 static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
     int i, ret= -1;
-    int av_unused mm_flags = av_get_cpu_flags();
-    int need_emms = c->format == AV_SAMPLE_FMT_S16P && ARCH_X86_32 &&
-                    (mm_flags & (AV_CPU_FLAG_MMX2 | AV_CPU_FLAG_SSE2)) == AV_CPU_FLAG_MMX2;
     int64_t max_src_size = (INT64_MAX >> (c->phase_shift+1)) / c->src_incr;
 
     if (c->compensation_distance)
         dst_size = FFMIN(dst_size, c->compensation_distance);
     src_size = FFMIN(src_size, max_src_size);
 
-    for(i=0; i<dst->ch_count; i++){
-        ret= swri_resample(c, dst->ch[i], src->ch[i],
-                           consumed, src_size, dst_size, i+1==dst->ch_count);
+#if HAVE_PTHREADS
+    if (c->nb_threads && dst->ch_count > 1 &&
+        (int64_t)dst_size * c->filter_length >= MIN_THREADED_TAPS) {
+        ret = threaded_resample(c, dst, dst_size, src, src_size, consumed);
+    } else
+#endif
+    {
+        for(i=0; i<dst->ch_count; i++){
+            ret= swri_resample(c, dst->ch[i], src->ch[i],
+                               consumed, src_size, dst_size, i+1==dst->ch_count);
+        }
+        if(need_emms(c))
+            emms_c();
     }
-    if(need_emms)
-        emms_c();
 
     if (c->compensation_distance) {
         c->compensation_distance -= ret;
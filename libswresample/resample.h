@@ -27,6 +27,12 @@
 
 #include "swresample_internal.h"
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+struct SharedFilterBank;
+
 typedef struct ResampleContext {
     const AVClass *av_class;
     uint8_t *filter_bank;
@@ -56,6 +62,30 @@ typedef struct ResampleContext {
         int (*resample)(struct ResampleContext *c, void *dst,
                         const void *src, int n, int update_ctx);
     } dsp;
+
+    struct SharedFilterBank *shared_bank;    ///< owner of filter_bank if it is shared
+
+#if HAVE_PTHREADS
+    /* resampling of the channels of one multiple_resample() call in
+     * parallel; the calling thread is one of the threads */
+    pthread_t *threads;
+    int nb_threads;                          ///< number of threads besides the calling one
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_cond_t cond_done;
+    AudioData *job_dst;
+    AudioData *job_src;
+    int job_dst_size;
+    int job_src_size;
+    int job_ret;                             ///< return value for the last channel
+    int job_consumed;                        ///< consumed samples of the last channel
+    int job_index;                           ///< index after the last channel
+    int job_frac;                            ///< frac after the last channel
+    int next_ch;                             ///< next channel to be resampled by a thread
+    int nb_ch;                               ///< number of channels of the current call
+    int pending;                             ///< number of channels not done yet
+    int exit;
+#endif
 } ResampleContext;
 
 void swri_resample_dsp_init(ResampleContext *c);
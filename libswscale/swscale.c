@@ -307,6 +307,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     const int srcW                   = c->srcW;
     const int dstW                   = c->dstW;
     const int dstH                   = c->dstH;
+    const int dstEnd                 = c->dstSliceEnd ? c->dstSliceEnd : dstH;
     const int chrDstW                = c->chrDstW;
     const int chrSrcW                = c->chrSrcW;
     const int lumXInc                = c->lumXInc;
@@ -410,7 +411,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     if (srcSliceY == 0) {
         lumBufIndex  = -1;
         chrBufIndex  = -1;
-        dstY         = 0;
+        dstY         = c->dstSliceY;
         lastInLumBuf = -1;
         lastInChrBuf = -1;
     }
@@ -420,7 +421,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     }
     lastDstY = dstY;
 
-    for (; dstY < dstH; dstY++) {
+    for (; dstY < dstEnd; dstY++) {
         const int chrDstY = dstY >> c->chrDstVSubSample;
         uint8_t *dest[4]  = {
             dst[0] + dstStride[0] * dstY,
@@ -1086,3 +1087,44 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
     return ret;
 }
 
+int sws_dst_slice_alignment(struct SwsContext *c)
+{
+    /* Error diffusion carries state from one output line to the next and
+     * the special converters do not support partial output. */
+    if (c->swscale != swscale || c->srcXYZ || c->dstXYZ ||
+        c->dither == SWS_DITHER_ED)
+        return 0;
+
+    return 1 << c->chrDstVSubSample;
+}
+
+int attribute_align_arg sws_scale_dst_slice(struct SwsContext *c,
+                                            const uint8_t *const src[],
+                                            const int srcStride[],
+                                            int dstSliceY, int dstSliceH,
+                                            uint8_t *const dst[],
+                                            const int dstStride[])
+{
+    int align = sws_dst_slice_alignment(c);
+    int dstSliceEnd = dstSliceY + dstSliceH;
+    int ret;
+
+    if (!align)
+        return AVERROR(ENOSYS);
+    if (dstSliceY < 0 || dstSliceH <= 0 || dstSliceEnd > c->dstH ||
+        dstSliceY & (align - 1) ||
+        (dstSliceEnd != c->dstH && dstSliceEnd & (align - 1)) ||
+        c->sliceDir) {
+        av_log(c, AV_LOG_ERROR, "Invalid destination slice %d+%d\n",
+               dstSliceY, dstSliceH);
+        return AVERROR(EINVAL);
+    }
+
+    c->dstSliceY   = dstSliceY;
+    c->dstSliceEnd = dstSliceEnd;
+    ret = sws_scale(c, src, srcStride, 0, c->srcH, dst, dstStride);
+    c->dstSliceY   = 0;
+    c->dstSliceEnd = 0;
+
+    return ret;
+}
@@ -227,6 +227,46 @@ int sws_scale(struct SwsContext *c, const uint8_t *const srcSlice[],
               const int srcStride[], int srcSliceY, int srcSliceH,
               uint8_t *const dst[], const int dstStride[]);
 
+/**
+ * Return the alignment required for the first row of a destination
+ * slice passed to sws_scale_dst_slice().
+ *
+ * @param c the scaling context previously created with sws_getContext()
+ * @return  the alignment in rows (a power of 2), or 0 if the conversion
+ *          described by c cannot be split into destination slices
+ */
+int sws_dst_slice_alignment(struct SwsContext *c);
+
+/**
+ * Scale the whole source image in src, but only compute and write the
+ * destination rows in the range [dstSliceY, dstSliceY + dstSliceH).
+ *
+ * The output is identical to the corresponding rows produced by
+ * sws_scale() for the whole image, so several contexts created with the
+ * same parameters can be used to produce disjoint slices of the same
+ * destination image concurrently.
+ *
+ * @param c         the scaling context previously created with
+ *                  sws_getContext()
+ * @param src       the array containing the pointers to the planes of
+ *                  the whole source image
+ * @param srcStride the array containing the strides for each plane of
+ *                  the source image
+ * @param dstSliceY the first destination row to output, must be a
+ *                  multiple of sws_dst_slice_alignment()
+ * @param dstSliceH the number of destination rows to output, the end of
+ *                  the slice must be aligned as dstSliceY unless it is
+ *                  the end of the image
+ * @param dst       the array containing the pointers to the planes of
+ *                  the whole destination image
+ * @param dstStride the array containing the strides for each plane of
+ *                  the destination image
+ * @return          the height of the output slice or a negative error code
+ */
+int sws_scale_dst_slice(struct SwsContext *c, const uint8_t *const src[],
+                        const int srcStride[], int dstSliceY, int dstSliceH,
+                        uint8_t *const dst[], const int dstStride[]);
+
 /**
  * @param dstRange flag indicating the while-black range of the output (1=jpeg / 0=mpeg)
  * @param srcRange flag indicating the while-black range of the input (1=jpeg / 0=mpeg)
@@ -364,6 +364,8 @@ typedef struct SwsContext {
     int canMMXEXTBeUsed;
 
     int dstY;                     ///< Last destination vertical line output from last slice.
+    int dstSliceY;                ///< First destination line to output, set by sws_scale_dst_slice().
+    int dstSliceEnd;              ///< Destination line after the last one to output, 0 for the whole image.
     int flags;                    ///< Flags passed by the user to select scaler algorithm, optimizations, subsampling, etc...
     void *yuvTable;             // pointer to the yuv->rgb table start so it can be freed()
     // alignment ensures the offset can be added in a single
@@ -29,5 +29,15 @@ FATE_FFPROBE += fate-ffprobe_xml
 fate-ffprobe_xml: $(FFPROBE_TEST_FILE)
 fate-ffprobe_xml: CMD = run $(FFPROBE_COMMAND) -of xml
 
+FATE_FFPROBE += fate-ffprobe_streams
+fate-ffprobe_streams: $(FFPROBE_TEST_FILE)
+fate-ffprobe_streams: CMD = run ffprobe$(EXESUF) -show_streams -bitexact -of compact $(FFPROBE_TEST_FILE)
+
+# decoding the streams in parallel must not change what is found about them
+FATE_FFPROBE += fate-ffprobe_streams_info_threads
+fate-ffprobe_streams_info_threads: $(FFPROBE_TEST_FILE)
+fate-ffprobe_streams_info_threads: CMD = run ffprobe$(EXESUF) -show_streams -bitexact -of compact -info_threads 4 $(FFPROBE_TEST_FILE)
+fate-ffprobe_streams_info_threads: REF = $(SRC_PATH)/tests/ref/fate/ffprobe_streams
+
 fate-ffprobe: $(FATE_FFPROBE)
 
@@ -2,6 +2,10 @@ FATE_LIBAVFORMAT-$(CONFIG_NETWORK) += fate-noproxy
 fate-noproxy: libavformat/noproxy-test$(EXESUF)
 fate-noproxy: CMD = run libavformat/noproxy-test
 
+FATE_LIBAVFORMAT-yes += fate-compactindex
+fate-compactindex: libavformat/compactindex-test$(EXESUF)
+fate-compactindex: CMD = run libavformat/compactindex-test
+
 FATE_LIBAVFORMAT-yes += fate-srtp
 fate-srtp: libavformat/srtp-test$(EXESUF)
 fate-srtp: CMD = run libavformat/srtp-test
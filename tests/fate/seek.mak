@@ -142,6 +142,7 @@ fate-seek-vsynth2-mpeg4-qpel:        SRC = fate/vsynth2-mpeg4-qpel.avi
 fate-seek-vsynth2-mpeg4-qprd:        SRC = fate/vsynth2-mpeg4-qprd.avi
 fate-seek-vsynth2-mpeg4-rc:          SRC = fate/vsynth2-mpeg4-rc.avi
 fate-seek-vsynth2-mpeg4-thread:      SRC = fate/vsynth2-mpeg4-thread.avi
+fate-seek-vsynth2-mpeg4-thread-me:   SRC = fate/vsynth2-mpeg4-thread-me.avi
 fate-seek-vsynth2-msmpeg4:           SRC = fate/vsynth2-msmpeg4.avi
 fate-seek-vsynth2-msmpeg4v2:         SRC = fate/vsynth2-msmpeg4v2.avi
 fate-seek-vsynth2-rgb:               SRC = fate/vsynth2-rgb.avi
@@ -174,6 +175,7 @@ FATE_SEEK_LAVF-$(call ENCDEC,  MJPEG,                 IMAGE2)      += jpg
 FATE_SEEK_LAVF-$(call ENCDEC2, MPEG4,      MP2,       MATROSKA)    += mkv
 FATE_SEEK_LAVF-$(call ENCDEC,  ADPCM_YAMAHA,          MMF)         += mmf
 FATE_SEEK_LAVF-$(call ENCDEC2, MPEG4,      PCM_ALAW,  MOV)         += mov
+FATE_SEEK_LAVF-$(call ENCDEC2, MPEG4,      MP2,       MP4 MOV)     += mp4_frag
 FATE_SEEK_LAVF-$(call ENCDEC2, MPEG1VIDEO, MP2,       MPEG1SYSTEM MPEGPS) += mpg
 FATE_SEEK_LAVF-$(call ENCDEC,  PCM_MULAW,             PCM_MULAW)   += mulaw
 FATE_SEEK_LAVF-$(call ENCDEC2, MPEG2VIDEO, PCM_S16LE, MXF)         += mxf
@@ -212,6 +214,7 @@ fate-seek-lavf-jpg:      SRC = images/jpg/%02d.jpg
 fate-seek-lavf-mkv:      SRC = lavf/lavf.mkv
 fate-seek-lavf-mmf:      SRC = lavf/lavf.mmf
 fate-seek-lavf-mov:      SRC = lavf/lavf.mov
+fate-seek-lavf-mp4_frag: SRC = lavf/lavf.mp4
 fate-seek-lavf-mpg:      SRC = lavf/lavf.mpg
 fate-seek-lavf-mulaw:    SRC = lavf/lavf.ul
 fate-seek-lavf-mxf:      SRC = lavf/lavf.mxf
@@ -242,5 +245,11 @@ $(FATE_SEEK): CMD = run libavformat/seek-test$(EXESUF) $(TARGET_PATH)/tests/data
 $(FATE_SEEK): fate-seek-%: fate-%
 fate-seek-%: REF = $(SRC_PATH)/tests/ref/seek/$(@:fate-seek-%=%)
 
+# the same fragmented file, with fragments read on demand through its mfra index
+FATE_SEEK_LAVF_FRAG_INDEX-$(call ENCDEC2, MPEG4, MP2, MP4 MOV) += fate-seek-lavf-mp4_frag-index
+fate-seek-lavf-mp4_frag-index: libavformat/seek-test$(EXESUF) fate-lavf-mp4_frag
+fate-seek-lavf-mp4_frag-index: CMD = run libavformat/seek-test$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.mp4 -frag_index auto
+FATE_SEEK += $(FATE_SEEK_LAVF_FRAG_INDEX-yes)
+
 FATE_AVCONV += $(FATE_SEEK)
 fate-seek:     $(FATE_SEEK)
@@ -110,10 +110,16 @@ fate-vsynth%-jpeg2000-97:             DECINOPTS = -vcodec jpeg2000
 FATE_VCODEC-$(call ENCDEC, LJPEG MJPEG, AVI) += ljpeg
 fate-vsynth%-ljpeg:              ENCOPTS = -strict -1
 
-FATE_VCODEC-$(call ENCDEC, MJPEG, AVI)  += mjpeg mjpeg-422 mjpeg-444
+FATE_VCODEC-$(call ENCDEC, MJPEG, AVI)  += mjpeg mjpeg-422 mjpeg-444 mjpeg-rst
 fate-vsynth%-mjpeg:              ENCOPTS = -qscale 9 -pix_fmt yuvj420p
 fate-vsynth%-mjpeg-422:          ENCOPTS = -qscale 9 -pix_fmt yuvj422p
 fate-vsynth%-mjpeg-444:          ENCOPTS = -qscale 9 -pix_fmt yuvj444p
+# slice threaded encoding writes a restart marker after every row
+fate-vsynth%-mjpeg-rst:          ENCOPTS = -qscale 9 -pix_fmt yuvj420p \
+                                           -threads 2 -thread_type slice
+fate-vsynth%-mjpeg-rst:          CODEC   = mjpeg
+fate-vsynth%-mjpeg-rst:          THREADS = 4
+fate-vsynth%-mjpeg-rst:          THREAD_TYPE = slice
 
 FATE_VCODEC-$(call ENCDEC, MPEG1VIDEO, MPEG1VIDEO MPEGVIDEO) += mpeg1 mpeg1b
 fate-vsynth%-mpeg1:              FMT     = mpeg1video
@@ -168,6 +174,7 @@ FATE_MPEG4_AVI = mpeg4-rc                                               \
                  mpeg4-adap                                             \
                  mpeg4-qpel                                             \
                  mpeg4-thread                                           \
+                 mpeg4-thread-me                                        \
                  mpeg4-error                                            \
                  mpeg4-nr                                               \
                  mpeg4-nsse
@@ -210,6 +217,9 @@ fate-vsynth%-mpeg4-thread:       ENCOPTS = -b 500k -flags +mv4+aic         \
                                            -mbd bits -ps 200 -bf 2         \
                                            -threads 2 -slices 2
 
+fate-vsynth%-mpeg4-thread-me:    ENCOPTS = -qscale 5 -flags +mv4 -bf 2 \
+                                           -last_pred 2 -threads 4 -slices 1
+
 FATE_VCODEC-$(call ENCDEC, MSMPEG4V3, AVI) += msmpeg4
 fate-vsynth%-msmpeg4:            ENCOPTS = -qscale 10
 
@@ -90,5 +90,16 @@ endef
 
 $(eval $(call FATE_VP9_FULL))
 
+# tile columns decoded in parallel must give the same output
+define FATE_VP9_SLICE_THREADS
+FATE_VP9-$(CONFIG_MATROSKA_DEMUXER) += fate-vp9-$(1)-slice-threads
+fate-vp9-$(1)-slice-threads: CMD = framemd5 -i $(TARGET_SAMPLES)/vp9-test-vectors/vp90-2-$(1).webm
+fate-vp9-$(1)-slice-threads: REF = $(SRC_PATH)/tests/ref/fate/vp9-$(1)
+fate-vp9-$(1)-slice-threads: THREADS = 4
+fate-vp9-$(1)-slice-threads: THREAD_TYPE = slice
+endef
+
+$(eval $(call FATE_VP9_SLICE_THREADS,tiling-pedestrian))
+
 FATE_SAMPLES_AVCONV-$(CONFIG_VP9_DECODER) += $(FATE_VP9-yes)
 fate-vp9: $(FATE_VP9-yes)
@@ -94,6 +94,12 @@ if [ -n "$do_ts" ] ; then
 do_lavf ts "" "-ab 64k -mpegts_transport_stream_id 42 -ar 44100"
 fi
 
+if [ -n "$do_ts_cbr" ] ; then
+file=${outfile}lavf_cbr.ts
+do_avconv $file $DEC_OPTS -f image2 -vcodec pgmyuv -i $raw_src $DEC_OPTS -ar 44100 -f s16le -i $pcm_src $ENC_OPTS -b:a 64k -t 1 -qscale:v 10 -mpegts_transport_stream_id 42 -muxrate 5000k
+do_avconv_crc $file $DEC_OPTS -i $target_path/$file
+fi
+
 if [ -n "$do_swf" ] ; then
 do_lavf swf "" "-an"
 fi
@@ -116,6 +122,23 @@ do_lavf mov "" "-movflags +rtphint $mov_common_opt"
 do_lavf_timecode mov "-movflags +faststart $mov_common_opt"
 fi
 
+if [ -n "$do_mov_faststart" ] ; then
+mov_common_opt="-acodec pcm_alaw -vcodec mpeg4 -movflags +faststart"
+file=${outfile}lavf_faststart.mov
+# the moov atom fits into the space reserved from the expected duration
+do_avconv $file $DEC_OPTS -f image2 -vcodec pgmyuv -i $raw_src $DEC_OPTS -ar 44100 -f s16le -i $pcm_src $ENC_OPTS -b:a 64k -t 1 -qscale:v 10 $mov_common_opt -faststart_duration 2
+do_avconv_crc $file $DEC_OPTS -i $target_path/$file
+do_avconv $file $DEC_OPTS -f image2 -vcodec pgmyuv -i $raw_src $DEC_OPTS -ar 44100 -f s16le -i $pcm_src $ENC_OPTS -b:a 64k -t 1 -qscale:v 10 $mov_common_opt -faststart_samples 100
+do_avconv_crc $file $DEC_OPTS -i $target_path/$file
+# too little space reserved, the moov atom is moved in a second pass
+do_avconv $file $DEC_OPTS -f image2 -vcodec pgmyuv -i $raw_src $DEC_OPTS -ar 44100 -f s16le -i $pcm_src $ENC_OPTS -b:a 64k -t 1 -qscale:v 10 $mov_common_opt -moov_size 512
+do_avconv_crc $file $DEC_OPTS -i $target_path/$file
+fi
+
+if [ -n "$do_mp4_frag" ] ; then
+do_lavf mp4 "" "-movflags frag_keyframe+empty_moov+separate_moof -acodec mp2 -vcodec mpeg4"
+fi
+
 if [ -n "$do_ismv" ] ; then
 do_lavf_timecode ismv "-an -vcodec mpeg4"
 fi